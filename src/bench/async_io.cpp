@@ -0,0 +1,160 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+// Measures random 8KB page read IOPS at queue depths 1 through 64 on the
+// io_uring and the thread pool I/O engines, and through
+// BufMgr::readPageAsync() with a pool too small to hold the file.  Every
+// completion immediately submits the next read, so the queue depth stays
+// constant.  Run against a file that is not in the page cache to see the
+// device; otherwise this measures the system call path.
+//
+// Usage: bench/async_io [pages] [reads]
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+#include "io_engine.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_asyncio.db";
+
+// Keeps queueDepth reads in flight until reads have completed.
+class Driver {
+ public:
+  Driver(IoEngine &engine, int fd, PageId pages, std::uint32_t queueDepth,
+         std::uint64_t reads)
+      : engine(engine),
+        fd(fd),
+        any(1, pages),
+        rng(5),
+        buffers(queueDepth, std::vector<char>(Page::SIZE)),
+        iovs(queueDepth),
+        remaining(reads),
+        completed(0),
+        reads(reads) {}
+
+  double run() {
+    auto start = std::chrono::steady_clock::now();
+    for (std::uint32_t slot = 0; slot < buffers.size(); slot++) {
+      std::unique_lock<std::mutex> guard(latch);
+      next(slot, guard);
+    }
+    std::unique_lock<std::mutex> guard(latch);
+    done.wait(guard, [this]() { return completed == reads; });
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return reads / elapsed.count();
+  }
+
+ private:
+  // Submits the next read of a slot; the guard is released for the submit.
+  void next(std::uint32_t slot, std::unique_lock<std::mutex> &guard) {
+    if (remaining == 0) return;
+    remaining--;
+    const off_t offset = (off_t)(any(rng) - 1) * Page::SIZE;
+    guard.unlock();
+    iovs[slot] = {buffers[slot].data(), Page::SIZE};
+    engine.submit(IoOp::READ, fd, &iovs[slot], 1, offset,
+                  [this, slot](const ssize_t result) {
+                    if (result != (ssize_t)Page::SIZE) {
+                      std::cerr << "read failed: " << result << "\n";
+                      std::exit(1);
+                    }
+                    std::unique_lock<std::mutex> guard(latch);
+                    if (++completed == reads) done.notify_one();
+                    next(slot, guard);
+                  });
+  }
+
+  IoEngine &engine;
+  int fd;
+  std::uniform_int_distribution<PageId> any;
+  std::mt19937 rng;
+  std::vector<std::vector<char>> buffers;
+  std::vector<struct iovec> iovs;
+  std::mutex latch;
+  std::condition_variable done;
+  std::uint64_t remaining;
+  std::uint64_t completed;
+  const std::uint64_t reads;
+};
+
+double bufMgrIops(File &file, PageId pages, std::uint32_t queueDepth,
+                  std::uint64_t reads) {
+  BufMgr bufMgr(pages / 10 + queueDepth);
+  std::mt19937 rng(5);
+  std::uniform_int_distribution<PageId> any(1, pages);
+  std::deque<std::pair<PageId, std::future<Page *>>> inFlight;
+  auto start = std::chrono::steady_clock::now();
+  for (std::uint64_t i = 0; i < reads; i++) {
+    if (inFlight.size() == queueDepth) {
+      inFlight.front().second.get();
+      bufMgr.unPinPage(file, inFlight.front().first, false);
+      inFlight.pop_front();
+    }
+    PageId pageNo = any(rng);
+    inFlight.emplace_back(pageNo, bufMgr.readPageAsync(file, pageNo));
+  }
+  for (auto &read : inFlight) {
+    read.second.get();
+    bufMgr.unPinPage(file, read.first, false);
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  bufMgr.flushFile(file);
+  return reads / elapsed.count();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const PageId pages = argc > 1 ? std::atoi(argv[1]) : 5000;
+  const std::uint64_t reads = argc > 2 ? std::atoll(argv[2]) : 20000;
+
+  try {
+    File::remove(kFilename);
+  } catch (const FileNotFoundException &) {
+  }
+
+  {
+    File file = File::create(kFilename);
+    for (PageId i = 0; i < pages; i++) file.allocatePage();
+    const int fd = ::open(kFilename.c_str(), O_RDONLY);
+
+    std::unique_ptr<IoEngine> uring = IoEngine::create(64);
+    std::cout << "qd\t" << uring->name() << "\tthreadpool\tbufmgr\n";
+    for (std::uint32_t queueDepth = 1; queueDepth <= 64; queueDepth *= 2) {
+      std::unique_ptr<IoEngine> pool = IoEngine::createThreadPool(queueDepth);
+      std::cout << queueDepth << "\t"
+                << (int)Driver(*uring, fd, pages, queueDepth, reads).run()
+                << "\t"
+                << (int)Driver(*pool, fd, pages, queueDepth, reads).run()
+                << "\t\t" << (int)bufMgrIops(file, pages, queueDepth, reads)
+                << "\n";
+    }
+    ::close(fd);
+  }
+
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,99 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+// Measures readPage miss latency of an update-heavy workload with and without
+// the background writer.  Without it, most misses evict a dirty page and
+// write it back before reading; with it, the victims are usually clean.
+// Between operations the client pauses for a short think time, during which
+// the writer can run.
+//
+// Usage: bench/bg_writer [pages] [frames] [accesses] [think_us]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_bgwriter.db";
+
+void run(const char *name, File &file, PageId pages, std::uint32_t frames,
+         std::uint64_t accesses, int thinkUs, bool withWriter) {
+  BufMgr bufMgr(frames);
+  if (withWriter) bufMgr.startBgWriter();
+
+  std::mt19937 rng(11);
+  std::uniform_int_distribution<PageId> any(1, pages);
+  std::vector<double> missUs;
+  Page *page;
+  for (std::uint64_t i = 0; i < accesses; i++) {
+    PageId pageNo = any(rng);
+    int readsBefore = bufMgr.getBufStats().diskreads;
+    auto start = std::chrono::steady_clock::now();
+    bufMgr.readPage(file, pageNo, page);
+    std::chrono::duration<double, std::micro> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (bufMgr.getBufStats().diskreads != readsBefore) {
+      missUs.push_back(elapsed.count());
+    }
+    // Every other access updates the page.
+    bufMgr.unPinPage(file, pageNo, i % 2 == 0);
+    if (thinkUs > 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(thinkUs));
+    }
+  }
+
+  BufStats stats = bufMgr.getBufStats();
+  bufMgr.stopBgWriter();
+  bufMgr.flushFile(file);
+
+  std::sort(missUs.begin(), missUs.end());
+  auto percentile = [&missUs](double p) {
+    if (missUs.empty()) return 0.0;
+    return missUs[(std::size_t)(p * (missUs.size() - 1))];
+  };
+  std::cout << name << "\t" << missUs.size() << "\t" << stats.diskwrites << "\t"
+            << percentile(0.5) << "\t" << percentile(0.99) << "\t"
+            << percentile(0.999) << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const PageId pages = argc > 1 ? std::atoi(argv[1]) : 5000;
+  const std::uint32_t frames = argc > 2 ? std::atoi(argv[2]) : 500;
+  const std::uint64_t accesses = argc > 3 ? std::atoll(argv[3]) : 20000;
+  const int thinkUs = argc > 4 ? std::atoi(argv[4]) : 20;
+
+  try {
+    File::remove(kFilename);
+  } catch (const FileNotFoundException &) {
+  }
+
+  {
+    File file = File::create(kFilename);
+    for (PageId i = 0; i < pages; i++) file.allocatePage();
+
+    std::cout << "writer\tmisses\twrites\tp50_us\tp99_us\tp999_us\n";
+    run("off", file, pages, frames, accesses, thinkUs, false);
+    run("on", file, pages, frames, accesses, thinkUs, true);
+  }
+
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,125 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+// Logs whole-page changes to random pages for a while with the checkpointer
+// running at several recovery time targets, then drops the buffer pool
+// without writing it, as a crash would, and times BufMgr::recover().  Prints
+// the number of checkpoints, their average duration and pages written, the
+// update rate, and the records and time recovery took.  "none" runs without
+// checkpoints, so recovery replays the whole log.
+//
+// Usage: bench/checkpoint [pages] [seconds per run]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_checkpoint.db";
+const std::string kLogFilename = "bench_checkpoint.log";
+
+void removeLog() {
+  std::remove(kLogFilename.c_str());
+  std::remove(LogManager::masterFilename(kLogFilename).c_str());
+}
+
+// Runs the workload with the given target, 0 for no checkpoints, and prints
+// one line.
+void run(const char *name, PageId pages, double seconds,
+         std::chrono::milliseconds target) {
+  removeLog();
+  std::uint64_t updates = 0;
+  CheckpointStats stats;
+  {
+    File file = File::open(kFilename);
+    LogManager log(kLogFilename);
+    BufMgr bufMgr(pages);
+    bufMgr.enableLogging(log);
+    if (target.count() > 0) {
+      CheckpointConfig config;
+      config.targetRecoveryTime = target;
+      bufMgr.startCheckpointer(config);
+    }
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<PageId> any(1, pages);
+    const auto start = std::chrono::steady_clock::now();
+    const auto end = start + std::chrono::duration<double>(seconds);
+    while (std::chrono::steady_clock::now() < end) {
+      for (int i = 0; i < 100; i++, updates++) {
+        const PageId pageNo = any(rng);
+        Page *page;
+        bufMgr.readPage(file, pageNo, page);
+        page->updateRecord({pageNo, 1}, "update " + std::to_string(updates));
+        bufMgr.logUpdate(file, pageNo);
+        bufMgr.unPinPage(file, pageNo, true);
+      }
+    }
+    bufMgr.stopCheckpointer();
+    stats = bufMgr.getCheckpointStats();
+    log.flushAll();
+    // The buffer pool goes away without writing its dirty pages.
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  const std::uint64_t replayed = BufMgr::recover(kLogFilename);
+  const std::chrono::duration<double> recovery =
+      std::chrono::steady_clock::now() - start;
+
+  std::cout << name << "\t" << stats.checkpoints << "\t"
+            << (stats.checkpoints > 0
+                    ? stats.totalDuration.count() / 1000.0 / stats.checkpoints
+                    : 0)
+            << "\t"
+            << (stats.checkpoints > 0
+                    ? (double)stats.pagesWritten / stats.checkpoints
+                    : 0)
+            << "\t" << (int)(updates / seconds) << "\t" << replayed << "\t"
+            << recovery.count() * 1000 << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const PageId pages = argc > 1 ? std::atoi(argv[1]) : 4096;
+  const double seconds = argc > 2 ? std::atof(argv[2]) : 3;
+
+  try {
+    File::remove(kFilename);
+  } catch (const FileNotFoundException &) {
+  }
+
+  {
+    File file = File::create(kFilename);
+    for (PageId i = 0; i < pages; i++) {
+      Page page = file.allocatePage();
+      page.insertRecord("update");
+      file.writePage(page);
+    }
+  }
+
+  std::cout << "target\tcheckpoints\tms each\tpages each\tupdates/s\t"
+               "replayed\trecovery ms\n";
+  run("none", pages, seconds, std::chrono::milliseconds(0));
+  run("1000ms", pages, seconds, std::chrono::milliseconds(1000));
+  run("100ms", pages, seconds, std::chrono::milliseconds(100));
+  run("10ms", pages, seconds, std::chrono::milliseconds(10));
+
+  File::remove(kFilename);
+  removeLog();
+  return 0;
+}
@@ -0,0 +1,115 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+// Measures the cost of page checksums.  First the CRC-32C of one page image,
+// with the implementation crc32c() picked for this CPU and with the portable
+// one, in nanoseconds per page and GB/s.  Then reads every page of a file
+// in random order with File::readPage, with checking on and off, so the
+// difference is the share of checking in a read from the page cache.
+//
+// Usage: bench/checksum [pages] [rounds]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "checksum.h"
+#include "exceptions/file_not_found_exception.h"
+#include "file.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_checksum.db";
+
+// Returns nanoseconds per page of checksumming one page image repeatedly.
+template <typename Checksum>
+double perPage(const Page &page, std::uint64_t rounds, Checksum checksum,
+               std::uint32_t &sum) {
+  auto start = std::chrono::steady_clock::now();
+  for (std::uint64_t i = 0; i < rounds; i++) {
+    sum += checksum(&page, Page::SIZE, sum);
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / rounds;
+}
+
+// Reads the pages in the given order and returns nanoseconds per page.
+double readAll(File &file, const std::vector<PageId> &order) {
+  Page page{Page::Uninitialized()};
+  auto start = std::chrono::steady_clock::now();
+  for (const PageId pageNo : order) file.readPage(pageNo, page);
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / order.size();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const PageId pages = argc > 1 ? std::atoi(argv[1]) : 20000;
+  const std::uint64_t rounds = argc > 2 ? std::atoll(argv[2]) : 200000;
+
+  Page page;
+  for (int i = 0; page.hasSpaceForRecord("checksum " + std::to_string(i));
+       i++) {
+    page.insertRecord("checksum " + std::to_string(i));
+  }
+
+  std::uint32_t sum = 0;
+  std::cout << "crc32c\tns/page\tGB/s\n";
+  const double fast = perPage(
+      page, rounds,
+      [](const void *data, std::size_t length, std::uint32_t crc) {
+        return crc32c(data, length, crc);
+      },
+      sum);
+  const double portable = perPage(
+      page, rounds,
+      [](const void *data, std::size_t length, std::uint32_t crc) {
+        return crc32cPortable(data, length, crc);
+      },
+      sum);
+  std::cout << crc32cImplementation() << "\t" << fast << "\t"
+            << Page::SIZE / fast << "\n";
+  std::cout << "portable\t" << portable << "\t" << Page::SIZE / portable
+            << "\n";
+
+  try {
+    File::remove(kFilename);
+  } catch (const FileNotFoundException &) {
+  }
+  {
+    File file = File::create(kFilename);
+    for (PageId i = 0; i < pages; i++) file.writePage(file.allocatePage());
+
+    std::vector<PageId> order(pages);
+    std::iota(order.begin(), order.end(), 1);
+    std::shuffle(order.begin(), order.end(), std::mt19937(3));
+
+    readAll(file, order);  // warm the page cache
+    file.verifyChecksums(true);
+    const double checked = readAll(file, order);
+    file.verifyChecksums(false);
+    const double unchecked = readAll(file, order);
+    std::cout << "\nreadPage\tns/page\n"
+              << "checked\t" << checked << "\n"
+              << "unchecked\t" << unchecked << "\n";
+  }
+  std::cerr << "checksum " << sum << "\n";
+
+  File::remove(kFilename);
+  return 0;
+}
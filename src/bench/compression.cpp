@@ -0,0 +1,128 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+// Writes the same pages to a plain and a compressed file and scans both in
+// page order.  "sparse" pages hold one record each, like the pages main.cpp
+// writes; "full" pages are filled with such records.  Prints the size of
+// each file and the ratio to the plain one, then pages per second for a
+// cold scan, which starts with the file dropped from the page cache with
+// posix_fadvise(POSIX_FADV_DONTNEED), and for a hot scan right after it.
+//
+// Usage: bench/compression [pages]
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include "exceptions/file_not_found_exception.h"
+#include "file.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_compression.db";
+
+void removeFile() {
+  try {
+    File::remove(kFilename);
+  } catch (const FileNotFoundException &) {
+  }
+}
+
+// Returns the bytes a scan reads: the file and its location map.
+off_t fileBytes() {
+  off_t bytes = 0;
+  struct stat status;
+  if (stat(kFilename.c_str(), &status) == 0) bytes += status.st_size;
+  if (stat(File::locationMapFilename(kFilename).c_str(), &status) == 0) {
+    bytes += status.st_size;
+  }
+  return bytes;
+}
+
+// Drops the pages of the file from the page cache.
+void dropCache() {
+  for (const std::string &name :
+       {kFilename, File::locationMapFilename(kFilename)}) {
+    const int fd = ::open(name.c_str(), O_RDONLY);
+    if (fd < 0) continue;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+  }
+}
+
+// Reads every page in order and returns pages per second; sum keeps the
+// reads from being optimized away.
+double scan(PageId pages, std::uint64_t &sum) {
+  File file = File::open(kFilename);
+  file.advise(FileAdvice::SEQUENTIAL);
+  Page page{Page::Uninitialized()};
+  auto start = std::chrono::steady_clock::now();
+  for (PageId pageNo = 1; pageNo <= pages; pageNo++) {
+    file.readPage(pageNo, page);
+    sum += page.getFreeSpace();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return pages / elapsed.count();
+}
+
+// Creates the file in the given format, scans it and prints one line.
+void run(const char *name, FileFormat format, bool full, PageId pages,
+         off_t plainBytes, std::uint64_t &sum) {
+  removeFile();
+  {
+    File file = File::create(kFilename, format);
+    char record[64];
+    for (PageId i = 0; i < pages; i++) {
+      Page page = file.allocatePage();
+      for (int n = 0; n == 0 || full; n++) {
+        std::snprintf(record, sizeof(record), "test.1 Page %d %7.1f",
+                      page.page_number() + n, (float)(page.page_number() + n));
+        if (!page.hasSpaceForRecord(record)) break;
+        page.insertRecord(record);
+      }
+      file.writePage(page);
+    }
+  }
+  const off_t bytes = fileBytes();
+  dropCache();
+  const double cold = scan(pages, sum);
+  const double hot = scan(pages, sum);
+  std::cout << name << "\t" << bytes / 1024 << "\t"
+            << (plainBytes > 0 ? (double)plainBytes / bytes : 1.0) << "\t"
+            << (int)cold << "\t" << (int)hot << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const PageId pages = argc > 1 ? std::atoi(argv[1]) : 20000;
+
+  std::uint64_t sum = 0;
+  std::cout << "file\tKB\tratio\tcold pages/s\thot pages/s\n";
+  for (const bool full : {false, true}) {
+    run(full ? "full plain" : "sparse plain", FileFormat::PLAIN, full, pages,
+        0, sum);
+    const off_t plainBytes = fileBytes();
+    run(full ? "full compressed" : "sparse compressed", FileFormat::COMPRESSED,
+        full, pages, plainBytes, sum);
+  }
+  std::cerr << "checksum " << sum << "\n";
+
+  removeFile();
+  return 0;
+}
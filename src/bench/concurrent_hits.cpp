@@ -0,0 +1,103 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+// Measures buffer pool hit throughput (readPage + unPinPage of resident pages)
+// as the number of threads grows, once with a single shard and once with one
+// shard per thread.
+//
+// Usage: bench/concurrent_hits [pages] [ops_per_thread]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_hits.db";
+
+double runHits(BufMgr &bufMgr, std::vector<File> &files, PageId pages,
+               std::uint64_t opsPerThread) {
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t t = 0; t < files.size(); t++) {
+    threads.emplace_back([&bufMgr, &files, t, pages, opsPerThread]() {
+      File &file = files[t];
+      std::uint64_t x = 88172645463325252ULL + t;
+      Page *page;
+      for (std::uint64_t op = 0; op < opsPerThread; op++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        PageId pageNo = 1 + x % pages;
+        bufMgr.readPage(file, pageNo, page);
+        bufMgr.unPinPage(file, pageNo, false);
+      }
+    });
+  }
+  for (std::thread &thread : threads) thread.join();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return files.size() * opsPerThread / elapsed.count();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const PageId pages = argc > 1 ? std::atoi(argv[1]) : 4096;
+  const std::uint64_t opsPerThread = argc > 2 ? std::atoll(argv[2]) : 1000000;
+  unsigned maxThreads = std::thread::hardware_concurrency();
+  if (maxThreads == 0) maxThreads = 1;
+
+  try {
+    File::remove(kFilename);
+  } catch (const FileNotFoundException &) {
+  }
+
+  {
+    File file = File::create(kFilename);
+    for (PageId i = 0; i < pages; i++) file.allocatePage();
+
+    std::vector<unsigned> threadCounts;
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2) {
+      threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    std::cout << "threads  shards  hits/s\n";
+    for (unsigned threads : threadCounts) {
+      for (std::uint32_t shards : {1u, threads * 4}) {
+        // Pages are spread over the shards by hash, not evenly, so leave
+        // headroom for every shard to hold all of its pages; after the
+        // warm-up pass every access is a hit.
+        BufMgr bufMgr(2 * pages, shards);
+        Page *page;
+        for (PageId i = 1; i <= pages; i++) {
+          bufMgr.readPage(file, i, page);
+          bufMgr.unPinPage(file, i, false);
+        }
+
+        std::vector<File> files(threads, file);
+        double rate = runHits(bufMgr, files, pages, opsPerThread);
+        std::cout << threads << "\t " << shards << "\t " << (std::uint64_t)rate
+                  << "\n";
+        bufMgr.flushFile(file);
+      }
+    }
+  }
+
+  File::remove(kFilename);
+  return 0;
+}
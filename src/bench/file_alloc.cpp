@@ -0,0 +1,96 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+// Allocates pages into a single file and prints the allocation rate of every
+// tenth of them; with O(1) allocation the rate stays flat as the file grows.
+// Then deletes every other page of the last tenth, which needs the
+// predecessor of each page in the used list, and allocates them again from
+// the free list; both should run at about the same rate.  Finally reopens
+// the file, whose page chain then starts out unknown, and times the first
+// allocation and a tenth more, then the reuse of pages freed before it was
+// reopened once more.
+//
+// Usage: bench/file_alloc [pages]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "exceptions/file_not_found_exception.h"
+#include "file.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_filealloc.db";
+
+// Returns the seconds since start.
+double since(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// Allocates count pages and returns pages per second.
+double allocate(File &file, PageId count) {
+  Page page{Page::Uninitialized()};
+  auto start = std::chrono::steady_clock::now();
+  for (PageId i = 0; i < count; i++) file.allocatePage(page);
+  return count / since(start);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const PageId pages = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  const PageId tenth = pages / 10;
+
+  try {
+    File::remove(kFilename);
+  } catch (const FileNotFoundException &) {
+  }
+
+  {
+    File file = File::create(kFilename);
+    std::cout << "pages\tpages/s\n";
+    for (PageId done = tenth; done <= pages; done += tenth) {
+      std::cout << done << "\t" << (int)allocate(file, tenth) << "\n";
+    }
+
+    PageId freed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (PageId pageNo = pages - tenth + 1; pageNo <= pages; pageNo += 2) {
+      file.deletePage(pageNo);
+      freed++;
+    }
+    std::cout << "delete\t" << (int)(freed / since(start)) << "\n";
+    std::cout << "reuse\t" << (int)allocate(file, freed) << "\n";
+  }
+
+  {
+    File file = File::open(kFilename);
+    Page page{Page::Uninitialized()};
+    auto start = std::chrono::steady_clock::now();
+    file.allocatePage(page);
+    std::cout << "reopened, first allocation\t" << since(start) * 1e6
+              << " us\n";
+    std::cout << "reopened, append\t" << (int)allocate(file, tenth) << "\n";
+    for (PageId pageNo = tenth; pageNo < 2 * tenth; pageNo += 2) {
+      file.deletePage(pageNo);
+    }
+  }
+  {
+    File file = File::open(kFilename);
+    std::cout << "reopened, reuse\t" << (int)allocate(file, tenth / 2)
+              << "\n";
+  }
+
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,196 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+// Compares insert/lookup/remove throughput of BufHashTbl against the chained
+// hash table it replaced, for pool sizes from 1K frames up to a maximum.
+//
+// Usage: bench/hash_table [max_frames]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bufHashTbl.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/hash_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+// The previous BufHashTbl: separate chaining with a shared_ptr per bucket and
+// a File copy in every bucket.
+class ChainedHashTbl {
+ public:
+  struct Bucket {
+    File file;
+    PageId pageNo;
+    FrameId frameNo;
+    std::shared_ptr<Bucket> next;
+  };
+
+  explicit ChainedHashTbl(int bufs)
+      : HTSIZE(((int)(bufs * 1.2) & -2) + 1), ht(HTSIZE) {}
+
+  void insert(const File &file, const PageId pageNo, const FrameId frameNo) {
+    int index = hash(file, pageNo);
+    std::shared_ptr<Bucket> tmpBuc = std::make_shared<Bucket>();
+    tmpBuc->file = file;
+    tmpBuc->pageNo = pageNo;
+    tmpBuc->frameNo = frameNo;
+    tmpBuc->next = ht[index];
+    ht[index] = tmpBuc;
+  }
+
+  void lookup(const File &file, const PageId pageNo, FrameId &frameNo) {
+    std::shared_ptr<Bucket> tmpBuc = ht[hash(file, pageNo)];
+    while (tmpBuc) {
+      if (tmpBuc->file == file && tmpBuc->pageNo == pageNo) {
+        frameNo = tmpBuc->frameNo;
+        return;
+      }
+      tmpBuc = tmpBuc->next;
+    }
+    throw HashNotFoundException(file.filename(), pageNo);
+  }
+
+  void remove(const File &file, const PageId pageNo) {
+    int index = hash(file, pageNo);
+    std::shared_ptr<Bucket> tmpBuc = ht[index];
+    std::shared_ptr<Bucket> prevBuc;
+    while (tmpBuc) {
+      if (tmpBuc->file == file && tmpBuc->pageNo == pageNo) {
+        if (prevBuc)
+          prevBuc->next = tmpBuc->next;
+        else
+          ht[index] = tmpBuc->next;
+        return;
+      }
+      prevBuc = tmpBuc;
+      tmpBuc = tmpBuc->next;
+    }
+    throw HashNotFoundException(file.filename(), pageNo);
+  }
+
+ private:
+  int hash(const File &file, const PageId pageNo) {
+    auto hash =
+        std::hash<std::string>{}(file.filename()) ^ std::hash<PageId>{}(pageNo);
+    return hash % HTSIZE;
+  }
+
+  int HTSIZE;
+  std::vector<std::shared_ptr<Bucket>> ht;
+};
+
+// BufHashTbl behind the same interface, keyed the way BufMgr keys it.
+class OpenHashTbl {
+ public:
+  explicit OpenHashTbl(std::uint32_t bufs) : table(bufs) {}
+
+  void insert(const File &file, const PageId pageNo, const FrameId frameNo) {
+    table.insert(makePageKey(file.id(), pageNo), frameNo);
+  }
+
+  void lookup(const File &file, const PageId pageNo, FrameId &frameNo) {
+    table.lookup(makePageKey(file.id(), pageNo), frameNo);
+  }
+
+  void remove(const File &file, const PageId pageNo) {
+    table.remove(makePageKey(file.id(), pageNo));
+  }
+
+ private:
+  BufHashTbl table;
+};
+
+// Keeps the lookup loop from being optimized away.
+volatile FrameId lookupSink;
+
+struct Key {
+  File *file;
+  PageId pageNo;
+};
+
+double nsPerOp(std::chrono::steady_clock::time_point start, std::size_t ops) {
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / ops;
+}
+
+template <typename Table>
+void run(const char *name, std::uint32_t frames, std::vector<Key> &keys) {
+  Table table(frames);
+  std::mt19937 rng(42);
+
+  auto start = std::chrono::steady_clock::now();
+  for (FrameId f = 0; f < frames; f++) {
+    table.insert(*keys[f].file, keys[f].pageNo, f);
+  }
+  double insertNs = nsPerOp(start, frames);
+
+  std::shuffle(keys.begin(), keys.end(), rng);
+  FrameId frameNo, sum = 0;
+  start = std::chrono::steady_clock::now();
+  for (const Key &key : keys) {
+    table.lookup(*key.file, key.pageNo, frameNo);
+    sum += frameNo;
+  }
+  double lookupNs = nsPerOp(start, frames);
+  lookupSink = sum;
+
+  std::shuffle(keys.begin(), keys.end(), rng);
+  start = std::chrono::steady_clock::now();
+  for (const Key &key : keys) table.remove(*key.file, key.pageNo);
+  double removeNs = nsPerOp(start, frames);
+
+  std::cout << frames << "\t" << name << "\t" << insertNs << "\t" << lookupNs
+            << "\t" << removeNs << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const std::uint32_t maxFrames = argc > 1 ? std::atoi(argv[1]) : 10000000;
+  const std::vector<std::string> filenames = {"bench_ht.1", "bench_ht.2",
+                                              "bench_ht.3", "bench_ht.4"};
+  for (const std::string &filename : filenames) {
+    try {
+      File::remove(filename);
+    } catch (const FileNotFoundException &) {
+    }
+  }
+
+  {
+    std::vector<File> files;
+    for (const std::string &filename : filenames) {
+      files.push_back(File::create(filename));
+    }
+
+    std::cout << "frames\ttable\tinsert_ns\tlookup_ns\tremove_ns\n";
+    for (std::uint32_t frames = 1000; frames <= maxFrames; frames *= 10) {
+      // Pages of a few files, as a buffer pool would hold them.
+      std::vector<Key> keys(frames);
+      for (std::uint32_t i = 0; i < frames; i++) {
+        keys[i] = Key{&files[i % files.size()], 1 + i / (PageId)files.size()};
+      }
+      run<ChainedHashTbl>("chained", frames, keys);
+      run<OpenHashTbl>("open", frames, keys);
+    }
+  }
+
+  for (const std::string &filename : filenames) File::remove(filename);
+  return 0;
+}
@@ -0,0 +1,94 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+// Compares the cost of reporting a buffer miss with HashNotFoundException, as
+// BufMgr used to, against BufHashTbl::tryLookup, and measures the CPU cost of
+// a whole BufMgr::readPage miss on a file in the page cache.
+//
+// Usage: bench/miss_path [frames] [lookups]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+#include "bufHashTbl.h"
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/hash_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_misspath.db";
+
+// Runs op count times and returns nanoseconds per call.
+template <typename Op>
+double nsPerOp(std::uint64_t count, Op op) {
+  auto start = std::chrono::steady_clock::now();
+  for (std::uint64_t i = 0; i < count; i++) op(i);
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / count;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const std::uint32_t frames = argc > 1 ? std::atoi(argv[1]) : 1000;
+  const std::uint64_t lookups = argc > 2 ? std::atoll(argv[2]) : 1000000;
+
+  try {
+    File::remove(kFilename);
+  } catch (const FileNotFoundException &) {
+  }
+  double throwing, returning, miss;
+  std::uint64_t found = 0;
+  {
+    const PageId pages = 4 * frames;
+    File file = File::create(kFilename);
+    for (PageId i = 0; i < pages; i++) file.allocatePage();
+
+    // Half the table is filled; every lookup misses.
+    BufHashTbl table(frames);
+    for (FrameId i = 0; i < frames / 2; i++) {
+      table.insert(makePageKey(file.id(), 1 + i), i);
+    }
+    throwing = nsPerOp(lookups, [&](std::uint64_t i) {
+      FrameId frameNo;
+      try {
+        table.lookup(makePageKey(file.id(), frames + i), frameNo);
+        found++;
+      } catch (const HashNotFoundException &) {
+      }
+    });
+    returning = nsPerOp(lookups, [&](std::uint64_t i) {
+      FrameId frameNo;
+      if (table.tryLookup(makePageKey(file.id(), frames + i), frameNo)) {
+        found++;
+      }
+    });
+
+    BufMgr bufMgr(frames);
+    Page *page;
+    // A cyclic scan over more pages than frames misses on every access.
+    miss = nsPerOp(4 * pages, [&](std::uint64_t i) {
+      const PageId pageNo = 1 + i % pages;
+      bufMgr.readPage(file, pageNo, page);
+      bufMgr.unPinPage(file, pageNo, false);
+    });
+    bufMgr.flushFile(file);
+  }
+  File::remove(kFilename);
+
+  std::cout << "lookup miss, exception\t" << throwing << " ns\n"
+            << "lookup miss, tryLookup\t" << returning << " ns\n"
+            << "BufMgr::readPage miss\t" << miss << " ns\n";
+  return found == 0 ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+// Scans every page of a file in order and at random with the pread backend
+// (File::readPage into a page object), and with the mmap backend through
+// File::readPage and through File::viewPage, which copies nothing.  Cold
+// scans start with the file dropped from the page cache with
+// posix_fadvise(POSIX_FADV_DONTNEED); hot scans run right after a cold one.
+// A cold scan only shows the device if the kernel actually drops the pages.
+//
+// Usage: bench/mmap_scan [pages]
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "exceptions/file_not_found_exception.h"
+#include "file.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_mmapscan.db";
+
+enum class Reader { PREAD, MMAP_READ, MMAP_VIEW };
+
+// Drops the pages of the file from the page cache.
+void dropCache() {
+  const int fd = ::open(kFilename.c_str(), O_RDONLY);
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  ::close(fd);
+}
+
+// Reads the pages in the given order and returns pages per second; sum
+// keeps the reads from being optimized away.
+double scan(File &file, Reader reader, const std::vector<PageId> &order,
+            std::uint64_t &sum) {
+  Page page{Page::Uninitialized()};
+  auto start = std::chrono::steady_clock::now();
+  for (const PageId pageNo : order) {
+    const Page *read = &page;
+    if (reader == Reader::MMAP_VIEW) {
+      read = file.viewPage(pageNo);
+    } else {
+      file.readPage(pageNo, page);
+    }
+    sum += read->page_number() + read->getFreeSpace();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return order.size() / elapsed.count();
+}
+
+// Runs a cold and a hot scan and prints both rates.
+void report(const char *name, Reader reader, const std::vector<PageId> &order,
+            std::uint64_t &sum) {
+  File file = File::open(kFilename, reader == Reader::PREAD
+                                        ? FileBackend::PREAD
+                                        : FileBackend::MMAP);
+  file.advise(order.front() == 1 ? FileAdvice::SEQUENTIAL
+                                 : FileAdvice::RANDOM);
+  dropCache();
+  const double cold = scan(file, reader, order, sum);
+  const double hot = scan(file, reader, order, sum);
+  std::cout << name << "\t" << (int)cold << "\t" << (int)hot << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const PageId pages = argc > 1 ? std::atoi(argv[1]) : 20000;
+
+  try {
+    File::remove(kFilename);
+  } catch (const FileNotFoundException &) {
+  }
+
+  {
+    File file = File::create(kFilename);
+    Page page{Page::Uninitialized()};
+    for (PageId i = 0; i < pages; i++) file.allocatePage(page);
+  }
+
+  std::vector<PageId> sequential(pages);
+  std::iota(sequential.begin(), sequential.end(), 1);
+  std::vector<PageId> random = sequential;
+  std::shuffle(random.begin(), random.end(), std::mt19937(5));
+
+  std::uint64_t sum = 0;
+  for (const auto &order : {sequential, random}) {
+    std::cout << (order.front() == 1 ? "sequential" : "random")
+              << "\tcold pages/s\thot pages/s\n";
+    report("pread", Reader::PREAD, order, sum);
+    report("mmap read", Reader::MMAP_READ, order, sum);
+    report("mmap view", Reader::MMAP_VIEW, order, sum);
+  }
+  std::cerr << "checksum " << sum << "\n";
+
+  File::remove(kFilename);
+  return 0;
+}
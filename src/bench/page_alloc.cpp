@@ -0,0 +1,114 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+// Counts heap allocations and time per operation on the page read paths:
+// File::readPage, FileIterator dereference, copying a Page, and
+// BufMgr::readPage misses and hits.  Pages store their bytes inline and
+// misses are detected without exceptions, so none of these should allocate.
+//
+// Usage: bench/page_alloc [pages] [frames]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+#include "file_iterator.h"
+
+namespace {
+std::uint64_t allocations = 0;
+}  // namespace
+
+void *operator new(std::size_t size) {
+  allocations++;
+  void *memory = std::malloc(size == 0 ? 1 : size);
+  if (memory == nullptr) throw std::bad_alloc();
+  return memory;
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_pagealloc.db";
+
+// Runs op count times and prints allocations and nanoseconds per call.
+template <typename Op>
+void measure(const char *name, std::uint64_t count, Op op) {
+  const std::uint64_t before = allocations;
+  auto start = std::chrono::steady_clock::now();
+  for (std::uint64_t i = 0; i < count; i++) op(i);
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cout << name << "\t" << (double)(allocations - before) / count << "\t"
+            << elapsed.count() / count << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const PageId pages = argc > 1 ? std::atoi(argv[1]) : 2000;
+  const std::uint32_t frames = argc > 2 ? std::atoi(argv[2]) : 200;
+
+  try {
+    File::remove(kFilename);
+  } catch (const FileNotFoundException &) {
+  }
+
+  {
+    File file = File::create(kFilename);
+    for (PageId i = 0; i < pages; i++) file.allocatePage();
+
+    std::cout << "operation\t\tallocs/op\tns/op\n";
+    measure("File::readPage\t", pages, [&file, pages](std::uint64_t i) {
+      Page page = file.readPage(1 + i % pages);
+      (void)page;
+    });
+    measure("FileIterator deref", pages, [&file](std::uint64_t) {
+      static FileIterator iter = file.begin();
+      if (iter == file.end()) iter = file.begin();
+      Page page = *iter;
+      ++iter;
+      (void)page;
+    });
+    Page source = file.readPage(1);
+    measure("Page copy\t", 100000, [&source](std::uint64_t) {
+      Page copy = source;
+      asm volatile("" : : "r"(&copy) : "memory");
+    });
+
+    BufMgr bufMgr(frames);
+    Page *page;
+    // Warm up so that the file is attached and the pool is full.
+    for (PageId pageNo = 1; pageNo <= frames; pageNo++) {
+      bufMgr.readPage(file, pageNo, page);
+      bufMgr.unPinPage(file, pageNo, false);
+    }
+    measure("BufMgr miss\t", pages, [&](std::uint64_t i) {
+      const PageId pageNo = 1 + (frames + i) % pages;
+      bufMgr.readPage(file, pageNo, page);
+      bufMgr.unPinPage(file, pageNo, false);
+    });
+    const PageId resident = 1 + (frames + pages - 1) % pages;
+    measure("BufMgr hit\t", 100000, [&](std::uint64_t) {
+      bufMgr.readPage(file, resident, page);
+      bufMgr.unPinPage(file, resident, false);
+    });
+    bufMgr.flushFile(file);
+  }
+
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,119 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+// Reads random pages of a single file with 1 to 16 threads, all through the
+// same File object, and prints the total rate.  The "latched" column takes
+// one mutex around every read, as a shared seek-then-read stream would need;
+// the "pread" column reads without any.  The "BufMgr" column pins and unpins
+// the pages through a buffer manager with 16 shards and frames for a quarter
+// of the file, so three of four reads miss, each one a File read made with
+// no buffer manager latch held.  The file stays in the page cache, so this
+// measures the read path, and parallelism needs as many cores.
+//
+// Usage: bench/parallel_reads [pages] [reads per thread]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+#include "file.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_parallelreads.db";
+
+// Runs threads readers and returns pages per second over all of them.
+double run(File &file, PageId pages, unsigned threads, std::uint64_t reads,
+           std::mutex *latch) {
+  std::vector<std::thread> readers;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned t = 0; t < threads; t++) {
+    readers.emplace_back([&file, pages, reads, latch, t]() {
+      Page page{Page::Uninitialized()};
+      std::mt19937 rng(t);
+      std::uniform_int_distribution<PageId> any(1, pages);
+      for (std::uint64_t i = 0; i < reads; i++) {
+        const PageId pageNo = any(rng);
+        if (latch != nullptr) {
+          std::lock_guard<std::mutex> guard(*latch);
+          file.readPage(pageNo, page);
+        } else {
+          file.readPage(pageNo, page);
+        }
+      }
+    });
+  }
+  for (std::thread &reader : readers) reader.join();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return threads * reads / elapsed.count();
+}
+
+// Like run(), but reads through the buffer manager.
+double runBufMgr(File &file, PageId pages, unsigned threads,
+                 std::uint64_t reads) {
+  BufMgr bufMgr(pages / 4, 16);
+  std::vector<std::thread> readers;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned t = 0; t < threads; t++) {
+    readers.emplace_back([&bufMgr, &file, pages, reads, t]() {
+      Page *page;
+      std::mt19937 rng(t);
+      std::uniform_int_distribution<PageId> any(1, pages);
+      for (std::uint64_t i = 0; i < reads; i++) {
+        const PageId pageNo = any(rng);
+        bufMgr.readPage(file, pageNo, page);
+        bufMgr.unPinPage(file, pageNo, false);
+      }
+    });
+  }
+  for (std::thread &reader : readers) reader.join();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return threads * reads / elapsed.count();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const PageId pages = argc > 1 ? std::atoi(argv[1]) : 10000;
+  const std::uint64_t reads = argc > 2 ? std::atoll(argv[2]) : 100000;
+
+  try {
+    File::remove(kFilename);
+  } catch (const FileNotFoundException &) {
+  }
+
+  {
+    File file = File::create(kFilename);
+    Page page{Page::Uninitialized()};
+    for (PageId i = 0; i < pages; i++) file.allocatePage(page);
+
+    std::cout << "threads\tlatched\tpread\tBufMgr\t(pages/s, "
+              << std::thread::hardware_concurrency() << " cores)\n";
+    for (unsigned threads = 1; threads <= 16; threads *= 2) {
+      std::mutex latch;
+      std::cout << threads << "\t"
+                << (int)run(file, pages, threads, reads, &latch) << "\t"
+                << (int)run(file, pages, threads, reads, nullptr) << "\t"
+                << (int)runBufMgr(file, pages, threads, reads) << "\n";
+    }
+  }
+
+  File::remove(kFilename);
+  return 0;
+}
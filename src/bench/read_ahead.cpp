@@ -0,0 +1,90 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+// Scans a file through the buffer pool without read-ahead, with sequential
+// read-ahead, and with read-ahead for half of the scans interleaved with
+// random reads, and reports throughput together with how many prefetched
+// pages were used.  Tune ReadAheadConfig with the prefetched and unused
+// columns.
+//
+// Usage: bench/read_ahead [pages] [frames] [max_window]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_readahead.db";
+
+void run(const char *name, File &file, PageId pages, std::uint32_t frames,
+         std::uint32_t maxWindow, bool randomReads) {
+  BufMgr bufMgr(frames);
+  if (maxWindow > 0) {
+    ReadAheadConfig config;
+    config.maxWindow = maxWindow;
+    bufMgr.enableReadAhead(config);
+  }
+
+  std::mt19937 rng(3);
+  std::uniform_int_distribution<PageId> any(1, pages);
+  Page *page;
+  auto start = std::chrono::steady_clock::now();
+  for (PageId pageNo = 1; pageNo <= pages; pageNo++) {
+    bufMgr.readPage(file, pageNo, page);
+    bufMgr.unPinPage(file, pageNo, false);
+    if (randomReads) {
+      PageId other = any(rng);
+      bufMgr.readPage(file, other, page);
+      bufMgr.unPinPage(file, other, false);
+    }
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  bufMgr.flushFile(file);
+  BufStats stats = bufMgr.getBufStats();
+  double mb = (double)pages * Page::SIZE / (1024 * 1024);
+  std::cout << name << "\t" << mb / elapsed.count() << "\t" << stats.hits
+            << "\t" << stats.prefetched << "\t" << stats.prefetchUnused
+            << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const PageId pages = argc > 1 ? std::atoi(argv[1]) : 5000;
+  const std::uint32_t frames = argc > 2 ? std::atoi(argv[2]) : 500;
+  const std::uint32_t maxWindow = argc > 3 ? std::atoi(argv[3]) : 64;
+
+  try {
+    File::remove(kFilename);
+  } catch (const FileNotFoundException &) {
+  }
+
+  {
+    File file = File::create(kFilename);
+    for (PageId i = 0; i < pages; i++) file.allocatePage();
+
+    std::cout << "mode\t\tscan_MB/s\thits\tprefetched\tunused\n";
+    run("off\t", file, pages, frames, 0, false);
+    run("read-ahead", file, pages, frames, maxWindow, false);
+    run("off+random", file, pages, frames, 0, true);
+    run("ra+random", file, pages, frames, maxWindow, true);
+  }
+
+  File::remove(kFilename);
+  return 0;
+}
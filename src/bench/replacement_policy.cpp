@@ -0,0 +1,118 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+// Reports the hit ratio of every replacement policy on a few access patterns:
+// a skewed OLTP mix, the same mix interrupted by full-file scans, and a loop
+// slightly larger than the buffer pool.
+//
+// Usage: bench/replacement_policy [pages] [frames] [accesses]
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_policy.db";
+
+// 90% of the accesses go to 10% of the pages.
+std::vector<PageId> oltp(PageId pages, std::uint64_t accesses) {
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<PageId> hot(1, pages / 10);
+  std::uniform_int_distribution<PageId> any(1, pages);
+  std::uniform_int_distribution<int> coin(0, 9);
+  std::vector<PageId> trace;
+  for (std::uint64_t i = 0; i < accesses; i++) {
+    trace.push_back(coin(rng) == 0 ? any(rng) : hot(rng));
+  }
+  return trace;
+}
+
+// The OLTP mix with a scan of the whole file after every tenth of it.
+std::vector<PageId> oltpWithScans(PageId pages, std::uint64_t accesses) {
+  std::vector<PageId> base = oltp(pages, accesses);
+  std::vector<PageId> trace;
+  for (std::uint64_t i = 0; i < base.size(); i++) {
+    if (i % (accesses / 10) == 0) {
+      for (PageId p = 1; p <= pages; p++) trace.push_back(p);
+    }
+    trace.push_back(base[i]);
+  }
+  return trace;
+}
+
+// A cyclic scan over 25% more pages than fit in the pool.
+std::vector<PageId> loop(PageId pages, std::uint32_t frames,
+                         std::uint64_t accesses) {
+  PageId length = std::min<PageId>(pages, frames + frames / 4);
+  std::vector<PageId> trace;
+  for (std::uint64_t i = 0; i < accesses; i++) trace.push_back(1 + i % length);
+  return trace;
+}
+
+double hitRatio(File &file, std::uint32_t frames, ReplacementPolicyType policy,
+                const std::vector<PageId> &trace) {
+  BufMgr bufMgr(frames, 1, policy);
+  Page *page;
+  for (PageId pageNo : trace) {
+    bufMgr.readPage(file, pageNo, page);
+    bufMgr.unPinPage(file, pageNo, false);
+  }
+  double ratio = bufMgr.getBufStats().hitRatio();
+  bufMgr.flushFile(file);
+  return ratio;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const PageId pages = argc > 1 ? std::atoi(argv[1]) : 5000;
+  const std::uint32_t frames = argc > 2 ? std::atoi(argv[2]) : 500;
+  const std::uint64_t accesses = argc > 3 ? std::atoll(argv[3]) : 200000;
+  const ReplacementPolicyType policies[] = {
+      ReplacementPolicyType::CLOCK, ReplacementPolicyType::LRU,
+      ReplacementPolicyType::LRU_K, ReplacementPolicyType::TWO_Q,
+      ReplacementPolicyType::ARC,   ReplacementPolicyType::CLOCK_PRO};
+
+  try {
+    File::remove(kFilename);
+  } catch (const FileNotFoundException &) {
+  }
+
+  {
+    File file = File::create(kFilename);
+    for (PageId i = 0; i < pages; i++) file.allocatePage();
+
+    const std::vector<PageId> traces[] = {oltp(pages, accesses),
+                                          oltpWithScans(pages, accesses),
+                                          loop(pages, frames, accesses)};
+
+    std::cout << "policy\t\toltp\toltp+scan\tloop\n" << std::fixed
+              << std::setprecision(4);
+    for (ReplacementPolicyType policy : policies) {
+      std::cout << std::left << std::setw(10) << ReplacementPolicy::name(policy)
+                << "\t";
+      for (const std::vector<PageId> &trace : traces) {
+        std::cout << hitRatio(file, frames, policy, trace) << "\t";
+      }
+      std::cout << "\n";
+    }
+  }
+
+  File::remove(kFilename);
+  return 0;
+}
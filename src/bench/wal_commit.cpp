@@ -0,0 +1,114 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+// Compares two ways of making a change to a random page durable.  "force"
+// unpins the page dirty and calls BufMgr::flushAll(), which writes the page
+// in place and syncs the file.  "wal" logs the whole page image with
+// BufMgr::logUpdate() and waits for LogManager::flush(), so the page stays
+// dirty in the pool and the commit costs a sequential log write; with more
+// committer threads, concurrent commits share one log sync.  Prints commits
+// per second and, for the log, commits per sync.
+//
+// Usage: bench/wal_commit [pages] [commits per thread]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_walcommit.db";
+const std::string kLogFilename = "bench_walcommit.log";
+
+// Runs threads committers that each change a random page commits times and
+// returns commits per second.
+double run(BufMgr &bufMgr, File &file, LogManager *log, PageId pages,
+           unsigned threads, std::uint32_t commits) {
+  std::vector<std::thread> committers;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned t = 0; t < threads; t++) {
+    committers.emplace_back([&bufMgr, &file, log, pages, commits, t]() {
+      std::mt19937 rng(t);
+      // Threads keep to their own pages, as transactions under row locks
+      // would.
+      std::uniform_int_distribution<PageId> any(0, pages / 16 - 1);
+      for (std::uint32_t i = 0; i < commits; i++) {
+        const PageId pageNo = 1 + any(rng) * 16 + t;
+        Page *page;
+        bufMgr.readPage(file, pageNo, page);
+        page->updateRecord({pageNo, 1}, "commit " + std::to_string(i));
+        if (log != nullptr) {
+          const Lsn lsn = bufMgr.logUpdate(file, pageNo);
+          bufMgr.unPinPage(file, pageNo, true);
+          log->flush(lsn);
+        } else {
+          bufMgr.unPinPage(file, pageNo, true);
+          bufMgr.flushAll();
+        }
+      }
+    });
+  }
+  for (std::thread &committer : committers) committer.join();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return threads * commits / elapsed.count();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const PageId pages = argc > 1 ? std::atoi(argv[1]) : 4096;
+  const std::uint32_t commits = argc > 2 ? std::atoi(argv[2]) : 1000;
+
+  try {
+    File::remove(kFilename);
+  } catch (const FileNotFoundException &) {
+  }
+  std::remove(kLogFilename.c_str());
+
+  {
+    File file = File::create(kFilename);
+    for (PageId i = 0; i < pages; i++) {
+      Page page = file.allocatePage();
+      page.insertRecord("commit");
+      file.writePage(page);
+    }
+
+    std::cout << "threads\tforce/s\twal/s\tcommits per sync\n";
+    for (unsigned threads = 1; threads <= 16; threads *= 4) {
+      double force;
+      {
+        BufMgr bufMgr(pages);
+        force = run(bufMgr, file, nullptr, pages, threads, commits);
+      }
+
+      LogManager log(kLogFilename);
+      BufMgr bufMgr(pages);
+      bufMgr.enableLogging(log);
+      const double wal = run(bufMgr, file, &log, pages, threads, commits);
+      const LogStats stats = log.getStats();
+      std::cout << threads << "\t" << (int)force << "\t" << (int)wal << "\t"
+                << (double)stats.appends / stats.flushes << "\n";
+      bufMgr.flushFile(file);
+    }
+  }
+
+  File::remove(kFilename);
+  std::remove(kLogFilename.c_str());
+  return 0;
+}
@@ -8,9 +8,7 @@
 
 #include "bufHashTbl.h"
 
-#include <functional>
-#include <iostream>
-#include <memory>
+#include <cstdint>
 
 #include "buffer.h"
 #include "exceptions/hash_already_present_exception.h"
@@ -19,74 +17,72 @@
 
 namespace badgerdb {
 
-int BufHashTbl::hash(const File& file, const PageId pageNo) {
-  auto hash =
-      std::hash<std::string>{}(file.filename()) ^ std::hash<PageId>{}(pageNo);
-  return hash % HTSIZE;
+BufHashTbl::BufHashTbl(const std::uint32_t maxEntries) : count(0) {
+  int bits = 1;
+  while ((std::uint64_t(1) << bits) < 2 * std::uint64_t(maxEntries)) bits++;
+  HTSIZE = std::uint32_t(1) << bits;
+  shift = 64 - bits;
+  ht.assign(HTSIZE, hashBucket{hashBucket::EMPTY_KEY, 0});
 }
 
-BufHashTbl::BufHashTbl(int htSize) : HTSIZE(htSize), ht(htSize) {
-  // allocate an array of pointers to hashBuckets
+std::uint32_t BufHashTbl::find(const PageKey key) const {
+  const std::uint32_t mask = HTSIZE - 1;
+  for (std::uint32_t index = hash(key);; index = (index + 1) & mask) {
+    if (ht[index].key == hashBucket::EMPTY_KEY) return HTSIZE;
+    if (ht[index].key == key) return index;
+  }
 }
 
-void BufHashTbl::insert(const File& file, const PageId pageNo,
-                        const FrameId frameNo) {
-  int index = hash(file, pageNo);
-
-  std::shared_ptr<hashBucket> tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-      throw HashAlreadyPresentException(tmpBuc->file.filename(), tmpBuc->pageNo,
-                                        tmpBuc->frameNo);
-    tmpBuc = tmpBuc->next;
+void BufHashTbl::insert(const PageKey key, const FrameId frameNo) {
+  const std::uint32_t mask = HTSIZE - 1;
+  if (count == HTSIZE || key == hashBucket::EMPTY_KEY) {
+    throw HashTableException();
   }
 
-  tmpBuc = std::make_shared<hashBucket>();
-  if (!tmpBuc) throw HashTableException();
-
-  tmpBuc->file = file;
-  tmpBuc->pageNo = pageNo;
-  tmpBuc->frameNo = frameNo;
-  tmpBuc->next = ht[index];
-  ht[index] = tmpBuc;
-}
-
-void BufHashTbl::lookup(const File& file, const PageId pageNo,
-                        FrameId& frameNo) {
-  int index = hash(file, pageNo);
-  std::shared_ptr<hashBucket> tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo) {
-      frameNo = tmpBuc->frameNo;  // return frameNo by reference
-      return;
-    }
-    tmpBuc = tmpBuc->next;
+  std::uint32_t index = hash(key);
+  while (ht[index].key != hashBucket::EMPTY_KEY) {
+    if (ht[index].key == key)
+      throw HashAlreadyPresentException(File::filename(pageKeyFile(key)),
+                                        pageKeyPage(key), ht[index].frameNo);
+    index = (index + 1) & mask;
   }
 
-  throw HashNotFoundException(file.filename(), pageNo);
+  ht[index] = hashBucket{key, frameNo};
+  count++;
 }
 
-void BufHashTbl::remove(const File& file, const PageId pageNo) {
-  int index = hash(file, pageNo);
-  std::shared_ptr<hashBucket> tmpBuc = ht[index];
-  std::shared_ptr<hashBucket> prevBuc;
+void BufHashTbl::lookup(const PageKey key, FrameId& frameNo) {
+  if (!tryLookup(key, frameNo))
+    throw HashNotFoundException(File::filename(pageKeyFile(key)),
+                                pageKeyPage(key));
+}
 
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo) {
-      if (prevBuc)
-        prevBuc->next = tmpBuc->next;
-      else
-        ht[index] = tmpBuc->next;
+void BufHashTbl::remove(const PageKey key) {
+  if (!tryRemove(key))
+    throw HashNotFoundException(File::filename(pageKeyFile(key)),
+                                pageKeyPage(key));
+}
 
-      tmpBuc.reset();
-      return;
-    } else {
-      prevBuc = tmpBuc;
-      tmpBuc = tmpBuc->next;
+bool BufHashTbl::tryRemove(const PageKey key) {
+  std::uint32_t hole = find(key);
+  if (hole == HTSIZE) return false;
+
+  // Backward-shift deletion: walk the rest of the probe run and move every
+  // entry that may legally sit in the hole into it, until an empty bucket
+  // ends the run.
+  const std::uint32_t mask = HTSIZE - 1;
+  for (std::uint32_t next = (hole + 1) & mask;
+       ht[next].key != hashBucket::EMPTY_KEY; next = (next + 1) & mask) {
+    std::uint32_t home = hash(ht[next].key);
+    // The entry can move if its home bucket is not cyclically in (hole, next].
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      ht[hole] = ht[next];
+      hole = next;
     }
   }
-
-  throw HashNotFoundException(file.filename(), pageNo);
+  ht[hole] = hashBucket{hashBucket::EMPTY_KEY, 0};
+  count--;
+  return true;
 }
 
 }  // namespace badgerdb
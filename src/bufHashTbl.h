@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
 #include "file.h"
@@ -16,94 +17,147 @@ namespace badgerdb {
 
 /**
  * @brief Declarations for buffer pool hash table
+ *
+ * Buckets are plain values stored inline in the table.  A bucket whose key is
+ * EMPTY_KEY is empty; that key names page Page::INVALID_NUMBER of file 0,
+ * which is never cached.  Probes check for an empty bucket before comparing
+ * keys, so looking that key up finds nothing, and inserting it is refused.
  */
 struct hashBucket {
   /**
-   * pointer a file object (more on this below)
+   * Key of an empty bucket
    */
-  File file;
+  static const PageKey EMPTY_KEY = 0;
 
   /**
-   * page number within a file
+   * (file, page number) of the page, see makePageKey()
    */
-  PageId pageNo;
+  PageKey key;
 
   /**
    * frame number of page in the buffer pool
    */
   FrameId frameNo;
-
-  /**
-   * Next node in the hash table
-   */
-  std::shared_ptr<hashBucket> next;
 };
 
 /**
  * @brief Hash table class to keep track of pages in the buffer pool
  *
+ * Open addressing with linear probing over a power-of-two array of buckets.
+ * Entries are deleted by shifting the rest of their probe run backwards, so
+ * no tombstones are left behind and lookups never slow down over time.
+ * The table is sized for a fixed maximum number of entries (one per buffer
+ * frame) and never grows.
+ *
  * @warning This class is not threadsafe.
  */
 class BufHashTbl {
  private:
   /**
-   *	Size of Hash Table
+   *	Size of Hash Table, always a power of two
    */
-  int HTSIZE;
+  std::uint32_t HTSIZE;
+
+  /**
+   * Number of bits to shift a 64-bit hash right by to get a bucket index
+   */
+  int shift;
+
+  /**
+   * Number of entries currently in the table
+   */
+  std::uint32_t count;
+
   /**
    * Actual Hash table object
    */
-  std::vector<std::shared_ptr<hashBucket>> ht;
+  std::vector<hashBucket> ht;
 
   /**
-   * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
+   * returns hash value between 0 and HTSIZE-1 computed using the page key
    *
-   * @param file   	File object
-   * @param pageNo  Page number in the file
+   * @param key   	Key of the page
    * @return  			Hash value.
    */
-  int hash(const File& file, const PageId pageNo);
+  std::uint32_t hash(const PageKey key) const {
+    // Fibonacci hashing: the multiply spreads every input bit into the high
+    // bits, which select the bucket.
+    return (key * 0x9E3779B97F4A7C15ULL) >> shift;
+  }
+
+  /**
+   * Returns the index of the bucket holding the key, or HTSIZE if the entry is
+   * not in the table.
+   *
+   * @param key   	Key of the page
+   * @return  			Bucket index or HTSIZE.
+   */
+  std::uint32_t find(const PageKey key) const;
 
  public:
   /**
    * Constructor of BufHashTbl class
+   *
+   * @param maxEntries  Largest number of entries the table has to hold. The
+   * table is sized to the next power of two of at least twice this value.
    */
-  BufHashTbl(const int htSize);  // constructor
+  BufHashTbl(const std::uint32_t maxEntries);  // constructor
 
   /**
    * Insert entry into hash table mapping (file, pageNo) to frameNo.
    *
-   * @param file   	File object
-   * @param pageNo 	Page number in the file
+   * @param key   	Key of the page, see makePageKey()
    * @param frameNo Frame number assigned to that page of the file
    * @throws  HashAlreadyPresentException	if the corresponding page
    * already exists in the hash table
-   * @throws  HashTableException (optional) if could not create a new bucket as
-   * running of memory
+   * @throws  HashTableException if the table already holds as many entries
+   * as it has buckets
    */
-  void insert(const File& file, const PageId pageNo, const FrameId frameNo);
+  void insert(const PageKey key, const FrameId frameNo);
 
   /**
    * Check if (file, pageNo) is currently in the buffer pool (ie. in
    * the hash table).
    *
-   * @param file  	File object
-   * @param pageNo	Page number in the file
+   * @param key   	Key of the page, see makePageKey()
    * @param frameNo Frame number reference
    * @throws HashNotFoundException if the page entry is not found in the hash
    * table
    */
-  void lookup(const File& file, const PageId pageNo, FrameId& frameNo);
+  void lookup(const PageKey key, FrameId& frameNo);
+
+  /**
+   * Like lookup(), but reports a missing entry by its return value instead of
+   * an exception, which makes it cheap enough for the miss path.
+   *
+   * @param key   	Key of the page, see makePageKey()
+   * @param frameNo Frame number reference, set only if the entry is found
+   * @return  			True if the entry was found
+   */
+  bool tryLookup(const PageKey key, FrameId& frameNo) const {
+    const std::uint32_t index = find(key);
+    if (index == HTSIZE) return false;
+    frameNo = ht[index].frameNo;
+    return true;
+  }
 
   /**
    * Delete entry (file,pageNo) from hash table.
    *
-   * @param file   	File object
-   * @param pageNo  Page number in the file
+   * @param key   	Key of the page, see makePageKey()
    * @throws HashNotFoundException if the page entry is not found in the hash
    * table
    */
-  void remove(const File& file, const PageId pageNo);
+  void remove(const PageKey key);
+
+  /**
+   * Like remove(), but reports a missing entry by its return value instead
+   * of an exception.
+   *
+   * @param key   	Key of the page, see makePageKey()
+   * @return  			True if the entry was found and removed
+   */
+  bool tryRemove(const PageKey key);
 };
 
 }  // namespace badgerdb
@@ -8,248 +8,1590 @@
 
 #include "buffer.h"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <set>
 
 #include "exceptions/bad_buffer_exception.h"
+#include "exceptions/badgerdb_exception.h"
 #include "exceptions/buffer_exceeded_exception.h"
-#include "exceptions/hash_not_found_exception.h"
+#include "exceptions/corrupt_page_exception.h"
+#include "exceptions/hash_already_present_exception.h"
+#include "exceptions/invalid_page_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
+#include "file_iterator.h"
 
 namespace badgerdb {
 
-constexpr int HASHTABLE_SZ(int bufs) { return ((int)(bufs * 1.2) & -2) + 1; }
-
 //----------------------------------------
 // Constructor of the class BufMgr
 //----------------------------------------
 
-BufMgr::BufMgr(std::uint32_t bufs)
+BufMgr::BufMgr(std::uint32_t bufs, std::uint32_t numShards,
+               ReplacementPolicyType policy, bool hugePages)
     : numBufs(bufs),
-      hashTable(HASHTABLE_SZ(bufs)),
+      anyFreeSpaceMap(false),
+      log(nullptr),
       bufDescTable(bufs),
-      bufPool(bufs) {
+      dirtyFrames(0),
+      bgStop(false),
+      bgHighFrames(NO_BG_WRITER),
+      cpStop(false),
+      prefetchStop(false),
+      prefetchActive(File::INVALID_ID),
+      frameLatches(new std::shared_timed_mutex[bufs]),
+      bufPool(bufs, hugePages) {
+  readAheadConfig.maxWindow = 0;
   for (FrameId i = 0; i < bufs; i++) {
     bufDescTable[i].frameNo = i;
     bufDescTable[i].valid = false;
   }
 
-  clockHand = bufs - 1;
+  if (numShards == 0) numShards = 1;
+  if (numShards > bufs) numShards = bufs;
+
+  // Spread the frames as evenly as possible; the first (bufs % numShards)
+  // shards get one extra frame.
+  FrameId first = 0;
+  for (std::uint32_t s = 0; s < numShards; s++) {
+    std::uint32_t frames = bufs / numShards + (s < bufs % numShards ? 1 : 0);
+    shards.emplace_back(new BufShard(first, frames, policy));
+    first += frames;
+  }
+}
+
+BufMgr::~BufMgr() {
+  stopBgWriter();
+  stopCheckpointer();
+
+  {
+    std::lock_guard<std::mutex> prefetchGuard(prefetchLatch);
+    prefetchStop = true;
+  }
+  prefetchWakeup.notify_one();
+  if (prefetcher.joinable()) prefetcher.join();
+
+  for (std::unique_ptr<BufShard>& shard : shards) {
+    std::unique_lock<std::mutex> shardGuard(shard->latch);
+    shard->ioDone.wait(shardGuard,
+                       [&shard]() { return shard->readsInFlight == 0; });
+  }
+
+  // Nobody else can reach the files of the free-space maps, so write the
+  // maps out here.
+  for (std::unique_ptr<FreeSpaceMap>& map : freeSpaceMaps) {
+    if (!map) continue;
+    try {
+      flushFile(map->file());
+    } catch (const BadgerDbException& e) {
+      // A stale map only makes callers find pages that turn out to be full.
+    }
+  }
 }
 
-void BufMgr::advanceClock() {
-  clockHand = (clockHand + 1) % numBufs;
+BufShard& BufMgr::shardOf(const PageKey key) {
+  if (shards.size() == 1) return *shards[0];
+
+  // Use a different multiplier than BufHashTbl so that the shard choice is
+  // independent of the bucket chosen by the shard's own hash table.
+  std::uint64_t hash = key * 0xC2B2AE3D27D4EB4FULL;
+  return *shards[(hash >> 32) % shards.size()];
+}
+
+BufShard& BufMgr::shardOfFrame(const FrameId frameNo) {
+  // Mirrors the split in the constructor: the first (numBufs % shards)
+  // shards hold one frame more than the others.
+  const std::uint32_t numShards = shards.size();
+  const std::uint32_t small = numBufs / numShards;
+  const std::uint32_t large = numBufs % numShards;
+  if (frameNo < large * (small + 1)) {
+    return *shards[frameNo / (small + 1)];
+  }
+  return *shards[large + (frameNo - large * (small + 1)) / small];
+}
+
+void BufMgr::attachFile(File& file) {
+  const FileId fileId = file.id();
+  if (fileId >= fileTable.size()) {
+    fileTable.resize(fileId + 1);
+    fileFrames.resize(fileId + 1, 0);
+  }
+  if (fileFrames[fileId]++ == 0) {
+    fileTable[fileId] = file;
+  }
+}
+
+void BufMgr::detachFile(const FileId fileId) {
+  if (--fileFrames[fileId] == 0) {
+    if (log != nullptr) {
+      // Pages written since the last sync may still be in the page cache.
+      closedFiles.push_back(fileTable[fileId].filename());
+    }
+    fileTable[fileId] = File();
+  }
 }
 
-void BufMgr::allocBuf(FrameId &frame)
+void BufMgr::allocBuf(BufShard &shard,
+                      std::unique_lock<std::mutex> &shardGuard,
+                      const PageKey key, FrameId &frame)
 {
-  bool openFrameFound = false;
-  int counter = -1;
-  while (counter < (int)numBufs && openFrameFound == false)
+  FrameId local;
+  if (!shard.replacer->evict(key, local))
   {
-    counter++;
-    advanceClock();
-    if (bufDescTable[clockHand].valid == true)
-    {
-      if (bufDescTable[clockHand].refbit == true)
-      {
-        bufDescTable[clockHand].refbit = false;
-        continue; // advance clock and try again
-      }
-      else if (bufDescTable[clockHand].pinCnt > 0)
-      {
-        continue; // advance clock and try again
-      }
-      else if (bufDescTable[clockHand].refbit == false && bufDescTable[clockHand].pinCnt == 0)
-      {
-        // Use the frame
-        frame = clockHand;
+    throw BufferExceededException();
+  }
+  frame = shard.firstFrame + local;
 
-        if (bufDescTable[clockHand].dirty)
-        {
-          // Flush page to disk
-          bufDescTable[clockHand].file.writePage(bufPool[frame]);
-        }
-        hashTable.remove(bufDescTable[clockHand].file, bufDescTable[clockHand].pageNo);
-      }
-      openFrameFound = true;
-      bufDescTable[clockHand].clear();
+  BufDesc &desc = bufDescTable[frame];
+  if (!desc.valid)
+  {
+    desc.clear();
+    return;
+  }
+  if (desc.prefetched) shard.bufStats.prefetchUnused++;
+  const PageKey victim = desc.key();
+  const FileId fileId = desc.fileId;
+  const PageId pageNo = desc.pageNo;
+  bool dirty = desc.dirty;
+  Lsn recLsn = desc.recLsn;
+  // A clean page may still be on its way to disk in cleanFrames(); if that
+  // write fails, the frame holds the only copy.
+  const std::multimap<PageKey, Lsn>::iterator cleaning =
+      shard.writesInFlight.find(victim);
+  if (cleaning != shard.writesInFlight.end())
+  {
+    dirty = true;
+    recLsn = std::min(recLsn, cleaning->second);
+  }
+  if (desc.dirty) dirtyFrames--;
+  shard.hashTable.remove(victim);
+  desc.clear();
+  if (dirty)
+  {
+    // Flush page to disk, after the log records of its changes.  The frame
+    // is reserved, so the page stays put while the shard latch is released
+    // for the log flush, which may wait out a group commit, and the write;
+    // requests for the page wait until it reached the file.
+    const std::multimap<PageKey, Lsn>::iterator write =
+        startWrite(shard, shardGuard, victim, recLsn);
+    File file = fileOf(fileId);
+    shardGuard.unlock();
+    try
+    {
+      forceLog(bufPool[frame].lsn());
+      file.writePage(bufPool[frame]);
     }
-    else
+    catch (...)
     {
-      // Use the frame
-      frame = clockHand;
-      openFrameFound = true;
-      bufDescTable[clockHand].clear();
+      // Keep the page, still dirty, so that a later eviction tries again
+      shardGuard.lock();
+      desc.Set(fileId, pageNo);
+      desc.pinCnt = 0;
+      desc.dirty = true;
+      desc.recLsn = recLsn;
+      dirtyFrames++;
+      shard.hashTable.insert(victim, frame);
+      shard.replacer->fill(local, victim);
+      shard.replacer->unpin(local);
+      finishWrite(shard, write);
+      throw;
     }
+    shardGuard.lock();
+    shard.bufStats.diskwrites++;
+    finishWrite(shard, write);
   }
-  if (openFrameFound == false)
+  std::lock_guard<std::mutex> ioGuard(ioLatch);
+  detachFile(fileId);
+}
+
+bool BufMgr::reserveFrame(BufShard &shard,
+                          std::unique_lock<std::mutex> &shardGuard,
+                          const PageKey key, FrameId &frameNo)
+{
+  bool reserved = false;
+  FrameId frame = 0;
+  while (true)
   {
-    throw BufferExceededException();
+    if (shard.hashTable.tryLookup(key, frameNo))
+    {
+      // Read in by someone else while the latch was released
+      if (reserved) shard.replacer->erase(frame - shard.firstFrame);
+      return true;
+    }
+    if (shard.writesInFlight.count(key) > 0)
+    {
+      shard.ioDone.wait(shardGuard);
+    }
+    else if (!reserved)
+    {
+      allocBuf(shard, shardGuard, key, frame);
+      reserved = true;
+    }
+    else
+    {
+      frameNo = frame;
+      return false;
+    }
   }
 }
 
+void BufMgr::publishFrame(BufShard &shard, const FrameId frameNo, File &file,
+                          const PageId pageNo)
+{
+  shard.hashTable.insert(makePageKey(file.id(), pageNo), frameNo);
+  bufDescTable[frameNo].Set(file.id(), pageNo);
+  bufDescTable[frameNo].ioPending = true;
+  shard.readsInFlight++;
+  std::lock_guard<std::mutex> ioGuard(ioLatch);
+  attachFile(file);
+}
+
+std::multimap<PageKey, Lsn>::iterator BufMgr::startWrite(
+    BufShard &shard, std::unique_lock<std::mutex> &shardGuard,
+    const PageKey key, const Lsn recLsn)
+{
+  const std::multimap<PageKey, Lsn>::iterator write =
+      shard.writesInFlight.emplace(key, recLsn);
+  // Writes of the same page are kept in the order they were started in
+  shard.ioDone.wait(shardGuard, [&shard, key, write]() {
+    return shard.writesInFlight.lower_bound(key) == write;
+  });
+  return write;
+}
+
+void BufMgr::finishWrite(BufShard &shard,
+                         std::multimap<PageKey, Lsn>::iterator write)
+{
+  shard.writesInFlight.erase(write);
+  shard.ioDone.notify_all();
+}
+
+File BufMgr::fileOf(const FileId fileId)
+{
+  std::lock_guard<std::mutex> ioGuard(ioLatch);
+  return fileTable[fileId];
+}
+
 void BufMgr::readPage(File &file, const PageId pageNo, Page *&page)
 {
+  if (pageNo == Page::INVALID_NUMBER) {
+    throw InvalidPageException(pageNo, file.filename());
+  }
+  const PageKey key = makePageKey(file.id(), pageNo);
+  BufShard &shard = shardOf(key);
+  std::unique_lock<std::mutex> shardGuard(shard.latch);
+  shard.bufStats.accesses++;
 
-  FrameId frameNo; // to be filled in by hashTable.lookup
-  // check if page is in the hashtable
-  try
+  FrameId frameNo; // to be filled in by reserveFrame
+  // Check if page is in hashTable, reserving a frame if it is not
+  bool found = reserveFrame(shard, shardGuard, key, frameNo);
+  // Wait for a read of the page in progress; if it failed the page is gone
+  // again and read below
+  while (found && bufDescTable[frameNo].ioPending)
+  {
+    shard.ioDone.wait(shardGuard);
+    found = reserveFrame(shard, shardGuard, key, frameNo);
+  }
+  if (found)
   {
-    // Check if page is in hashTable
-    hashTable.lookup(file, pageNo, frameNo);
     // Case 2
 
     // set the appropriate refbit
     bufDescTable[frameNo].refbit = true;
     // increment the pinCnt for the page
     bufDescTable[frameNo].pinCnt++;
+    shard.replacer->access(frameNo - shard.firstFrame);
+    shard.bufStats.hits++;
+    if (bufDescTable[frameNo].prefetched)
+    {
+      bufDescTable[frameNo].prefetched = false;
+      readAhead(file, pageNo, true);
+    }
   }
-  catch (HashNotFoundException& e)
+  else
   {
     // Case 1
-    // Call allocBuf() to allocate a buffer frame
-    allocBuf(frameNo);
+    // The frame is published as pending, so that concurrent requests for
+    // the page wait for this read, and the page is read from disk without
+    // any latch held.
+    publishFrame(shard, frameNo, file, pageNo);
+    readAhead(file, pageNo, false);
+    shardGuard.unlock();
 
     // Call the method file.readPage() to read the page
     // from disk into the buffer pool frame.
-    Page newPage = file.readPage(pageNo);
-    // Add newPage to bufPool at the index 'frameNo'
-    bufPool[frameNo] = newPage;
-
-    // Next, insert the page into the hashtable
-    hashTable.insert(file, pageNo, frameNo);
-
-    // Finally, invoke Set() on the frame to set it up properly
-    bufDescTable[frameNo].Set(file, pageNo);
+    try
+    {
+      file.readPage(pageNo, bufPool[frameNo]);
+    }
+    catch (...)
+    {
+      // Give the frame back, it holds no page
+      completeRead(shard, frameNo, std::current_exception());
+      throw;
+    }
+    completeRead(shard, frameNo, nullptr);
   }
     // Return a pointer to the frame containing 
     // the page via the page parameter.
     page = &bufPool[frameNo];
 }
 
+void BufMgr::readPageAsync(File& file, const PageId pageNo, PageCallback done) {
+  if (pageNo == Page::INVALID_NUMBER) {
+    done(nullptr, std::make_exception_ptr(
+                      InvalidPageException(pageNo, file.filename())));
+    return;
+  }
+  const PageKey key = makePageKey(file.id(), pageNo);
+  BufShard& shard = shardOf(key);
+  std::unique_lock<std::mutex> shardGuard(shard.latch);
+  shard.bufStats.accesses++;
+
+  FrameId frameNo;
+  bool found;
+  try {
+    found = reserveFrame(shard, shardGuard, key, frameNo);
+  } catch (...) {
+    shardGuard.unlock();
+    done(nullptr, std::current_exception());
+    return;
+  }
+  if (found) {
+    BufDesc& desc = bufDescTable[frameNo];
+    desc.pinCnt++;
+    shard.bufStats.hits++;
+    if (desc.ioPending) {
+      // Already being read; completeRead() hands over the pin
+      shard.ioWaiters[frameNo].push_back(std::move(done));
+      return;
+    }
+    desc.refbit = true;
+    shard.replacer->access(frameNo - shard.firstFrame);
+    if (desc.prefetched) {
+      desc.prefetched = false;
+      readAhead(file, pageNo, true);
+    }
+    shardGuard.unlock();
+    done(&bufPool[frameNo], nullptr);
+    return;
+  }
+
+  // Publish the frame right away so that concurrent requests for the page
+  // wait for this read instead of starting their own.
+  publishFrame(shard, frameNo, file, pageNo);
+  shard.ioWaiters[frameNo].push_back(std::move(done));
+  readAhead(file, pageNo, false);
+  shardGuard.unlock();
+
+  // The frame is pinned and pending, so nothing else touches bufPool[frameNo]
+  // until the read completed.
+  file.readPageAsync(pageNo, bufPool[frameNo],
+                     [this, &shard, frameNo](std::exception_ptr error) {
+                       completeRead(shard, frameNo, error);
+                     });
+}
+
+std::future<Page*> BufMgr::readPageAsync(File& file, const PageId pageNo) {
+  std::shared_ptr<std::promise<Page*>> promise =
+      std::make_shared<std::promise<Page*>>();
+  std::future<Page*> page = promise->get_future();
+  readPageAsync(file, pageNo,
+                [promise](Page* page, std::exception_ptr error) {
+                  if (error) {
+                    promise->set_exception(error);
+                  } else {
+                    promise->set_value(page);
+                  }
+                });
+  return page;
+}
+
+void BufMgr::completeRead(BufShard& shard, const FrameId frameNo,
+                          std::exception_ptr error) {
+  std::vector<PageCallback> waiters;
+  {
+    std::lock_guard<std::mutex> shardGuard(shard.latch);
+    BufDesc& desc = bufDescTable[frameNo];
+    waiters.swap(shard.ioWaiters[frameNo]);
+    shard.ioWaiters.erase(frameNo);
+    desc.ioPending = false;
+    if (!error) {
+      shard.bufStats.diskreads++;
+      shard.replacer->fill(frameNo - shard.firstFrame,
+                           makePageKey(desc.fileId, desc.pageNo));
+      // Pins of the waiters are released by them
+    } else {
+      std::lock_guard<std::mutex> ioGuard(ioLatch);
+      shard.hashTable.remove(makePageKey(desc.fileId, desc.pageNo));
+      detachFile(desc.fileId);
+      desc.clear();
+      shard.replacer->erase(frameNo - shard.firstFrame);
+    }
+  }
+  shard.ioDone.notify_all();
+
+  Page* page = error ? nullptr : &bufPool[frameNo];
+  for (PageCallback& waiter : waiters) {
+    waiter(page, error);
+  }
+
+  // Notify under the latch: once it is released the destructor may go ahead.
+  std::lock_guard<std::mutex> shardGuard(shard.latch);
+  shard.readsInFlight--;
+  shard.ioDone.notify_all();
+}
+
 void BufMgr::unPinPage(File &file, const PageId pageNo, const bool dirty)
 {
-  try
+  const PageKey key = makePageKey(file.id(), pageNo);
+  BufShard &shard = shardOf(key);
+  FreeSpaceMap *map = dirty ? freeSpaceMapOf(file.id()) : nullptr;
+  std::uint16_t space = 0;
   {
+    std::lock_guard<std::mutex> shardGuard(shard.latch);
     // Check if page is in hashTable
-    FrameId frameNum; // to be replaced by the hashTable.lookup
-    hashTable.lookup(file, pageNo, frameNum);
+    FrameId frameNum; // to be replaced by the hashTable.tryLookup
+    if (!shard.hashTable.tryLookup(key, frameNum))
+    {
+      // Does nothing if page is not found in the hash table lookup.
+      return;
+    }
+    // The caller's pin keeps the page in place while it is measured
+    if (map != nullptr && bufDescTable[frameNum].pinCnt > 0)
+    {
+      space = bufPool[frameNum].getFreeSpaceForRecord();
+    }
 
-    if (bufDescTable[frameNum].pinCnt == 0)
+    if (!unpinFrame(shard, frameNum, dirty))
     {
       // Throws PAGENOTPINNED if the pin count is already 0
       throw PageNotPinnedException(file.filename_, pageNo, frameNum);
     }
-    else if (bufDescTable[frameNum].pinCnt > 0)
-    {
-      // Decrements the pinCnt of the frame
-      --bufDescTable[frameNum].pinCnt;
+  }
+  recordFreeSpace(map, pageNo, space);
+}
+
+void BufMgr::readPages(File& file, const std::vector<PageId>& pageNos,
+                       std::vector<Page*>& pages) {
+  std::vector<FrameId> frames(pageNos.size());
+  // Misses as (page number, frame), the frames pinned so far, and the
+  // indexes of pageNos that hit a frame whose read is still in progress
+  std::vector<std::pair<PageId, FrameId>> misses;
+  std::vector<FrameId> pinned;
+  std::vector<std::size_t> pending;
+  std::exception_ptr error;
+
+  // Look every page up, pinning hits and reserving frames for misses.  The
+  // reserved frames are published as pending, like those of readPageAsync(),
+  // so a repeated page or a concurrent reader shares the one read.  Pending
+  // frames are only waited for once our own reads are done, so that two
+  // batches cannot wait for each other.
+  for (std::size_t i = 0; i < pageNos.size() && !error; i++) {
+    if (pageNos[i] == Page::INVALID_NUMBER) {
+      error = std::make_exception_ptr(
+          InvalidPageException(pageNos[i], file.filename()));
+      break;
+    }
+    const PageKey key = makePageKey(file.id(), pageNos[i]);
+    BufShard& shard = shardOf(key);
+    std::unique_lock<std::mutex> shardGuard(shard.latch);
+    shard.bufStats.accesses++;
+
+    FrameId frameNo;
+    bool found;
+    try {
+      found = reserveFrame(shard, shardGuard, key, frameNo);
+    } catch (...) {
+      error = std::current_exception();
+      break;
+    }
+    if (found) {
+      BufDesc& desc = bufDescTable[frameNo];
+      desc.refbit = true;
+      desc.pinCnt++;
+      desc.prefetched = false;
+      if (desc.ioPending) {
+        pending.push_back(i);
+      } else {
+        shard.replacer->access(frameNo - shard.firstFrame);
+      }
+      shard.bufStats.hits++;
+    } else {
+      publishFrame(shard, frameNo, file, pageNos[i]);
+      misses.emplace_back(pageNos[i], frameNo);
+    }
+    frames[i] = frameNo;
+    pinned.push_back(frameNo);
+  }
+
+  // Read the misses in page order, one vectored read per run of consecutive
+  // pages.  A failed run frees its frames.
+  std::sort(misses.begin(), misses.end());
+  std::vector<Page*> run;
+  for (std::size_t first = 0; first < misses.size();) {
+    std::size_t last = first + 1;
+    while (last < misses.size() &&
+           misses[last].first == misses[last - 1].first + 1) {
+      last++;
+    }
+    std::exception_ptr runError = error;
+    if (!runError) {
+      run.clear();
+      for (std::size_t m = first; m < last; m++) {
+        run.push_back(&bufPool[misses[m].second]);
+      }
+      try {
+        file.readPages(misses[first].first, run.size(), run.data());
+      } catch (...) {
+        runError = error = std::current_exception();
+      }
+    }
+    for (std::size_t m = first; m < last; m++) {
+      completeRead(shardOfFrame(misses[m].second), misses[m].second, runError);
     }
-    if (dirty)
+    first = last;
+  }
+
+  // A failed read of a pending frame frees it, taking our pin with it.
+  for (const std::size_t i : pending) {
+    BufShard& shard = shardOfFrame(frames[i]);
+    std::unique_lock<std::mutex> shardGuard(shard.latch);
+    const BufDesc& desc = bufDescTable[frames[i]];
+    shard.ioDone.wait(shardGuard, [&desc]() { return !desc.ioPending; });
+    if (!error && !(desc.valid && desc.fileId == file.id() &&
+                    desc.pageNo == pageNos[i])) {
+      error = std::make_exception_ptr(
+          InvalidPageException(pageNos[i], file.filename()));
+    }
+  }
+
+  if (error) {
+    // Drop the pins still held; frames of failed reads are gone already.
+    for (std::size_t i = 0; i < pinned.size(); i++) {
+      BufShard& shard = shardOfFrame(pinned[i]);
+      std::lock_guard<std::mutex> shardGuard(shard.latch);
+      const BufDesc& desc = bufDescTable[pinned[i]];
+      if (desc.valid && desc.fileId == file.id() &&
+          desc.pageNo == pageNos[i]) {
+        unpinFrame(shard, pinned[i], false);
+      }
+    }
+    std::rethrow_exception(error);
+  }
+
+  pages.resize(pageNos.size());
+  for (std::size_t i = 0; i < pageNos.size(); i++) {
+    pages[i] = &bufPool[frames[i]];
+  }
+}
+
+bool BufMgr::unpinFrame(BufShard &shard, const FrameId frameNo,
+                        const bool dirty)
+{
+  BufDesc &desc = bufDescTable[frameNo];
+  if (desc.pinCnt == 0)
+  {
+    return false;
+  }
+  // Decrements the pinCnt of the frame
+  if (--desc.pinCnt == 0)
+  {
+    shard.replacer->unpin(frameNo - shard.firstFrame);
+  }
+  if (dirty && !desc.dirty)
+  {
+    // if dirty == true, sets the dirty bit
+    desc.dirty = true;
+    // Wake the background writer once too many frames are dirty
+    if (++dirtyFrames > bgHighFrames)
     {
-      // if dirty == true, sets the dirty bit
-      bufDescTable[frameNum].dirty = true;
+      bgWakeup.notify_one();
     }
   }
-  catch (HashNotFoundException &e)
+  return true;
+}
+
+void BufMgr::unpinGuarded(const FrameId frameNo, const bool exclusive,
+                          const bool dirty) {
+  // Measure the page while the latch still keeps other writers out
+  FreeSpaceMap* map =
+      dirty ? freeSpaceMapOf(bufDescTable[frameNo].fileId) : nullptr;
+  const PageId pageNo = bufDescTable[frameNo].pageNo;
+  const std::uint16_t space =
+      map != nullptr ? bufPool[frameNo].getFreeSpaceForRecord() : 0;
+  if (exclusive) {
+    frameLatches[frameNo].unlock();
+  } else {
+    frameLatches[frameNo].unlock_shared();
+  }
   {
-    // Does nothing if page is not found in the hash table lookup.
-    return;
+    BufShard& shard = shardOfFrame(frameNo);
+    std::lock_guard<std::mutex> shardGuard(shard.latch);
+    unpinFrame(shard, frameNo, dirty);
   }
+  recordFreeSpace(map, pageNo, space);
+}
+
+ReadPageGuard BufMgr::readPageGuard(File& file, const PageId pageNo) {
+  Page* page;
+  readPage(file, pageNo, page);
+  // Latch only after the shard latch is released; waiting for a writer must
+  // not hold up the shard.
+  const FrameId frameNo = bufPool.frameOf(page);
+  frameLatches[frameNo].lock_shared();
+  return ReadPageGuard(this, frameNo, page);
+}
+
+WritePageGuard BufMgr::writePageGuard(File& file, const PageId pageNo) {
+  Page* page;
+  readPage(file, pageNo, page);
+  const FrameId frameNo = bufPool.frameOf(page);
+  frameLatches[frameNo].lock();
+  return WritePageGuard(this, frameNo, page);
+}
+
+WritePageGuard BufMgr::allocPageGuard(File& file, PageId& pageNo) {
+  Page* page;
+  allocPage(file, pageNo, page);
+  const FrameId frameNo = bufPool.frameOf(page);
+  frameLatches[frameNo].lock();
+  return WritePageGuard(this, frameNo, page);
 }
 
 void BufMgr::allocPage(File &file, PageId &pageNo, Page *&page)
 {
-  // The first step in this method is to allocate an empty page
-  // in the specified file by invoking the file.allocatePage() method
-  // This method will return a newly allocated page.
-  Page newPage = file.allocatePage();
-
-  // Then allocBuf() is called to obtain a buffer pool frame.
+  // The page is allocated straight into its frame, but the frame comes from
+  // the shard of the page, so find out which page the file will hand out
+  // next and publish a frame for it.  The file allocates only that page; if
+  // another allocation got in first, try again with the new page number.
   FrameId newFrameId;
-  allocBuf(newFrameId);
-  // add newPage to bufPool based on newFrameId index
-  bufPool[newFrameId] = newPage;
+  while (true)
+  {
+    const PageId nextPage = file.nextAllocatedPage();
+    const PageKey key = makePageKey(file.id(), nextPage);
+    BufShard &shard = shardOf(key);
+    std::unique_lock<std::mutex> shardGuard(shard.latch);
+
+    // Then reserveFrame() is called to obtain a buffer pool frame.
+    if (reserveFrame(shard, shardGuard, key, newFrameId))
+    {
+      if (bufDescTable[newFrameId].ioPending)
+      {
+        // Another allocation of the page is in progress
+        shard.ioDone.wait(shardGuard);
+      }
+      else if (file.nextAllocatedPage() == nextPage)
+      {
+        // A free page cannot be in the buffer pool
+        throw HashAlreadyPresentException(file.filename(), nextPage,
+                                          newFrameId);
+      }
+      // Otherwise the page was allocated since it was looked up
+      continue;
+    }
+    publishFrame(shard, newFrameId, file, nextPage);
+    shardGuard.unlock();
+
+    // allocate the page in the file, initializing the frame as the new page
+    bool allocated;
+    try
+    {
+      allocated = file.allocatePage(nextPage, bufPool[newFrameId]);
+    }
+    catch (...)
+    {
+      completeRead(shard, newFrameId, std::current_exception());
+      throw;
+    }
+    if (!allocated)
+    {
+      // Requests for the page that came in meanwhile find it does not exist
+      completeRead(shard, newFrameId,
+                   std::make_exception_ptr(
+                       InvalidPageException(nextPage, file.filename())));
+      continue;
+    }
+    shardGuard.lock();
+    shard.bufStats.accesses++;
+    shardGuard.unlock();
+    completeRead(shard, newFrameId, nullptr);
+    break;
+  }
 
   // The method returns both the page number of the
   // newly allocated page to the caller via the pageNo
   // parameter and a pointer to the buffer frame allocated
   // for the page via the page parameter.
   page = &bufPool[newFrameId];
-  pageNo = newPage.page_number();
+  pageNo = page->page_number();
+  recordFreeSpace(freeSpaceMapOf(file.id()), pageNo,
+                  page->getFreeSpaceForRecord());
 
-  // Next, an entry is inserted into the hash table and Set() is
-  // invoked on the frame to set it up properly
-  hashTable.insert(file, pageNo, newFrameId);
-  bufDescTable[newFrameId].Set(file, pageNo);
+  // A reused page is empty on disk but older records may still describe
+  // its last life; logging the new header makes recovery end up with an
+  // empty page all the same.
+  if (log != nullptr) logUpdate(file, pageNo, 0, sizeof(PageHeader));
 }
 
-void BufMgr::flushFile(File &file)
+std::vector<std::unique_lock<std::mutex>> BufMgr::lockAllShards()
 {
-  // Scan bufTable for pages belonging to the file
-  // for (BufDesc frame : bufDescTable)
-  for (u_int32_t i = 0; i < numBufs; i++)
+  // Always in shard order; every other path holds at most one shard latch.
+  std::vector<std::unique_lock<std::mutex>> guards;
+  for (std::unique_ptr<BufShard> &shard : shards)
   {
-    //if page is dirty call file.writepage() then set dirty bit to false
-    if (bufDescTable[i].file == file)
+    guards.emplace_back(shard->latch);
+  }
+  return guards;
+}
+
+void BufMgr::writeBack(std::vector<FrameId> &frames)
+{
+  // Sort by file and page so that neighbouring pages form runs, each written
+  // with one vectored write.
+  std::sort(frames.begin(), frames.end(), [this](FrameId a, FrameId b) {
+    return bufDescTable[a].key() < bufDescTable[b].key();
+  });
+
+  // The log goes first, once for all of the pages
+  Lsn lsn = 0;
+  for (const FrameId frame : frames)
+  {
+    lsn = std::max(lsn, bufPool[frame].lsn());
+  }
+  forceLog(lsn);
+
+  std::vector<Page *> run;
+  std::vector<File> synced;
+  for (std::size_t first = 0; first < frames.size();)
+  {
+    const BufDesc &head = bufDescTable[frames[first]];
+    std::size_t last = first + 1;
+    while (last < frames.size() &&
+           bufDescTable[frames[last]].fileId == head.fileId &&
+           bufDescTable[frames[last]].pageNo ==
+               bufDescTable[frames[last - 1]].pageNo + 1)
+    {
+      last++;
+    }
+    run.clear();
+    for (std::size_t i = first; i < last; i++)
+    {
+      run.push_back(&bufPool[frames[i]]);
+    }
+    if (synced.empty() || synced.back().id() != head.fileId)
     {
-      if (bufDescTable[i].valid == false)
+      synced.push_back(fileOf(head.fileId));
+    }
+    synced.back().writePages(head.pageNo, run.size(), run.data());
+    for (std::size_t i = first; i < last; i++)
+    {
+      shardOfFrame(frames[i]).bufStats.diskwrites++;
+      bufDescTable[frames[i]].dirty = false;
+      bufDescTable[frames[i]].recLsn = BufDesc::NO_REC_LSN;
+      dirtyFrames--;
+    }
+    first = last;
+  }
+
+  // One sync per file, after all of its writes
+  for (File &file : synced)
+  {
+    file.sync();
+  }
+}
+
+void BufMgr::flushFile(File &file)
+{
+  // The free-space map of the file goes first, with its own file
+  FreeSpaceMap *map = freeSpaceMapOf(file.id());
+  if (map != nullptr)
+  {
+    flushFile(map->file());
+  }
+
+  // Pages the prefetcher reads after this point would be left behind
+  cancelPrefetch(file.id());
+
+  // The log records of the pages are most likely all appended by now; make
+  // them durable before taking the latches, so that writeBack() finds
+  // nothing left to wait for
+  flushLogAhead();
+
+  std::vector<std::unique_lock<std::mutex>> shardGuards = lockAllShards();
+  // Writes of pages of the file that are in progress have to reach the file
+  // before the pages are written again and the file is synced
+  for (std::size_t s = 0; s < shards.size(); s++)
+  {
+    BufShard &shard = *shards[s];
+    shard.ioDone.wait(shardGuards[s], [&shard, &file]() {
+      for (const std::pair<const PageKey, Lsn> &write : shard.writesInFlight)
       {
-        throw BadBufferException(bufDescTable[i].frameNo, bufDescTable[i].dirty, bufDescTable[i].valid, bufDescTable[i].refbit);
+        if (pageKeyFile(write.first) == file.id()) return false;
       }
+      return true;
+    });
+  }
+
+  // Scan bufTable for pages belonging to the file; check all of them before
+  // writing any
+  std::vector<FrameId> frames;
+  std::vector<FrameId> dirty;
+  for (FrameId i = 0; i < numBufs; i++)
+  {
+    if (bufDescTable[i].valid && bufDescTable[i].fileId == file.id())
+    {
       // Throws PagePinnedException if some page of the file is pinned.
       if (bufDescTable[i].pinCnt > 0)
       {
-        throw PagePinnedException(bufDescTable[i].file.filename(), bufDescTable[i].pageNo, bufDescTable[i].frameNo);
-      }
-      if (bufDescTable[i].dirty)
-      {
-        // if the page is dirty, call file.writePage() to flush the page to disk
-        // and then set the dirty bit for the page to false
-
-        // file.writePage(bufDescTable[i].pageNo, Page)
-        // bufDescTable[i].file.writePage(bufDescTable[i].pageNo, bufDescTable[i].pageNo);
-        bufDescTable[i].file.writePage(bufPool[i]);
-        bufDescTable[i].dirty = false;
+        throw PagePinnedException(file.filename(), bufDescTable[i].pageNo, bufDescTable[i].frameNo);
       }
       // Throws BadBufferException if an invalid page belonging to the file is encountered
       if (Page::INVALID_NUMBER == bufDescTable[i].pageNo)
       {
         throw BadBufferException(bufDescTable[i].frameNo, bufDescTable[i].dirty, bufDescTable[i].valid, bufDescTable[i].refbit);
       }
-      // remove the page from the hashtable (whether the page is clean or dirty)
-      hashTable.remove(bufDescTable[i].file, bufDescTable[i].pageNo);
+      frames.push_back(i);
+      if (bufDescTable[i].dirty)
+      {
+        dirty.push_back(i);
+      }
+    }
+  }
+
+  // Write the dirty pages back in page order and sync the file once
+  writeBack(dirty);
+
+  std::lock_guard<std::mutex> ioGuard(ioLatch);
+  for (const FrameId i : frames)
+  {
+    BufShard &shard = shardOfFrame(i);
+    if (bufDescTable[i].prefetched)
+    {
+      shard.bufStats.prefetchUnused++;
+    }
+    // remove the page from the hashtable (whether the page was clean or dirty)
+    shard.hashTable.remove(bufDescTable[i].key());
+
+    // invoke the Clear() method of BufDesc for the page frame
+    bufDescTable[i].clear();
+    shard.replacer->erase(i - shard.firstFrame);
+    detachFile(file.id());
+  }
+}
+
+void BufMgr::flushAll()
+{
+  flushLogAhead();
+  std::vector<std::unique_lock<std::mutex>> shardGuards = lockAllShards();
 
-      // invoke the Clear() method of BufDesc for the page frame
-      bufDescTable[i].clear();
+  std::vector<FrameId> dirty;
+  for (FrameId i = 0; i < numBufs; i++)
+  {
+    const BufDesc &desc = bufDescTable[i];
+    // A page whose older version is still being written is left to the
+    // next flush, so that the two writes cannot reach the file out of order
+    if (desc.valid && desc.dirty && desc.pinCnt == 0 &&
+        shardOfFrame(i).writesInFlight.count(desc.key()) == 0)
+    {
+      dirty.push_back(i);
     }
   }
+  writeBack(dirty);
 }
 
 void BufMgr::disposePage(File& file, const PageId PageNo) {
-  try {
+  if (PageNo == Page::INVALID_NUMBER) {
+    throw InvalidPageException(PageNo, file.filename());
+  }
+  const PageKey key = makePageKey(file.id(), PageNo);
+  BufShard& shard = shardOf(key);
+  {
+    std::unique_lock<std::mutex> shardGuard(shard.latch);
     FrameId frameNo; // blank frameNo to use for search
-    hashTable.lookup(file, PageNo, frameNo);
-    hashTable.remove(file, PageNo);
-    bufDescTable[frameNo].clear();
-  } catch (HashNotFoundException& e) {
-    // not found, move on...
+    bool found = shard.hashTable.tryLookup(key, frameNo);
+    // Wait for a read of the page to finish
+    while (found && bufDescTable[frameNo].ioPending) {
+      shard.ioDone.wait(shardGuard);
+      found = shard.hashTable.tryLookup(key, frameNo);
+    }
+    if (found) {
+      shard.hashTable.remove(key);
+      if (bufDescTable[frameNo].dirty) dirtyFrames--;
+      if (bufDescTable[frameNo].prefetched) shard.bufStats.prefetchUnused++;
+      bufDescTable[frameNo].clear();
+      shard.replacer->erase(frameNo - shard.firstFrame);
+      std::lock_guard<std::mutex> ioGuard(ioLatch);
+      detachFile(file.id());
+    }
+
+    // Delete page from file.  Counted as a write of the page, so that it
+    // comes after writes of the page in progress and is not read back
+    // before it is done.
+    const std::multimap<PageKey, Lsn>::iterator write =
+        startWrite(shard, shardGuard, key, BufDesc::NO_REC_LSN);
+    shardGuard.unlock();
+    try {
+      file.deletePage(PageNo);
+    } catch (...) {
+      shardGuard.lock();
+      finishWrite(shard, write);
+      throw;
+    }
+    shardGuard.lock();
+    finishWrite(shard, write);
+  }
+  // A free page has no room for records
+  recordFreeSpace(freeSpaceMapOf(file.id()), PageNo, 0);
+}
+
+void BufMgr::enableLogging(LogManager& logManager) { log = &logManager; }
+
+Lsn BufMgr::logUpdate(File& file, const PageId pageNo,
+                      const std::uint16_t offset, const std::uint16_t length) {
+  if (log == nullptr) return 0;
+
+  const PageKey key = makePageKey(file.id(), pageNo);
+  BufShard& shard = shardOf(key);
+  FrameId frameNo = 0;
+  // Set for the first change since the page was clean: every write of the
+  // page that a crash can tear comes after such a record, and a checkpoint
+  // never moves the redo LSN past it while the page is dirty.
+  bool wholePage = false;
+  {
+    std::lock_guard<std::mutex> shardGuard(shard.latch);
+    if (!shard.hashTable.tryLookup(key, frameNo) ||
+        bufDescTable[frameNo].pinCnt == 0) {
+      throw PageNotPinnedException(file.filename_, pageNo, frameNo);
+    }
+    BufDesc& desc = bufDescTable[frameNo];
+    // The record goes after everything logged so far.  Taken under the
+    // shard latch, so that a checkpoint sees either this recLsn or a redo
+    // LSN no later than it.
+    if (desc.recLsn == BufDesc::NO_REC_LSN) {
+      desc.recLsn = log->lastLsn();
+      wholePage = true;
+    }
+    // A logged change must reach the file before the frame is reused.
+    if (!desc.dirty) {
+      desc.dirty = true;
+      dirtyFrames++;
+    }
+  }
+
+  // The caller's pin keeps the page in its frame, and the caller is the one
+  // changing it.
+  Page& page = bufPool[frameNo];
+  const std::string& name = file.filename();
+  PageUpdateRecord header;
+  header.type = LogRecordType::PAGE_UPDATE;
+  header.offset = wholePage ? 0 : std::min<std::size_t>(offset, Page::SIZE);
+  header.length = wholePage
+                      ? Page::SIZE
+                      : std::min<std::size_t>(length,
+                                              Page::SIZE - header.offset);
+  header.nameLength = name.size();
+  header.pageNo = pageNo;
+  std::vector<char> record(sizeof(header) + header.length + name.size());
+  std::memcpy(&record[0], &header, sizeof(header));
+  std::memcpy(&record[sizeof(header)],
+              reinterpret_cast<const char*>(&page) + header.offset,
+              header.length);
+  std::memcpy(&record[sizeof(header) + header.length], name.data(),
+              name.size());
+
+  const Lsn lsn = log->append(record.data(), record.size());
+  page.set_lsn(lsn);
+  return lsn;
+}
+
+void BufMgr::forceLog(const Lsn lsn) {
+  if (log != nullptr) log->flush(lsn);
+}
+
+void BufMgr::flushLogAhead() {
+  if (log != nullptr) log->flushAll();
+}
+
+void BufMgr::checkpoint() {
+  if (log == nullptr) return;
+  runCheckpoint(0, true /* always */);
+}
+
+void BufMgr::runCheckpoint(const Lsn writeBelow, const bool always) {
+  const auto start = std::chrono::steady_clock::now();
+  const std::uint32_t written = writeBelow > 0 ? writeOldPages(writeBelow) : 0;
+
+  // Changes logged after this point are covered by the redo LSN.  Every
+  // other change not on disk has its recLsn in the dirty page table, which
+  // is read one shard at a time.
+  Lsn redoLsn = log->lastLsn();
+  for (std::unique_ptr<BufShard>& shard : shards) {
+    std::lock_guard<std::mutex> shardGuard(shard->latch);
+    for (FrameId i = 0; i < shard->numFrames; i++) {
+      redoLsn = std::min(redoLsn, bufDescTable[shard->firstFrame + i].recLsn);
+    }
+    // Pages marked clean that are still being written
+    for (const std::pair<const PageKey, Lsn>& write : shard->writesInFlight) {
+      redoLsn = std::min(redoLsn, write.second);
+    }
+  }
+  {
+    std::lock_guard<std::mutex> cpGuard(cpLatch);
+    if (!always && written == 0 && redoLsn == cpStats.redoLsn) return;
+  }
+
+  // Every write that ended a recLsn or an entry of writesInFlight seen above
+  // has reached its file, which is either still attached or among the
+  // closed files, as writes detach their file only once they are done.
+  // Syncing those files makes the writes durable; the syncs run without
+  // ioLatch.
+  std::vector<File> files;
+  std::vector<std::string> closed;
+  {
+    std::lock_guard<std::mutex> ioGuard(ioLatch);
+    for (FileId fileId = 0; fileId < fileTable.size(); fileId++) {
+      if (fileFrames[fileId] > 0) files.push_back(fileTable[fileId]);
+    }
+    closed.swap(closedFiles);
+  }
+  try {
+    for (File& file : files) file.sync();
+    for (const std::string& name : closed) {
+      if (File::exists(name)) File::open(name).sync();
+    }
+    log->writeCheckpoint(redoLsn);
+  } catch (...) {
+    // The next checkpoint has to sync these files again.
+    std::lock_guard<std::mutex> ioGuard(ioLatch);
+    closedFiles.insert(closedFiles.end(), closed.begin(), closed.end());
+    throw;
+  }
+
+  const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+  std::lock_guard<std::mutex> cpGuard(cpLatch);
+  cpStats.checkpoints++;
+  cpStats.pagesWritten += written;
+  cpStats.lastPagesWritten = written;
+  cpStats.totalDuration += elapsed;
+  cpStats.lastDuration = elapsed;
+  cpStats.redoLsn = redoLsn;
+}
+
+std::uint32_t BufMgr::writeOldPages(const Lsn below) {
+  std::uint32_t written = 0;
+  std::vector<std::pair<Lsn, FrameId>> old;
+  std::vector<FrameId> frames;
+  for (std::unique_ptr<BufShard>& shard : shards) {
+    old.clear();
+    {
+      std::lock_guard<std::mutex> shardGuard(shard->latch);
+      for (FrameId i = 0; i < shard->numFrames; i++) {
+        const BufDesc& desc = bufDescTable[shard->firstFrame + i];
+        if (desc.valid && desc.dirty && desc.pinCnt == 0 &&
+            desc.recLsn < below) {
+          old.emplace_back(desc.recLsn, i);
+        }
+      }
+    }
+    std::sort(old.begin(), old.end());
+    frames.clear();
+    for (const std::pair<Lsn, FrameId>& page : old) {
+      frames.push_back(page.second);
+    }
+    written += cleanFrames(*shard, frames, 0 /* target */);
+  }
+  return written;
+}
+
+void BufMgr::startCheckpointer(const CheckpointConfig& config) {
+  if (log == nullptr) return;
+  std::lock_guard<std::mutex> cpGuard(cpLatch);
+  if (checkpointer.joinable()) return;
+
+  cpConfig = config;
+  cpStop = false;
+  checkpointer = std::thread(&BufMgr::checkpointLoop, this);
+}
+
+void BufMgr::stopCheckpointer() {
+  {
+    std::lock_guard<std::mutex> cpGuard(cpLatch);
+    if (!checkpointer.joinable()) return;
+    cpStop = true;
+  }
+  cpWakeup.notify_one();
+  checkpointer.join();
+}
+
+CheckpointStats BufMgr::getCheckpointStats() {
+  std::lock_guard<std::mutex> cpGuard(cpLatch);
+  return cpStats;
+}
+
+void BufMgr::checkpointLoop() {
+  std::unique_lock<std::mutex> cpGuard(cpLatch);
+  while (!cpStop) {
+    cpWakeup.wait_for(cpGuard, cpConfig.interval);
+    if (cpStop) break;
+    // Half of the log that can be replayed in the target time, so that the
+    // log written until the next checkpoint fits in the other half.
+    const Lsn budget = cpConfig.targetRecoveryTime.count() / 2000.0 *
+                       cpConfig.replayBytesPerSecond;
+    cpGuard.unlock();
+
+    const Lsn last = log->lastLsn();
+    try {
+      runCheckpoint(last > budget ? last - budget : 0, false /* always */);
+    } catch (const BadgerDbException& e) {
+      // Try again next round.
+    }
+
+    cpGuard.lock();
+  }
+}
+
+std::uint64_t BufMgr::recover(const std::string& logFilename) {
+  std::map<std::string, File> files;
+  // Torn pages that no whole-page image has rebuilt yet
+  std::set<std::pair<std::string, PageId>> torn;
+  std::uint64_t applied = 0;
+  LogManager::replay(
+      logFilename, LogManager::redoLsn(logFilename),
+      [&files, &torn, &applied](const Lsn lsn, const char* data,
+                                const std::uint32_t length) {
+        PageUpdateRecord header;
+        if (length < sizeof(header)) return;
+        std::memcpy(&header, data, sizeof(header));
+        if (header.type != LogRecordType::PAGE_UPDATE ||
+            length != sizeof(header) + header.length + header.nameLength) {
+          return;
+        }
+        const std::string name(data + sizeof(header) + header.length,
+                               header.nameLength);
+        auto found = files.find(name);
+        if (found == files.end()) {
+          if (!File::exists(name)) return;  // removed since
+          found = files.emplace(name, File::open(name)).first;
+        }
+        File& file = found->second;
+
+        const bool wholePage = header.length == Page::SIZE;
+        Page page{Page::Uninitialized()};
+        try {
+          page = file.readPage(header.pageNo);
+          if (page.lsn() >= lsn) return;  // the change is on disk
+        } catch (const InvalidPageException& e) {
+          // Past the end of the file as its header was last written: the
+          // page was allocated after that, and the first record of a new
+          // page is a whole image.  Otherwise the page was deleted since.
+          if (!wholePage || !file.redoAllocation(header.pageNo)) return;
+        } catch (const CorruptPageException& e) {
+          // Torn by the crash.  Only a whole-page image can rebuild it; the
+          // ranges logged before that have nothing to apply to.
+          if (!wholePage) {
+            torn.emplace(name, header.pageNo);
+            return;
+          }
+        }
+        torn.erase(std::make_pair(name, header.pageNo));
+
+        // The file keeps track of the page list itself.
+        std::memcpy(reinterpret_cast<char*>(&page) + header.offset,
+                    data + sizeof(header), header.length);
+        page.set_page_number(header.pageNo);
+        page.set_lsn(lsn);
+        try {
+          file.writePage(page);
+        } catch (const InvalidPageException& e) {
+          return;  // deleted since
+        }
+        applied++;
+      });
+
+  for (auto& entry : files) {
+    entry.second.sync();
+  }
+  if (!torn.empty()) {
+    throw CorruptPageException(torn.begin()->second, torn.begin()->first);
+  }
+  return applied;
+}
+
+FreeSpaceMap* BufMgr::freeSpaceMapOf(const FileId fileId) {
+  if (!anyFreeSpaceMap) return nullptr;
+  std::lock_guard<std::mutex> fsmGuard(fsmLatch);
+  return fileId < freeSpaceMaps.size() ? freeSpaceMaps[fileId].get()
+                                       : nullptr;
+}
+
+void BufMgr::recordFreeSpace(FreeSpaceMap* map, const PageId pageNo,
+                             const std::uint16_t space) {
+  if (map == nullptr) return;
+  try {
+    map->update(pageNo, space);
+  } catch (const BufferExceededException& e) {
+    // Every frame is pinned; the page keeps its old entry.
+  }
+}
+
+PageId BufMgr::findPageWithSpace(File& file, const std::size_t bytes) {
+  FreeSpaceMap* map = freeSpaceMapOf(file.id());
+  if (map != nullptr) return map->find(bytes);
+
+  bool build = false;
+  {
+    std::lock_guard<std::mutex> fsmGuard(fsmLatch);
+    if (file.id() >= freeSpaceMaps.size()) {
+      freeSpaceMaps.resize(file.id() + 1);
+    }
+    if (!freeSpaceMaps[file.id()]) {
+      const std::string mapFilename =
+          FreeSpaceMap::mapFilename(file.filename());
+      build = !File::exists(mapFilename);
+      freeSpaceMaps[file.id()].reset(new FreeSpaceMap(
+          *this, file,
+          build ? File::create(mapFilename) : File::open(mapFilename)));
+      anyFreeSpaceMap = true;
+    }
+    map = freeSpaceMaps[file.id()].get();
+  }
+
+  if (build) {
+    // Measure every used page, from the buffer pool if the page is there, as
+    // the copy on disk may be older.
+    for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+      const Page page = *iter;
+      std::uint16_t space = page.getFreeSpaceForRecord();
+      const PageKey key = makePageKey(file.id(), page.page_number());
+      BufShard& shard = shardOf(key);
+      {
+        std::lock_guard<std::mutex> shardGuard(shard.latch);
+        FrameId frameNo;
+        if (shard.hashTable.tryLookup(key, frameNo) &&
+            !bufDescTable[frameNo].ioPending) {
+          space = bufPool[frameNo].getFreeSpaceForRecord();
+        }
+      }
+      map->update(page.page_number(), space);
+    }
+  }
+  return map->find(bytes);
+}
+
+void BufMgr::startBgWriter(const BgWriterConfig& config) {
+  std::lock_guard<std::mutex> bgGuard(bgLatch);
+  if (bgWriter.joinable()) return;
+
+  bgConfig = config;
+  bgStop = false;
+  bgHighFrames = config.highWatermark * numBufs;
+  bgWriter = std::thread(&BufMgr::bgWriterLoop, this);
+}
+
+void BufMgr::stopBgWriter() {
+  {
+    std::lock_guard<std::mutex> bgGuard(bgLatch);
+    if (!bgWriter.joinable()) return;
+    bgStop = true;
+    bgHighFrames = NO_BG_WRITER;
+  }
+  bgWakeup.notify_one();
+  bgWriter.join();
+}
+
+void BufMgr::bgWriterLoop() {
+  std::vector<FrameId> victims;
+  std::unique_lock<std::mutex> bgGuard(bgLatch);
+  while (!bgStop) {
+    bgWakeup.wait_for(bgGuard, bgConfig.interval);
+    if (bgStop) break;
+    const std::uint32_t low = bgConfig.lowWatermark * numBufs;
+    const std::uint32_t high = bgHighFrames;
+    const std::uint32_t lookahead = bgConfig.lookahead;
+    bgGuard.unlock();
+
+    if (dirtyFrames > low) {
+      // Between the watermarks only the next few victims of every shard are
+      // cleaned; above the high watermark whole shards are, in victim order.
+      const bool flood = dirtyFrames > high;
+      for (std::unique_ptr<BufShard>& shard : shards) {
+        victims.clear();
+        {
+          std::lock_guard<std::mutex> shardGuard(shard->latch);
+          shard->replacer->nextVictims(flood ? shard->numFrames : lookahead,
+                                       victims);
+        }
+        cleanFrames(*shard, victims, low);
+      }
+    }
+
+    bgGuard.lock();
+  }
+}
+
+std::uint32_t BufMgr::cleanFrames(BufShard& shard,
+                                  const std::vector<FrameId>& frames,
+                                  const std::uint32_t target) {
+  std::uint32_t written = 0;
+  for (FrameId local : frames) {
+    if (dirtyFrames <= target) break;
+
+    std::unique_lock<std::mutex> shardGuard(shard.latch);
+    const FrameId frame = shard.firstFrame + local;
+    BufDesc& desc = bufDescTable[frame];
+    if (!desc.valid || !desc.dirty || desc.pinCnt > 0) continue;
+    const PageKey key = desc.key();
+    // Left to the writer that is already at it
+    if (shard.writesInFlight.count(key) > 0) continue;
+
+    // Write a copy so that the page can be pinned and modified again while
+    // the write is in progress.  Registering the write keeps the page from
+    // being read back from disk before the write reached the file.
+    const Page copy = bufPool[frame];
+    const Lsn recLsn = desc.recLsn;
+    desc.dirty = false;
+    desc.recLsn = BufDesc::NO_REC_LSN;
+    dirtyFrames--;
+    shard.bufStats.diskwrites++;
+    const std::multimap<PageKey, Lsn>::iterator write =
+        startWrite(shard, shardGuard, key, recLsn);
+    File file = fileOf(pageKeyFile(key));
+    shardGuard.unlock();
+    try {
+      forceLog(copy.lsn());
+      file.writePage(copy);
+      written++;
+    } catch (...) {
+      // Leave the page dirty so that the next writer tries again.
+      shardGuard.lock();
+      if (desc.valid && desc.key() == key) {
+        if (!desc.dirty) {
+          desc.dirty = true;
+          dirtyFrames++;
+        }
+        desc.recLsn = std::min(desc.recLsn, recLsn);
+      }
+      shard.bufStats.diskwrites--;
+      finishWrite(shard, write);
+      continue;
+    }
+    shardGuard.lock();
+    finishWrite(shard, write);
+  }
+  return written;
+}
+
+void BufMgr::prefetch(File& file, const PageId first,
+                      const std::uint32_t count) {
+  std::lock_guard<std::mutex> prefetchGuard(prefetchLatch);
+  queuePrefetch(file, first, count, false);
+}
+
+void BufMgr::enableReadAhead(const ReadAheadConfig& config) {
+  std::lock_guard<std::mutex> prefetchGuard(prefetchLatch);
+  readAheadConfig = config;
+}
+
+void BufMgr::disableReadAhead() {
+  std::lock_guard<std::mutex> prefetchGuard(prefetchLatch);
+  readAheadConfig.maxWindow = 0;
+  readAheadStates.clear();
+}
+
+void BufMgr::queuePrefetch(File& file, const PageId first,
+                           const std::uint32_t count, const bool readAhead) {
+  if (count == 0 || prefetchStop) return;
+  prefetchQueue.push_back(PrefetchRequest{file, first, count, readAhead});
+  if (!prefetcher.joinable()) {
+    prefetcher = std::thread(&BufMgr::prefetchLoop, this);
+  }
+  prefetchWakeup.notify_one();
+}
+
+void BufMgr::readAhead(File& file, const PageId pageNo,
+                       const bool prefetchHit) {
+  std::lock_guard<std::mutex> prefetchGuard(prefetchLatch);
+  const ReadAheadConfig& config = readAheadConfig;
+  if (config.maxWindow == 0) return;
+
+  if (file.id() >= readAheadStates.size()) {
+    readAheadStates.resize(file.id() + 1);
+  }
+  ReadAheadState& state = readAheadStates[file.id()];
+  const bool sequential = pageNo == state.expected;
+  state.expected = pageNo + 1;
+
+  if (!prefetchHit) {
+    if (!sequential) {
+      // A random read ends the run.
+      state.window = 0;
+      return;
+    }
+    // Start a run, or grow it if the prefetcher fell behind.
+    state.window = state.window == 0
+                       ? std::min(config.initialWindow, config.maxWindow)
+                       : std::min(2 * state.window, config.maxWindow);
+    if (state.ahead == Page::INVALID_NUMBER || state.ahead <= pageNo) {
+      state.ahead = pageNo + 1;
+    }
+  } else {
+    // Prefetched pages keep a run going; the next window is queued once the
+    // reader is halfway through the current one.
+    if (state.window == 0 || state.ahead > pageNo + state.window / 2) return;
+    state.window = std::min(2 * state.window, config.maxWindow);
+  }
+
+  const PageId end = pageNo + 1 + state.window;
+  if (end > state.ahead) {
+    queuePrefetch(file, state.ahead, end - state.ahead, true);
+    state.ahead = end;
+  }
+}
+
+void BufMgr::cancelPrefetch(const FileId fileId) {
+  std::unique_lock<std::mutex> prefetchGuard(prefetchLatch);
+  for (auto it = prefetchQueue.begin(); it != prefetchQueue.end();) {
+    if (it->file.id() == fileId) {
+      it = prefetchQueue.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (fileId < readAheadStates.size()) {
+    readAheadStates[fileId] = ReadAheadState();
+  }
+  prefetchDone.wait(prefetchGuard,
+                    [this, fileId]() { return prefetchActive != fileId; });
+}
+
+void BufMgr::prefetchLoop() {
+  std::unique_lock<std::mutex> prefetchGuard(prefetchLatch);
+  while (true) {
+    prefetchWakeup.wait(prefetchGuard, [this]() {
+      return prefetchStop || !prefetchQueue.empty();
+    });
+    if (prefetchStop) break;
+
+    PrefetchRequest request = prefetchQueue.front();
+    prefetchQueue.pop_front();
+    prefetchActive = request.file.id();
+    prefetchGuard.unlock();
+
+    for (std::uint32_t i = 0; i < request.count; i++) {
+      const PageId pageNo = request.first + i;
+      if (request.readAhead) {
+        // Reading pages the scan already went past would only evict others.
+        prefetchGuard.lock();
+        const FileId fileId = request.file.id();
+        const bool passed = fileId < readAheadStates.size() &&
+                            readAheadStates[fileId].expected > pageNo;
+        prefetchGuard.unlock();
+        if (passed) continue;
+      }
+      if (!prefetchPage(request.file, pageNo)) break;
+    }
+
+    prefetchGuard.lock();
+    prefetchActive = File::INVALID_ID;
+    prefetchDone.notify_all();
+  }
+}
+
+bool BufMgr::prefetchPage(File& file, const PageId pageNo) {
+  if (pageNo == Page::INVALID_NUMBER) return false;
+  const PageKey key = makePageKey(file.id(), pageNo);
+  BufShard& shard = shardOf(key);
+  std::unique_lock<std::mutex> shardGuard(shard.latch);
+
+  FrameId frameNo;
+  if (shard.hashTable.tryLookup(key, frameNo) ||
+      shard.writesInFlight.count(key) > 0) {
+    return true;  // in the buffer pool, or just evicted from it
+  }
+
+  if (!shard.replacer->hasFreeFrame()) {
+    // Make room by dropping the first clean page among the next victims,
+    // but never one that was prefetched and not read yet.  A page that
+    // cleanFrames() is still writing counts as dirty, as in allocBuf(): if
+    // the write fails, the frame holds the only copy.
+    std::vector<FrameId> victims;
+    shard.replacer->nextVictims(4, victims);
+    auto clean = std::find_if(
+        victims.begin(), victims.end(), [this, &shard](FrameId local) {
+          const BufDesc& desc = bufDescTable[shard.firstFrame + local];
+          return !desc.dirty && !desc.prefetched &&
+                 shard.writesInFlight.count(desc.key()) == 0;
+        });
+    if (clean == victims.end()) return false;
+
+    BufDesc& victim = bufDescTable[shard.firstFrame + *clean];
+    shard.hashTable.remove(victim.key());
+    {
+      std::lock_guard<std::mutex> ioGuard(ioLatch);
+      detachFile(victim.fileId);
+    }
+    victim.clear();
+    shard.replacer->erase(*clean);
+  }
+
+  // A free frame, so the latch is not released
+  allocBuf(shard, shardGuard, key, frameNo);
+  publishFrame(shard, frameNo, file, pageNo);
+  bufDescTable[frameNo].prefetched = true;
+  shardGuard.unlock();
+
+  std::exception_ptr error;
+  try {
+    file.readPage(pageNo, bufPool[frameNo]);
+  } catch (const BadgerDbException& e) {
+    // A read that needs the page reports what went wrong.
+    error = std::current_exception();
+  }
+  completeRead(shard, frameNo, error);
+  if (error) return false;
+
+  // Drop the pin of the read, unless the page was disposed of meanwhile
+  shardGuard.lock();
+  shard.bufStats.prefetched++;
+  const BufDesc& desc = bufDescTable[frameNo];
+  if (desc.valid && desc.key() == key) unpinFrame(shard, frameNo, false);
+  return true;
+}
+
+BufStats BufMgr::getBufStats() {
+  BufStats total;
+  for (std::unique_ptr<BufShard>& shard : shards) {
+    std::lock_guard<std::mutex> shardGuard(shard->latch);
+    total += shard->bufStats;
+  }
+  return total;
+}
+
+void BufMgr::clearBufStats() {
+  for (std::unique_ptr<BufShard>& shard : shards) {
+    std::lock_guard<std::mutex> shardGuard(shard->latch);
+    shard->bufStats.clear();
   }
-  
-  // Delete page from file
-  file.deletePage(PageNo);
 }
 
 void BufMgr::printSelf(void) {
   int validFrames = 0;
 
-  for (FrameId i = 0; i < numBufs; i++) {
-    std::cout << "FrameNo:" << i << " ";
-    bufDescTable[i].Print();
+  for (std::unique_ptr<BufShard>& shard : shards) {
+    std::lock_guard<std::mutex> shardGuard(shard->latch);
+    for (FrameId i = shard->firstFrame;
+         i < shard->firstFrame + shard->numFrames; i++) {
+      std::cout << "FrameNo:" << i << " ";
+      bufDescTable[i].Print();
 
-    if (bufDescTable[i].valid) validFrames++;
+      if (bufDescTable[i].valid) validFrames++;
+    }
   }
 
   std::cout << "Total Number of Valid Frames:" << validFrames << "\n";
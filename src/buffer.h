@@ -8,11 +8,29 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "bufHashTbl.h"
 #include "file.h"
+#include "frame_arena.h"
+#include "free_space_map.h"
+#include "log_manager.h"
+#include "page_guard.h"
+#include "replacement_policy.h"
 
 namespace badgerdb {
 
@@ -34,9 +52,9 @@ class BufDesc {
  private:
   friend class BufMgr;
   /**
-   * Pointer to file to which corresponding frame is assigned
+   * Identifier of the file to which corresponding frame is assigned
    */
-  File file;
+  FileId fileId;
 
   /**
    * Page within file to which corresponding frame is assigned
@@ -68,16 +86,42 @@ class BufDesc {
    */
   bool refbit;
 
+  /**
+   * True if the page was read by prefetching and has not been accessed since
+   */
+  bool prefetched;
+
+  /**
+   * True while the page is being read into the frame, or allocated in it,
+   * without the shard latch held
+   */
+  bool ioPending;
+
+  /**
+   * Log position from which the changes to the page that are not on disk yet
+   * are logged, NO_REC_LSN if there are none.  The recLsn of all frames is
+   * the dirty page table that checkpoints take their redo LSN from.
+   */
+  Lsn recLsn;
+
+  /**
+   * recLsn of a frame without logged changes that are not on disk
+   */
+  static const Lsn NO_REC_LSN = ~Lsn(0);
+
   /**
    * Initialize buffer frame for a new user
    */
   void clear() {
     pinCnt = 0;
-    file = File();
+    fileId = File::INVALID_ID;
     pageNo = Page::INVALID_NUMBER;
     dirty = false;
     refbit = false;
     valid = false;
+    prefetched = false;
+    ioPending = false;
+    recLsn = NO_REC_LSN;
   }
 
   /**
@@ -85,21 +129,29 @@ class BufDesc {
    * page in the file. Called when a frame in buffer pool is allocated to any
    * page in the file through readPage() or allocPage()
    *
-   * @param filePtr	File object
+   * @param file	File identifier
    * @param pageNum	Page number in the file
    */
-  void Set(File& file, PageId pageNum) {
-    this->file = file;
+  void Set(FileId file, PageId pageNum) {
+    fileId = file;
     pageNo = pageNum;
     pinCnt = 1;
     dirty = false;
     valid = true;
     refbit = true;
+    prefetched = false;
+    ioPending = false;
+    recLsn = NO_REC_LSN;
   }
 
+  /**
+   * Key of the page held by this frame
+   */
+  PageKey key() const { return makePageKey(fileId, pageNo); }
+
   void Print() {
-    if (file.isValid()) {
-      std::cout << "file:" << file.filename() << " ";
+    if (valid) {
+      std::cout << "file:" << File::filename(fileId) << " ";
       std::cout << "pageNo:" << pageNo << " ";
     } else
       std::cout << "file:NULL ";
@@ -120,6 +172,11 @@ struct BufStats {
    */
   int accesses;
 
+  /**
+   * Number of accesses that found the page in the buffer pool
+   */
+  int hits;
+
   /**
    * Number of pages read from disk (including allocs)
    */
@@ -130,10 +187,44 @@ struct BufStats {
    */
   int diskwrites;
 
+  /**
+   * Number of pages read by prefetching (also counted in diskreads)
+   */
+  int prefetched;
+
+  /**
+   * Number of prefetched pages that left the buffer pool without being
+   * accessed
+   */
+  int prefetchUnused;
+
   /**
    * Clear all values
    */
-  void clear() { accesses = diskreads = diskwrites = 0; }
+  void clear() {
+    accesses = hits = diskreads = diskwrites = 0;
+    prefetched = prefetchUnused = 0;
+  }
+
+  /**
+   * Fraction of accesses that were hits, 0 if there were none
+   */
+  double hitRatio() const {
+    return accesses == 0 ? 0.0 : (double)hits / accesses;
+  }
+
+  /**
+   * Add the values of other to these
+   */
+  BufStats& operator+=(const BufStats& other) {
+    accesses += other.accesses;
+    hits += other.hits;
+    diskreads += other.diskreads;
+    diskwrites += other.diskwrites;
+    prefetched += other.prefetched;
+    prefetchUnused += other.prefetchUnused;
+    return *this;
+  }
 
   /**
    * Constructor of BufStats class
@@ -141,26 +232,287 @@ struct BufStats {
   BufStats() { clear(); }
 };
 
+/**
+ * @brief Settings of the background writer
+ *
+ * Watermarks are fractions of the frames of the buffer pool that hold dirty
+ * pages.
+ */
+struct BgWriterConfig {
+  /**
+   * The writer stays idle while the dirty ratio is at or below this value
+   */
+  double lowWatermark = 0.05;
+
+  /**
+   * Above this dirty ratio the writer is woken at once and writes pages in
+   * victim order until the ratio drops to lowWatermark
+   */
+  double highWatermark = 0.2;
+
+  /**
+   * Number of upcoming victims of every shard checked in each round between
+   * the watermarks
+   */
+  std::uint32_t lookahead = 16;
+
+  /**
+   * Time between rounds
+   */
+  std::chrono::milliseconds interval = std::chrono::milliseconds(10);
+};
+
+/**
+ * @brief Settings of sequential read-ahead
+ */
+struct ReadAheadConfig {
+  /**
+   * Number of pages prefetched once a file is read sequentially
+   */
+  std::uint32_t initialWindow = 4;
+
+  /**
+   * The window doubles as long as the file is read sequentially, up to this
+   * many pages
+   */
+  std::uint32_t maxWindow = 64;
+};
+
+/**
+ * @brief Settings of the checkpointer
+ */
+struct CheckpointConfig {
+  /**
+   * Longest a restart should spend replaying the log.  The checkpointer
+   * keeps the log after the redo LSN within half of what can be replayed in
+   * this time, writing the pages that hold the redo LSN back.
+   */
+  std::chrono::milliseconds targetRecoveryTime = std::chrono::seconds(10);
+
+  /**
+   * Bytes of log that BufMgr::recover() replays per second, which depends
+   * on the device; measure it to make targetRecoveryTime accurate
+   */
+  double replayBytesPerSecond = 32 << 20;
+
+  /**
+   * Time between checkpoints
+   */
+  std::chrono::milliseconds interval = std::chrono::milliseconds(100);
+};
+
+/**
+ * @brief Statistics of checkpoints
+ */
+struct CheckpointStats {
+  /**
+   * Number of checkpoints taken
+   */
+  std::uint64_t checkpoints;
+
+  /**
+   * Number of pages written by the checkpointer ahead of checkpoints
+   */
+  std::uint64_t pagesWritten;
+
+  /**
+   * Number of pages written for the last checkpoint
+   */
+  std::uint32_t lastPagesWritten;
+
+  /**
+   * Time spent taking checkpoints, page writes included
+   */
+  std::chrono::microseconds totalDuration;
+
+  /**
+   * Time taken by the last checkpoint
+   */
+  std::chrono::microseconds lastDuration;
+
+  /**
+   * Redo LSN of the last checkpoint
+   */
+  Lsn redoLsn;
+
+  /**
+   * Clear all values
+   */
+  void clear() {
+    checkpoints = pagesWritten = 0;
+    lastPagesWritten = 0;
+    totalDuration = lastDuration = std::chrono::microseconds(0);
+    redoLsn = 0;
+  }
+
+  /**
+   * Constructor of CheckpointStats class
+   */
+  CheckpointStats() { clear(); }
+};
+
+/**
+ * Called once an asynchronous readPage() completed, with the pinned page, or
+ * with nullptr and the exception the synchronous call would have thrown.
+ */
+typedef std::function<void(Page* page, std::exception_ptr error)> PageCallback;
+
+/**
+ * @brief A partition of the buffer pool.
+ *
+ * Every shard owns a contiguous range of frames together with the hash table
+ * entries, the replacement policy state and the statistics for those frames.
+ * A page is always cached in the shard selected by hashing its (file, page
+ * number), so operations on pages of different shards only contend on
+ * different latches.
+ */
+class BufShard {
+ private:
+  friend class BufMgr;
+
+  /**
+   * Constructor of BufShard class
+   *
+   * @param first   First frame of the buffer pool owned by this shard
+   * @param frames  Number of frames owned by this shard
+   * @param policy  Replacement algorithm used within this shard
+   */
+  BufShard(FrameId first, std::uint32_t frames, ReplacementPolicyType policy)
+      : firstFrame(first),
+        numFrames(frames),
+        replacer(ReplacementPolicy::create(policy, frames)),
+        hashTable(frames) {}
+
+  /**
+   * Protects every frame descriptor, the hash table, the replacement policy
+   * and the statistics of this shard
+   */
+  std::mutex latch;
+
+  /**
+   * First frame of the buffer pool owned by this shard
+   */
+  FrameId firstFrame;
+
+  /**
+   * Number of frames owned by this shard
+   */
+  std::uint32_t numFrames;
+
+  /**
+   * Chooses victims among the frames of this shard.  Frames are numbered
+   * relative to firstFrame.
+   */
+  std::unique_ptr<ReplacementPolicy> replacer;
+
+  /**
+   * Hash table mapping (FileId, page) to frame for the pages of this shard
+   */
+  BufHashTbl hashTable;
+
+  /**
+   * Usage statistics of this shard
+   */
+  BufStats bufStats;
+
+  /**
+   * Callbacks waiting for the asynchronous read into a frame, by frame
+   */
+  std::unordered_map<FrameId, std::vector<PageCallback>> ioWaiters;
+
+  /**
+   * Number of reads into pending frames whose callbacks have not all run yet
+   */
+  std::uint32_t readsInFlight = 0;
+
+  /**
+   * Writes of pages of this shard that run without the shard latch, by page
+   * and in the order they were started, each with the recLsn the page had
+   * before it was marked clean.  A page is not read from disk while a write
+   * of it is in progress, and writes of one page reach the file in order.
+   */
+  std::multimap<PageKey, Lsn> writesInFlight;
+
+  /**
+   * Signals that a read into a pending frame or a write of this shard
+   * completed
+   */
+  std::condition_variable ioDone;
+};
+
 /**
  * @brief The central class which manages the buffer pool including frame
  * allocation and deallocation to pages in the file
+ *
+ * The buffer pool is split into one or more shards (see BufShard).  With more
+ * than one shard the public methods may be called concurrently from several
+ * threads; calls that touch different shards proceed in parallel.  Misses
+ * read their page and write back their victim without any latch held, so
+ * they run in parallel too, also within a shard.
+ *
+ * Frames identify their file by FileId only.  The buffer manager keeps one
+ * File object per file that has pages in the pool, which keeps the file open
+ * and is used to write those pages back.
  */
 class BufMgr {
  private:
   /**
-   * Current position of clockhand in our buffer pool
+   * Number of frames in the buffer pool
+   */
+  std::uint32_t numBufs;
+
+  /**
+   * Partitions of the buffer pool
    */
-  FrameId clockHand;
+  std::vector<std::unique_ptr<BufShard>> shards;
 
   /**
-   * Number of frames in the buffer pool
+   * Protects fileTable, fileFrames and closedFiles.  Pages are read and
+   * written without it; the only I/O under it is closing a file whose last
+   * File object was the buffer manager's.  Always acquired after a shard
+   * latch, never before.
    */
-  std::uint32_t numBufs;
+  std::mutex ioLatch;
 
   /**
-   * Hash table mapping (File, page) to frame
+   * File objects of the files that have pages in the buffer pool, indexed by
+   * FileId
    */
-  BufHashTbl hashTable;
+  std::vector<File> fileTable;
+
+  /**
+   * Number of frames holding a page of each file, indexed by FileId
+   */
+  std::vector<std::uint32_t> fileFrames;
+
+  /**
+   * Free-space maps opened by findPageWithSpace(), indexed by FileId.  A map
+   * stays open until the buffer manager is destroyed.
+   */
+  std::vector<std::unique_ptr<FreeSpaceMap>> freeSpaceMaps;
+
+  /**
+   * Protects freeSpaceMaps.  Never held together with another latch.
+   */
+  std::mutex fsmLatch;
+
+  /**
+   * Whether any free-space map is open, so that unpins of other files skip
+   * the lookup
+   */
+  std::atomic<bool> anyFreeSpaceMap;
+
+  /**
+   * Write-ahead log that changes to pages are recorded in, or nullptr
+   */
+  LogManager* log;
+
+  /**
+   * Names of files that pages were written to and that were closed by
+   * detachFile() since the last checkpoint, which has to sync them.
+   * Protected by ioLatch.
+   */
+  std::vector<std::string> closedFiles;
 
   /**
    * Array of BufDesc objects to hold information corresponding to every frame
@@ -169,35 +521,618 @@ class BufMgr {
   std::vector<BufDesc> bufDescTable;
 
   /**
-   * Maintains Buffer pool usage statistics
+   * Number of frames holding a dirty page
    */
-  BufStats bufStats;
+  std::atomic<std::uint32_t> dirtyFrames;
+
+  /**
+   * Background writer thread, if started
+   */
+  std::thread bgWriter;
+
+  /**
+   * Protects bgStop and is used with bgWakeup
+   */
+  std::mutex bgLatch;
+
+  /**
+   * Signals the background writer to run a round or to stop
+   */
+  std::condition_variable bgWakeup;
+
+  /**
+   * Tells the background writer to exit
+   */
+  bool bgStop;
+
+  /**
+   * Settings of the running background writer
+   */
+  BgWriterConfig bgConfig;
+
+  /**
+   * Value of bgHighFrames while no background writer runs
+   */
+  static const std::uint32_t NO_BG_WRITER = ~std::uint32_t(0);
+
+  /**
+   * Dirty frame count above which unPinPage() wakes the background writer
+   */
+  std::atomic<std::uint32_t> bgHighFrames;
+
+  /**
+   * Checkpointer thread, if started
+   */
+  std::thread checkpointer;
+
+  /**
+   * Protects cpStop, cpConfig and cpStats, and is used with cpWakeup
+   */
+  std::mutex cpLatch;
+
+  /**
+   * Signals the checkpointer to stop
+   */
+  std::condition_variable cpWakeup;
+
+  /**
+   * Tells the checkpointer to exit
+   */
+  bool cpStop;
+
+  /**
+   * Settings of the running checkpointer
+   */
+  CheckpointConfig cpConfig;
+
+  /**
+   * Statistics of checkpoints
+   */
+  CheckpointStats cpStats;
+
+  /**
+   * @brief Pages of a file to be read by the prefetcher
+   */
+  struct PrefetchRequest {
+    File file;
+    PageId first;
+    std::uint32_t count;
+
+    /**
+     * True if queued by read-ahead rather than by prefetch()
+     */
+    bool readAhead;
+  };
+
+  /**
+   * @brief Sequential access detection for one file
+   */
+  struct ReadAheadState {
+    /**
+     * Page that continues the sequential run
+     */
+    PageId expected = Page::INVALID_NUMBER;
+
+    /**
+     * Current read-ahead window, 0 if the file is not read sequentially
+     */
+    std::uint32_t window = 0;
+
+    /**
+     * First page not requested from the prefetcher yet
+     */
+    PageId ahead = Page::INVALID_NUMBER;
+  };
+
+  /**
+   * Protects the prefetch queue, the read-ahead state and settings and the
+   * prefetcher thread.  Acquired after any other latch, never before.
+   */
+  std::mutex prefetchLatch;
 
   /**
-   * Advance clock to next frame in the buffer pool
+   * Signals the prefetcher that there is work or that it should stop
    */
-  void advanceClock();
+  std::condition_variable prefetchWakeup;
 
   /**
-   * Allocate a free frame.
+   * Signals that the prefetcher finished a request
+   */
+  std::condition_variable prefetchDone;
+
+  /**
+   * Prefetcher thread, started by the first prefetch request
+   */
+  std::thread prefetcher;
+
+  /**
+   * Tells the prefetcher to exit
+   */
+  bool prefetchStop;
+
+  /**
+   * File of the request the prefetcher is working on, or File::INVALID_ID
+   */
+  FileId prefetchActive;
+
+  /**
+   * Pending prefetch requests, oldest first
+   */
+  std::deque<PrefetchRequest> prefetchQueue;
+
+  /**
+   * Sequential access detection state, indexed by FileId
+   */
+  std::vector<ReadAheadState> readAheadStates;
+
+  /**
+   * Read-ahead settings; a maxWindow of 0 disables read-ahead
+   */
+  ReadAheadConfig readAheadConfig;
+
+  /**
+   * Returns the shard in which the given page is cached
+   *
+   * @param key   	Key of the page
+   * @return  			Shard owning the page
+   */
+  BufShard& shardOf(const PageKey key);
+
+  /**
+   * Returns the shard owning a frame.
+   *
+   * @param frameNo Frame number
+   * @return  			Shard owning the frame
+   */
+  BufShard& shardOfFrame(const FrameId frameNo);
+
+  /**
+   * Drops one pin of a frame and records whether the page was modified.
+   * Must be called with the latch of the frame's shard held.
    *
+   * @param shard   Shard owning the frame
+   * @param frameNo Frame number
+   * @param dirty   True if the page was modified
+   * @return  False if the frame was not pinned
+   */
+  bool unpinFrame(BufShard& shard, const FrameId frameNo, const bool dirty);
+
+  /**
+   * Releases the frame latch and the pin held by a PageGuard.
+   *
+   * @param frameNo   Frame number
+   * @param exclusive True if the guard holds the latch exclusively
+   * @param dirty     True if the page was modified
+   */
+  void unpinGuarded(const FrameId frameNo, const bool exclusive,
+                    const bool dirty);
+
+  /**
+   * Takes the latches of all shards, in shard order.
+   *
+   * @return  Guards holding the latches
+   */
+  std::vector<std::unique_lock<std::mutex>> lockAllShards();
+
+  /**
+   * Writes dirty frames back and marks them clean.  The frames are sorted by
+   * file and page number, runs of consecutive pages are written with one
+   * vectored write each, and every file written to is synced once at the
+   * end.  Must be called with the latches of all shards held.
+   *
+   * @param frames  Dirty, unpinned frames; reordered by the call
+   */
+  void writeBack(std::vector<FrameId>& frames);
+
+  /**
+   * Enforces the write-ahead rule before a page is written to disk: waits
+   * until the log, if there is one, is durable up to the page's LSN.
+   *
+   * @param lsn   LSN of the page, or the highest LSN of several pages
+   * @throws  IoException  If the log cannot be written
+   */
+  void forceLog(const Lsn lsn);
+
+  /**
+   * Makes everything logged so far durable.  Called without any latch held
+   * before pages are written under latches, so that the forceLog() calls of
+   * the writes return at once unless a page changed in between.
+   *
+   * @throws  IoException  If the log cannot be written
+   */
+  void flushLogAhead();
+
+  /**
+   * Records that one more frame holds a page of the file.  Must be called
+   * with ioLatch held.
+   *
+   * @param file   	File object
+   */
+  void attachFile(File& file);
+
+  /**
+   * Records that one frame less holds a page of the file, closing our copy of
+   * the file when it was the last one.  Must be called with ioLatch held.
+   *
+   * @param fileId  File identifier
+   */
+  void detachFile(const FileId fileId);
+
+  /**
+   * Returns the free-space map of a file, or nullptr if it has none open.
+   *
+   * @param fileId  File identifier
+   */
+  FreeSpaceMap* freeSpaceMapOf(const FileId fileId);
+
+  /**
+   * Records the free space of a page in a free-space map.  If no frame is
+   * left for a map page, the map is left as it is; it is approximate anyway.
+   * Must be called without any latch held.
+   *
+   * @param map     Free-space map of the page's file, or nullptr
+   * @param pageNo  Page number
+   * @param space   Length of the longest record that fits on the page
+   */
+  void recordFreeSpace(FreeSpaceMap* map, const PageId pageNo,
+                       const std::uint16_t space);
+
+  /**
+   * Allocate a free frame, writing back the page it held if that page is
+   * dirty.  The shard's replacement policy considers the frame pinned until
+   * it is filled or erased.  Must be called with the shard latch held and
+   * ioLatch not held; the shard latch is released while the old page is
+   * written, so the caller has to look its page up again afterwards.
+   *
+   * @param shard   Shard from which the frame is allocated
+   * @param shardGuard  Guard holding the shard latch
+   * @param key     Key of the page that will be placed in the frame
    * @param frame   	Frame reference, frame ID of allocated frame returned
    * via this variable
    * @throws BufferExceededException If no such buffer is found which can be
    * allocated
+   * @throws  IoException If the old page cannot be written; it stays in the
+   * buffer pool, dirty
+   */
+  void allocBuf(BufShard& shard, std::unique_lock<std::mutex>& shardGuard,
+                const PageKey key, FrameId& frame);
+
+  /**
+   * Looks a page up and, if it is not in the buffer pool, reserves a frame
+   * for it with allocBuf().  Waits for writes of the page that are in
+   * progress, so that the page is not read from disk before they reached
+   * the file.  Must be called with the shard latch held, which may be
+   * released in between.
+   *
+   * @param shard   Shard of the page
+   * @param shardGuard  Guard holding the shard latch
+   * @param key     Key of the page
+   * @param frameNo Frame holding the page, which may be pending, or the frame
+   * reserved for it
+   * @return  True if the page is in the buffer pool, false if a frame was
+   * reserved
+   * @throws BufferExceededException If no frame can be reserved
+   */
+  bool reserveFrame(BufShard& shard, std::unique_lock<std::mutex>& shardGuard,
+                    const PageKey key, FrameId& frameNo);
+
+  /**
+   * Assigns a frame reserved by reserveFrame() to a page, pinned once and
+   * pending, so that requests for the page wait for it while it is read
+   * without the shard latch.  completeRead() ends the pending state.  Must
+   * be called with the shard latch held.
+   *
+   * @param shard   Shard owning the frame
+   * @param frameNo Reserved frame
+   * @param file   	File object
+   * @param pageNo  Page number in the file
+   */
+  void publishFrame(BufShard& shard, const FrameId frameNo, File& file,
+                    const PageId pageNo);
+
+  /**
+   * Registers a write of a page that is about to run without the shard
+   * latch and waits for earlier writes of the page to complete.  Must be
+   * called with the shard latch held, which may be released in between.
+   *
+   * @param shard   Shard of the page
+   * @param shardGuard  Guard holding the shard latch
+   * @param key     Key of the page
+   * @param recLsn  recLsn of the changes the write makes durable, which
+   * checkpoints keep in their redo LSN until finishWrite()
+   * @return  Handle for finishWrite()
+   */
+  std::multimap<PageKey, Lsn>::iterator startWrite(
+      BufShard& shard, std::unique_lock<std::mutex>& shardGuard,
+      const PageKey key, const Lsn recLsn);
+
+  /**
+   * Unregisters a write registered by startWrite() once it reached the file
+   * or failed.  Must be called with the shard latch held.
+   *
+   * @param shard   Shard of the page
+   * @param write   Handle returned by startWrite()
+   */
+  void finishWrite(BufShard& shard,
+                   std::multimap<PageKey, Lsn>::iterator write);
+
+  /**
+   * Returns the File object of a file that has pages in the buffer pool.
+   * Takes ioLatch itself.
+   *
+   * @param fileId  File identifier
+   */
+  File fileOf(const FileId fileId);
+
+  /**
+   * Body of the background writer thread
+   */
+  void bgWriterLoop();
+
+  /**
+   * Writes back the dirty, unpinned pages among the given frames of the
+   * shard, stopping once no more than target frames are dirty.  Takes the
+   * shard latch itself.
+   *
+   * @param shard   Shard owning the frames
+   * @param frames  Frames to clean, relative to the first frame of the shard
+   * @param target  Dirty frame count at which to stop
+   * @return  Number of pages written
+   */
+  std::uint32_t cleanFrames(BufShard& shard, const std::vector<FrameId>& frames,
+                   const std::uint32_t target);
+
+  /**
+   * Body of the checkpointer thread
+   */
+  void checkpointLoop();
+
+  /**
+   * Writes back the dirty, unpinned pages whose changes are logged from
+   * before the given LSN, oldest first, one at a time like the background
+   * writer.
+   *
+   * @param below   Pages with a lower recLsn are written
+   * @return  Number of pages written
+   */
+  std::uint32_t writeOldPages(const Lsn below);
+
+  /**
+   * Takes a checkpoint, first writing back the pages whose changes are
+   * logged from before the given LSN, and records it in the statistics.
+   *
+   * @param writeBelow  Pages with a lower recLsn are written first; 0 writes
+   * none
+   * @param always      False to skip the checkpoint record if it would not
+   * move the redo LSN
+   * @throws  IoException  If a page, a file or the log cannot be written
+   */
+  void runCheckpoint(const Lsn writeBelow, const bool always);
+
+  /**
+   * Body of the prefetcher thread
+   */
+  void prefetchLoop();
+
+  /**
+   * Reads a page into a free frame, or into the frame of a clean page about
+   * to be evicted, and leaves it unpinned.  Dirty pages are never evicted for
+   * a prefetch.
+   *
+   * @param file    File object
+   * @param pageNo  Page number in the file
+   * @return  False if the page does not exist or no frame could be found
+   */
+  bool prefetchPage(File& file, const PageId pageNo);
+
+  /**
+   * Queues pages for the prefetcher, starting it if needed.  Must be called
+   * with prefetchLatch held.
+   *
+   * @param file    File object
+   * @param first   First page to prefetch
+   * @param count   Number of pages to prefetch
+   * @param readAhead True if queued by read-ahead; pages that the scan has
+   * already passed by the time the prefetcher gets to them are skipped
+   */
+  void queuePrefetch(File& file, const PageId first, const std::uint32_t count,
+                     const bool readAhead);
+
+  /**
+   * Updates the sequential access detection of the file after a miss or the
+   * first access of a prefetched page, and queues the next read-ahead window
+   * when due.  Must be called with the shard latch of the page held.
+   *
+   * @param file          File object
+   * @param pageNo        Page number that was accessed
+   * @param prefetchHit   True if the page had been prefetched
+   */
+  void readAhead(File& file, const PageId pageNo, const bool prefetchHit);
+
+  /**
+   * Drops queued prefetch requests for the file and waits for the
+   * prefetcher to finish a request for it that is in progress.
+   *
+   * @param fileId  File identifier
    */
-  void allocBuf(FrameId& frame);
+  void cancelPrefetch(const FileId fileId);
+
+  /**
+   * Finishes a read into a pending frame: on success the frame is handed to
+   * the replacement policy, on failure it is freed.  Then the waiting
+   * callbacks are run.  Called without any latch held, on an I/O engine
+   * thread for asynchronous reads.
+   *
+   * @param shard   Shard owning the frame
+   * @param frameNo Frame the page was read into
+   * @param error   nullptr, or the exception the read failed with
+   */
+  void completeRead(BufShard& shard, const FrameId frameNo,
+                    std::exception_ptr error);
+
+  /**
+   * Latches of the frames, taken by page guards
+   */
+  std::unique_ptr<std::shared_timed_mutex[]> frameLatches;
+
+  friend class PageGuard;
 
  public:
   /**
-   * Actual buffer pool from which frames are allocated
+   * Actual buffer pool from which frames are allocated; frame i is at byte
+   * offset i * Page::SIZE of one contiguous arena
    */
-  std::vector<Page> bufPool;
+  FrameArena bufPool;
 
   /**
    * Constructor of BufMgr class
+   *
+   * @param bufs    Number of frames in the buffer pool
+   * @param numShards Number of partitions of the buffer pool. A value of 1
+   * gives a single replacement policy over the whole pool.
+   * @param policy  Page replacement algorithm, run separately in every shard
+   * @param hugePages Back the buffer pool by 2 MB huge pages
    */
-  BufMgr(std::uint32_t bufs);
+  BufMgr(std::uint32_t bufs, std::uint32_t numShards = 1,
+         ReplacementPolicyType policy = ReplacementPolicyType::CLOCK,
+         bool hugePages = false);
+
+  /**
+   * Destructor of BufMgr class.  Stops the background writer, the
+   * checkpointer and the prefetcher and waits for asynchronous reads to
+   * complete.  Dirty pages are not written back.
+   */
+  ~BufMgr();
+
+  /**
+   * Starts a thread that writes back dirty, unpinned pages that the
+   * replacement policy is about to evict, so that misses rarely have to write
+   * a victim themselves.  Does nothing if the writer is already running.
+   *
+   * @param config  Watermarks and pacing of the writer
+   */
+  void startBgWriter(const BgWriterConfig& config = BgWriterConfig());
+
+  /**
+   * Stops the background writer and waits for it to exit.  Does nothing if
+   * it is not running.
+   */
+  void stopBgWriter();
+
+  /**
+   * Makes the buffer manager follow the write-ahead rule with the given log:
+   * a dirty page is written to disk, whether on eviction, by flushFile(),
+   * flushAll() or the background writer, only once the log is durable up to
+   * the page's LSN.  Changes are logged with logUpdate().  Must be called
+   * before any page is modified, while no other thread uses the buffer
+   * manager; the log has to outlive the buffer manager.
+   *
+   * @param logManager  Log to follow
+   */
+  void enableLogging(LogManager& logManager);
+
+  /**
+   * Appends a PageUpdateRecord with the current contents of a byte range of
+   * a pinned page to the log, stamps the page with the record's LSN and marks
+   * it dirty.  Call it after changing the page and before unpinning it.
+   * The change is durable once the log is flushed up to the returned LSN,
+   * however much later the page itself is written; so a commit costs one
+   * sequential log write shared with concurrent committers, not a random
+   * page write.
+   *
+   * The first change of a page since it was last clean logs the whole page
+   * instead of the range, so that recover() can rebuild the page if a crash
+   * tears its next write.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file
+   * @param offset  Offset of the first changed byte in the page image
+   * @param length  Number of bytes changed; the range is cut at the end of
+   * the page.  The default logs the whole page.
+   * @return  LSN of the record, 0 if logging is not enabled
+   * @throws  PageNotPinnedException If the page is not pinned
+   * @throws  IoException If an earlier write of the log failed
+   */
+  Lsn logUpdate(File& file, const PageId pageNo,
+                const std::uint16_t offset = 0,
+                const std::uint16_t length = Page::SIZE);
+
+  /**
+   * Takes a fuzzy checkpoint without writing any page: the redo LSN is the
+   * oldest recLsn in the dirty page table, every file that pages were
+   * written to is synced, and LogManager::writeCheckpoint() records it.
+   * Other threads keep reading and changing pages meanwhile.  Does nothing
+   * if logging is not enabled.
+   *
+   * @throws  IoException  If a file or the log cannot be written
+   */
+  void checkpoint();
+
+  /**
+   * Starts a thread that takes a checkpoint every interval and, before
+   * that, trickles out the dirty pages that hold the redo LSN back, so that
+   * recovery never has to replay much more than the target recovery time
+   * allows.  Readers and writers of pages are not stopped.  Does nothing if
+   * logging is not enabled or the checkpointer is already running.
+   *
+   * @param config  Target recovery time and pacing
+   */
+  void startCheckpointer(const CheckpointConfig& config = CheckpointConfig());
+
+  /**
+   * Stops the checkpointer and waits for it to exit.  Does nothing if it is
+   * not running.
+   */
+  void stopCheckpointer();
+
+  /**
+   * Get checkpoint statistics
+   */
+  CheckpointStats getCheckpointStats();
+
+  /**
+   * Redoes the changes logged with logUpdate() after the last checkpoint of
+   * the log in the files named by the log records, where a page on disk has
+   * an older LSN than the record.  Run it after a crash, before the files
+   * are used again.  Pages that no longer exist are skipped, but pages
+   * allocated after the file header was last written are allocated again
+   * (see File::redoAllocation()).  A page torn by the crash is rebuilt from
+   * the whole-page image that logUpdate() logged first after the page was
+   * last clean.
+   *
+   * @param logFilename   Name of the log file
+   * @return  Number of log records applied
+   * @throws  IoException  If the log or a file cannot be read or written
+   * @throws  CorruptPageException  If a torn page has no whole-page image in
+   * the log to rebuild it from, such as one written before logging was
+   * enabled.  Thrown after everything else was recovered.
+   */
+  static std::uint64_t recover(const std::string& logFilename);
+
+  /**
+   * Asks for pages of the file to be read into the buffer pool in the
+   * background, unpinned, so that later readPage() calls for them hit.  This
+   * is only a hint: pages that do not exist are skipped, and prefetching
+   * stops early when only dirty or pinned pages could make room.
+   *
+   * @param file    File object
+   * @param first   First page to prefetch
+   * @param count   Number of pages to prefetch
+   */
+  void prefetch(File& file, const PageId first, const std::uint32_t count);
+
+  /**
+   * Turns on sequential read-ahead: once consecutive pages of a file are
+   * read, a growing window of the following pages is prefetched.
+   *
+   * @param config  Window sizes
+   */
+  void enableReadAhead(const ReadAheadConfig& config = ReadAheadConfig());
+
+  /**
+   * Turns off sequential read-ahead.  Pages already queued are still read.
+   */
+  void disableReadAhead();
 
   /**
    * Reads the given page from the file into a frame and returns the pointer to
@@ -209,9 +1144,57 @@ class BufMgr {
    * @param PageNo  Page number in the file to be read
    * @param page  	Reference to page pointer. Used to fetch the Page object
    * in which requested page from file is read in.
+   * @throws  InvalidPageException If the page does not exist, including
+   * Page::INVALID_NUMBER
    */
   void readPage(File& file, const PageId pageNo, Page*& page);
 
+  /**
+   * Like readPage(), but does not wait for a miss to be read from disk.  A
+   * hit runs the callback right away on the calling thread; for a miss the
+   * frame is reserved and the read submitted to the I/O engine, and the
+   * callback runs on an I/O engine thread once it completed.  Requests for a
+   * page that is still being read wait for that read.  On success the page is
+   * pinned once for the caller.
+   *
+   * Every callback has to have run before the BufMgr is destroyed; the
+   * destructor waits for outstanding reads.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file to be read
+   * @param done    Called with the page, or with the error
+   */
+  void readPageAsync(File& file, const PageId pageNo, PageCallback done);
+
+  /**
+   * Like readPage(), but returns a future for the page instead of waiting
+   * for a miss to be read from disk.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file to be read
+   * @return  Future for the pinned page; get() rethrows any error
+   */
+  std::future<Page*> readPageAsync(File& file, const PageId pageNo);
+
+  /**
+   * Reads and pins several pages of a file at once.  All pages are looked up
+   * first and frames are reserved for the misses; the misses are then sorted
+   * by page number and every run of consecutive pages is read with one
+   * vectored read.  Each occurrence of a page in pageNos pins it once, as a
+   * readPage() call would.
+   *
+   * Either all pages are pinned or, if an exception is thrown, none.
+   *
+   * @param file   	File object
+   * @param pageNos Page numbers in the file to be read
+   * @param pages  	Resized to pageNos.size(); pages[i] is set to the frame
+   * holding pageNos[i]
+   * @throws  BufferExceededException If there are not enough free frames
+   * @throws  InvalidPageException If a page doesn't exist in the file
+   */
+  void readPages(File& file, const std::vector<PageId>& pageNos,
+                 std::vector<Page*>& pages);
+
   /**
    * Unpin a page from memory since it is no longer required for it to remain in
    * memory.
@@ -224,6 +1207,38 @@ class BufMgr {
    */
   void unPinPage(File& file, const PageId pageNo, const bool dirty);
 
+  /**
+   * Like readPage(), but returns the pin as a guard holding the frame's
+   * latch in shared mode.  The page is unpinned when the guard is released
+   * or destroyed; do not call unPinPage() for it.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file to be read
+   * @return  Guard for the pinned page
+   */
+  ReadPageGuard readPageGuard(File& file, const PageId pageNo);
+
+  /**
+   * Like readPageGuard(), but latches the frame exclusively so that the page
+   * can be modified.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file to be read
+   * @return  Guard for the pinned page
+   */
+  WritePageGuard writePageGuard(File& file, const PageId pageNo);
+
+  /**
+   * Like allocPage(), but returns the pin as a guard holding the frame's
+   * latch exclusively.
+   *
+   * @param file   	File object
+   * @param pageNo  The number assigned to the page in the file is returned
+   * via this reference.
+   * @return  Guard for the pinned page
+   */
+  WritePageGuard allocPageGuard(File& file, PageId& pageNo);
+
   /**
    * Allocates a new, empty page in the file and returns the Page object.
    * The newly allocated page is also assigned a frame in the buffer pool.
@@ -237,7 +1252,9 @@ class BufMgr {
   void allocPage(File& file, PageId& pageNo, Page*& page);
 
   /**
-   * Writes out all dirty pages of the file to disk.
+   * Writes out all dirty pages of the file to disk and evicts the file's
+   * pages from the buffer pool.  The pages are written in page order, runs of
+   * consecutive pages with one vectored write, and the file is synced once.
    * All the frames assigned to the file need to be unpinned from buffer pool
    * before this function can be successfully called. Otherwise Error returned.
    *
@@ -249,6 +1266,35 @@ class BufMgr {
    */
   void flushFile(File& file);
 
+  /**
+   * Writes out the dirty pages of all files, like flushFile(), but leaves the
+   * pages in the buffer pool.  Pinned pages are skipped.
+   */
+  void flushAll();
+
+  /**
+   * Returns a page of the file that a record of the given length fits on,
+   * without reading any page of the file, or Page::INVALID_NUMBER if there
+   * is none.  Of the pages with room, the one with the lowest page number is
+   * returned, so records fill the file from the front.
+   *
+   * The answer comes from the file's free-space map, a companion file named
+   * by FreeSpaceMap::mapFilename() whose pages live in the buffer pool.  The
+   * first call opens the map, building it from the pages of the file if the
+   * companion file doesn't exist yet; the map then keeps the file open until
+   * the buffer manager is destroyed, which writes the map out.  The map
+   * learns the free space of a page when the page is allocated, disposed of
+   * or unpinned dirty, so changes made to the file in other ways are not
+   * reflected.  A record longer than 255 * FreeSpaceMap::CATEGORY_BYTES
+   * bytes may not fit on the page returned.
+   *
+   * @param file    File object
+   * @param bytes   Length of the record
+   * @return  Number of a page with room for the record
+   * @throws  BufferExceededException If no frame is left for a map page
+   */
+  PageId findPageWithSpace(File& file, const std::size_t bytes);
+
   /**
    * Delete page from file and also from buffer pool if present.
    * Since the page is entirely deleted from file, its unnecessary to see if the
@@ -256,6 +1302,8 @@ class BufMgr {
    *
    * @param file   	File object
    * @param PageNo  Page number
+   * @throws  InvalidPageException If the page does not exist, including
+   * Page::INVALID_NUMBER
    */
   void disposePage(File& file, const PageId PageNo);
 
@@ -265,14 +1313,14 @@ class BufMgr {
   void printSelf();
 
   /**
-   * Get buffer pool usage statistics
+   * Get buffer pool usage statistics, summed over all shards
    */
-  BufStats& getBufStats() { return bufStats; }
+  BufStats getBufStats();
 
   /**
    * Clear buffer pool usage statistics
    */
-  void clearBufStats() { bufStats.clear(); }
+  void clearBufStats();
 };
 
 }  // namespace badgerdb
@@ -0,0 +1,175 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "checksum.h"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace badgerdb {
+
+namespace {
+
+typedef std::uint32_t (*Crc32cFunction)(const void*, const std::size_t,
+                                        const std::uint32_t);
+
+// Reflected CRC-32C polynomial
+const std::uint32_t kPolynomial = 0x82f63b78;
+
+// tables[k][b] is the CRC of byte b followed by k zero bytes.
+struct Tables {
+  std::uint32_t tables[8][256];
+
+  Tables() {
+    for (std::uint32_t b = 0; b < 256; b++) {
+      std::uint32_t crc = b;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc >> 1) ^ (kPolynomial & (0 - (crc & 1)));
+      }
+      tables[0][b] = crc;
+    }
+    for (std::uint32_t b = 0; b < 256; b++) {
+      for (int k = 1; k < 8; k++) {
+        tables[k][b] =
+            (tables[k - 1][b] >> 8) ^ tables[0][tables[k - 1][b] & 0xff];
+      }
+    }
+  }
+};
+
+const Tables& tables() {
+  static const Tables tables;
+  return tables;
+}
+
+#if defined(__x86_64__)
+// Bytes per stream in a round of crc32cSse42(), chosen so that the 8160 data
+// bytes of a page are four rounds exactly.
+const std::size_t kStreamBytes = 680;
+
+// Advances a CRC state over kStreamBytes zero bytes.  The state is linear in
+// the bits of the state before, so four tables of 256 entries do it.
+struct Shift {
+  std::uint32_t advance[4][256];
+
+  Shift() {
+    std::uint32_t basis[32];
+    for (int bit = 0; bit < 32; bit++) {
+      std::uint32_t state = std::uint32_t(1) << bit;
+      for (std::size_t i = 0; i < kStreamBytes; i++) {
+        state = (state >> 8) ^ tables().tables[0][state & 0xff];
+      }
+      basis[bit] = state;
+    }
+    for (int k = 0; k < 4; k++) {
+      for (std::uint32_t b = 0; b < 256; b++) {
+        std::uint32_t state = 0;
+        for (int bit = 0; bit < 8; bit++) {
+          if (b >> bit & 1) state ^= basis[8 * k + bit];
+        }
+        advance[k][b] = state;
+      }
+    }
+  }
+
+  std::uint32_t operator()(const std::uint32_t state) const {
+    return advance[0][state & 0xff] ^ advance[1][(state >> 8) & 0xff] ^
+           advance[2][(state >> 16) & 0xff] ^ advance[3][state >> 24];
+  }
+};
+
+__attribute__((target("sse4.2"))) std::uint32_t crc32cSse42(
+    const void* data, const std::size_t length, const std::uint32_t crc) {
+  static const Shift shift;
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  const unsigned char* const end = bytes + length;
+  std::uint64_t state = ~crc;
+  // Eight bytes per instruction; pages are aligned, so the byte loops only
+  // run for odd ranges.
+  while (bytes < end && reinterpret_cast<std::uintptr_t>(bytes) % 8 != 0) {
+    state = _mm_crc32_u8(state, *bytes++);
+  }
+  // The instruction takes three cycles but can start every cycle, so three
+  // independent streams keep it busy.  The CRC of the whole round is that of
+  // the first stream advanced over the others, combined with theirs.
+  for (; (std::size_t)(end - bytes) >= 3 * kStreamBytes;
+       bytes += 3 * kStreamBytes) {
+    std::uint64_t second = 0;
+    std::uint64_t third = 0;
+    for (std::size_t i = 0; i < kStreamBytes; i += 8) {
+      std::uint64_t words[3];
+      std::memcpy(&words[0], bytes + i, 8);
+      std::memcpy(&words[1], bytes + kStreamBytes + i, 8);
+      std::memcpy(&words[2], bytes + 2 * kStreamBytes + i, 8);
+      state = _mm_crc32_u64(state, words[0]);
+      second = _mm_crc32_u64(second, words[1]);
+      third = _mm_crc32_u64(third, words[2]);
+    }
+    state = shift(shift(state) ^ second) ^ third;
+  }
+  for (; end - bytes >= 8; bytes += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, bytes, sizeof(word));
+    state = _mm_crc32_u64(state, word);
+  }
+  while (bytes < end) {
+    state = _mm_crc32_u8(state, *bytes++);
+  }
+  return ~static_cast<std::uint32_t>(state);
+}
+#endif
+
+Crc32cFunction selectCrc32c() {
+#if defined(__x86_64__)
+  if (__builtin_cpu_supports("sse4.2")) return crc32cSse42;
+#endif
+  return crc32cPortable;
+}
+
+}  // namespace
+
+std::uint32_t crc32c(const void* data, const std::size_t length,
+                     const std::uint32_t crc) {
+  // Chosen on first use, so that checksums work during static
+  // initialization too.
+  static const Crc32cFunction implementation = selectCrc32c();
+  return implementation(data, length, crc);
+}
+
+std::uint32_t crc32cPortable(const void* data, const std::size_t length,
+                             const std::uint32_t crc) {
+  const std::uint32_t(&t)[8][256] = tables().tables;
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  const unsigned char* const end = bytes + length;
+  std::uint32_t state = ~crc;
+  // Little-endian words, as on every CPU BadgerDB files are written on.
+  for (; end - bytes >= 8; bytes += 8) {
+    std::uint32_t low;
+    std::uint32_t high;
+    std::memcpy(&low, bytes, sizeof(low));
+    std::memcpy(&high, bytes + 4, sizeof(high));
+    low ^= state;
+    state = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^
+            t[5][(low >> 16) & 0xff] ^ t[4][low >> 24] ^
+            t[3][high & 0xff] ^ t[2][(high >> 8) & 0xff] ^
+            t[1][(high >> 16) & 0xff] ^ t[0][high >> 24];
+  }
+  while (bytes < end) {
+    state = (state >> 8) ^ t[0][(state ^ *bytes++) & 0xff];
+  }
+  return ~state;
+}
+
+const char* crc32cImplementation() {
+  return selectCrc32c() == crc32cPortable ? "portable" : "sse4.2";
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,43 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * Computes the CRC-32C (Castagnoli) checksum of a byte range, continuing
+ * from the checksum of the bytes before it.  Uses the SSE4.2 crc32
+ * instruction if the CPU has it, which is checked once at run time, and
+ * crc32cPortable() otherwise.
+ *
+ * @param data    First byte
+ * @param length  Number of bytes
+ * @param crc     Checksum of the preceding bytes, 0 to start
+ * @return  Checksum of the preceding bytes and these
+ */
+std::uint32_t crc32c(const void* data, const std::size_t length,
+                     const std::uint32_t crc = 0);
+
+/**
+ * Computes the same checksum as crc32c() with lookup tables, eight bytes at
+ * a time (slicing-by-8), on any CPU.
+ */
+std::uint32_t crc32cPortable(const void* data, const std::size_t length,
+                             const std::uint32_t crc = 0);
+
+/**
+ * Returns the name of the implementation crc32c() uses: "sse4.2" or
+ * "portable".
+ */
+const char* crc32cImplementation();
+
+}  // namespace badgerdb
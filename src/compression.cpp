@@ -0,0 +1,195 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "compression.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace badgerdb {
+
+namespace {
+
+// A sequence starts with a token: the literal count in the high four bits and
+// the match length less kMinMatch in the low four.  A field of 15 continues
+// in bytes that are added to it, up to and including the first one below 255.
+// The literals follow, then the two-byte offset of the match.  The last
+// sequence has literals only.
+const std::size_t kMinMatch = 4;
+const std::size_t kMaxOffset = 65535;
+const int kHashBits = 12;
+
+std::uint32_t load32(const unsigned char* bytes) {
+  std::uint32_t value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+std::uint32_t hash(const std::uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - kHashBits);
+}
+
+// Writes the continuation bytes of a token field of value count, or returns
+// false if they do not fit before end.
+bool putLength(std::size_t count, unsigned char*& out,
+               const unsigned char* end) {
+  if (count < 15) return true;
+  for (count -= 15;; count -= 255) {
+    if (out == end) return false;
+    *out++ = count >= 255 ? 255 : count;
+    if (count < 255) return true;
+  }
+}
+
+// Reads the continuation bytes of a token field, or returns false if the
+// input ends first.
+bool getLength(std::size_t& count, const unsigned char*& in,
+               const unsigned char* end) {
+  if (count < 15) return true;
+  unsigned char byte;
+  do {
+    if (in == end) return false;
+    byte = *in++;
+    count += byte;
+  } while (byte == 255);
+  return true;
+}
+
+// Writes a sequence of literals and, if matchLength > 0, a match.
+bool putSequence(const unsigned char* literals, const std::size_t literalCount,
+                 const std::size_t offset, const std::size_t matchLength,
+                 unsigned char*& out, const unsigned char* end) {
+  const std::size_t matchField = matchLength > 0 ? matchLength - kMinMatch : 0;
+  if (out == end) return false;
+  *out++ = (literalCount < 15 ? literalCount : 15) << 4 |
+           (matchField < 15 ? matchField : 15);
+  if (!putLength(literalCount, out, end) ||
+      (std::size_t)(end - out) < literalCount) {
+    return false;
+  }
+  std::memcpy(out, literals, literalCount);
+  out += literalCount;
+  if (matchLength == 0) return true;
+  if (end - out < 2) return false;
+  *out++ = offset & 0xff;
+  *out++ = offset >> 8;
+  return putLength(matchField, out, end);
+}
+
+// Copies count bytes, eight at a time where the bytes after the source and
+// the destination, up to sourceRoom and destinationRoom of them, allow it.
+void copy(unsigned char* destination, const unsigned char* source,
+          const std::size_t count, const std::size_t sourceRoom,
+          const std::size_t destinationRoom) {
+  if (sourceRoom < count + 8 || destinationRoom < count + 8) {
+    std::memcpy(destination, source, count);
+    return;
+  }
+  for (std::size_t i = 0; i < count; i += 8) {
+    std::memcpy(destination + i, source + i, 8);
+  }
+}
+
+}  // namespace
+
+std::size_t lzCompress(const char* input, const std::size_t length,
+                       char* output, const std::size_t capacity) {
+  const unsigned char* const begin =
+      reinterpret_cast<const unsigned char*>(input);
+  const unsigned char* const end = begin + length;
+  unsigned char* out = reinterpret_cast<unsigned char*>(output);
+  const unsigned char* const outEnd = out + capacity;
+
+  // Position of the last occurrence of every hashed four-byte sequence.
+  std::uint32_t table[1 << kHashBits] = {0};
+  const unsigned char* in = begin;
+  const unsigned char* anchor = begin;
+  while (length >= kMinMatch && in <= end - kMinMatch) {
+    const std::uint32_t sequence = load32(in);
+    std::uint32_t& slot = table[hash(sequence)];
+    const unsigned char* match = begin + slot;
+    slot = in - begin;
+    if (match >= in || (std::size_t)(in - match) > kMaxOffset ||
+        load32(match) != sequence) {
+      in++;
+      continue;
+    }
+    std::size_t matchLength = kMinMatch;
+    while (in + matchLength < end && match[matchLength] == in[matchLength]) {
+      matchLength++;
+    }
+    if (!putSequence(anchor, in - anchor, in - match, matchLength, out,
+                     outEnd)) {
+      return 0;
+    }
+    in += matchLength;
+    anchor = in;
+  }
+  if (!putSequence(anchor, end - anchor, 0, 0, out, outEnd)) {
+    return 0;
+  }
+  return out - reinterpret_cast<unsigned char*>(output);
+}
+
+bool lzDecompress(const char* input, const std::size_t length, char* output,
+                  const std::size_t outputLength) {
+  const unsigned char* in = reinterpret_cast<const unsigned char*>(input);
+  const unsigned char* const end = in + length;
+  unsigned char* const begin = reinterpret_cast<unsigned char*>(output);
+  unsigned char* out = begin;
+  unsigned char* const outEnd = begin + outputLength;
+  // Input that stops after a match has lost its last sequence.
+  while (in < end) {
+    const unsigned char token = *in++;
+    std::size_t literalCount = token >> 4;
+    if (!getLength(literalCount, in, end) ||
+        (std::size_t)(end - in) < literalCount ||
+        (std::size_t)(outEnd - out) < literalCount) {
+      return false;
+    }
+    copy(out, in, literalCount, end - in, outEnd - out);
+    in += literalCount;
+    out += literalCount;
+    if (in == end) return out == outEnd;  // the last sequence
+
+    if (end - in < 2) return false;
+    const std::size_t offset = in[0] | in[1] << 8;
+    in += 2;
+    std::size_t matchLength = token & 15;
+    if (!getLength(matchLength, in, end)) return false;
+    matchLength += kMinMatch;
+    if (offset == 0 || offset > (std::size_t)(out - begin) ||
+        (std::size_t)(outEnd - out) < matchLength) {
+      return false;
+    }
+    const unsigned char* match = out - offset;
+    if (offset >= 8 && (std::size_t)(outEnd - out) >= matchLength + 8) {
+      // Eight bytes at a time never read what the same step writes, even
+      // if the match overlaps its copy.
+      copy(out, match, matchLength, outEnd - match, outEnd - out);
+      out += matchLength;
+    } else if (offset >= matchLength) {
+      std::memcpy(out, match, matchLength);
+      out += matchLength;
+    } else {
+      // The match overlaps what it produces, as a run does.  Copying all of
+      // it from the match on keeps the period and doubles the copy each time.
+      unsigned char* const stop = out + matchLength;
+      while (out < stop) {
+        const std::size_t count =
+            std::min<std::size_t>(out - match, stop - out);
+        std::memcpy(out, match, count);
+        out += count;
+      }
+    }
+  }
+  return false;
+}
+
+}  // namespace badgerdb
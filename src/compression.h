@@ -0,0 +1,43 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace badgerdb {
+
+/**
+ * Compresses a byte range with a fast LZ77 codec in the style of LZ4: a
+ * sequence of literal runs, each followed by a copy of earlier output at an
+ * offset of up to 64 KB.  Runs of zeros, as in the free space of a page, and
+ * repeated text compress well.
+ *
+ * @param input     Bytes to compress
+ * @param length    Number of bytes
+ * @param output    Where the compressed bytes go
+ * @param capacity  Size of output
+ * @return  Number of compressed bytes, or 0 if they do not fit in capacity
+ */
+std::size_t lzCompress(const char* input, const std::size_t length,
+                       char* output, const std::size_t capacity);
+
+/**
+ * Decompresses the output of lzCompress().
+ *
+ * @param input         Compressed bytes
+ * @param length        Number of compressed bytes
+ * @param output        Where the decompressed bytes go
+ * @param outputLength  Number of bytes the input decompresses to
+ * @return  False if the input is damaged or does not decompress to exactly
+ * outputLength bytes; output may then have been written to.
+ */
+bool lzDecompress(const char* input, const std::size_t length, char* output,
+                  const std::size_t outputLength);
+
+}  // namespace badgerdb
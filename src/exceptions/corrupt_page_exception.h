@@ -0,0 +1,64 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a page read from a file does not
+ *        match the checksum it was written with.
+ *
+ * The page was damaged on disk or in transit, or only part of it reached the
+ * disk.
+ */
+class CorruptPageException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a corrupt page exception for the given page number and
+   * filename.
+   *
+   * @param requested_number  Number of the page that failed verification.
+   * @param file              Name of file that request was made to.
+   */
+  CorruptPageException(const PageId requested_number, const std::string &file);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~CorruptPageException() throw() {}
+
+  /**
+   * Returns the number of the page that failed verification.
+   */
+  virtual PageId page_number() const { return page_number_; }
+
+  /**
+   * Returns name of the file that caused this exception.
+   */
+  virtual const std::string &filename() const { return filename_; }
+
+ protected:
+  /**
+   * Number of the page that failed verification.
+   */
+  const PageId page_number_;
+
+  /**
+   * Name of file which caused this exception.
+   */
+  const std::string filename_;
+};
+
+}  // namespace badgerdb
@@ -8,31 +8,51 @@
 
 #include "file.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <cassert>
+#include <climits>
+#include <cerrno>
+#include <cstddef>
 #include <cstdio>
-#include <fstream>
+#include <cstring>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <string>
 
+#include "compression.h"
+#include "exceptions/corrupt_page_exception.h"
 #include "exceptions/file_exists_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/io_exception.h"
 #include "file_iterator.h"
+#include "io_engine.h"
 #include "page.h"
 
 namespace badgerdb {
 
-File::StreamMap File::open_streams_;
 File::CountMap File::open_counts_;
+File::FdMap File::open_fds_;
+File::IdMap File::open_ids_;
+File::OpenFileMap File::open_files_;
+std::vector<std::string> File::id_names_;
+std::vector<FileId> File::free_ids_;
+std::mutex File::registry_mutex_;
 
-File File::create(const std::string &filename) {
-  return File(filename, true /* create_new */);
+File File::create(const std::string &filename, const FileFormat format) {
+  return File(filename, true /* create_new */, FileBackend::PREAD, format);
 }
 
-File File::open(const std::string &filename) {
-  return File(filename, false /* create_new */);
+File File::open(const std::string &filename, const FileBackend backend) {
+  return File(filename, false /* create_new */, backend);
 }
 
 void File::remove(const std::string &filename) {
@@ -43,30 +63,36 @@ void File::remove(const std::string &filename) {
     throw FileOpenException(filename);
   }
   std::remove(filename.c_str());
+  std::remove(locationMapFilename(filename).c_str());
 }
 
 bool File::isOpen(const std::string &filename) {
   if (!exists(filename)) {
     return false;
   }
+  std::lock_guard<std::mutex> guard(registry_mutex_);
   return open_counts_.find(filename) != open_counts_.end();
 }
 
 bool File::exists(const std::string &filename) {
-  std::fstream file(filename);
-  if (file) {
-    file.close();
-    return true;
-  }
+  return access(filename.c_str(), F_OK) == 0;
+}
 
-  return false;
+std::string File::filename(const FileId file_id) {
+  std::lock_guard<std::mutex> guard(registry_mutex_);
+  return id_names_[file_id];
 }
 
 File::File(const File &other)
     : filename_(other.filename_),
-      stream_(open_streams_[filename_]),
+      fd_(other.fd_),
+      id_(other.id_),
       valid_(other.valid_) {
-  ++open_counts_[filename_];
+  if (valid_) {
+    std::lock_guard<std::mutex> guard(registry_mutex_);
+    open_file_ = open_files_[filename_];
+    ++open_counts_[filename_];
+  }
 }
 
 File &File::operator=(const File &rhs) {
@@ -74,77 +100,123 @@ File &File::operator=(const File &rhs) {
   // same file.
   close();  // close my file and associate me with the new one
   filename_ = rhs.filename_;
+  fd_ = -1;
+  id_ = INVALID_ID;
   valid_ = rhs.valid_;
-  openIfNeeded(false /* create_new */);
+  if (valid_) {
+    openIfNeeded(false /* create_new */);
+  }
   return *this;
 }
 
 File::~File() { close(); }
 
 Page File::allocatePage() {
-  FileHeader header = readHeader();
-  Page new_page;
-  Page existing_page;
-  if (header.num_free_pages > 0) {
-    new_page = readPage(header.first_free_page, true /* allow_free */);
-    new_page.set_page_number(header.first_free_page);
-    header.first_free_page = new_page.next_page_number();
-    --header.num_free_pages;
-
-    if (header.first_used_page == Page::INVALID_NUMBER ||
-        header.first_used_page > new_page.page_number()) {
-      // Either have no pages used or the head of the used list is a page
-      // later than the one we just allocated, so add the new page to the
-      // head.
-      if (header.first_used_page > new_page.page_number()) {
-        new_page.set_next_page_number(header.first_used_page);
-      }
-      header.first_used_page = new_page.page_number();
+  Page new_page{Page::Uninitialized()};
+  allocatePage(new_page);
+  return new_page;
+}
+
+void File::allocatePage(Page &new_page) {
+  allocatePage(Page::INVALID_NUMBER, new_page);
+}
+
+bool File::allocatePage(const PageId expected_page, Page &new_page) {
+  PageId page_number;
+  PageId previous_page;
+  PageId next_page;
+  {
+    std::lock_guard<std::mutex> guard(open_file_->latch);
+    FileHeader &header = open_file_->header;
+    page_number = header.num_free_pages > 0 ? header.first_free_page
+                                            : header.num_pages;
+    if (expected_page != Page::INVALID_NUMBER && page_number != expected_page) {
+      return false;
+    }
+    // The used list is sorted by page number, so the new page goes after the
+    // closest used page before it.  The bitmap finds that page without
+    // walking the list.  Headers are read before anything changes.
+    if (header.num_free_pages > 0) {
+      loadPage(page_number);
+    }
+    previous_page = previousUsed(page_number);
+    if (header.num_free_pages > 0) {
+      // Reuse the head of the free list.
+      header.first_free_page = open_file_->next_pages[page_number];
+      --header.num_free_pages;
+      assert((header.num_free_pages == 0) ==
+             (header.first_free_page == Page::INVALID_NUMBER));
     } else {
-      // New page is reused from somewhere after the beginning, so we need
-      // to find where in the used list to insert it.
-      PageId next_page_number = Page::INVALID_NUMBER;
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        next_page_number = (*iter).next_page_number();
-        if (next_page_number > new_page.page_number() ||
-            next_page_number == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      existing_page.set_next_page_number(new_page.page_number());
-      new_page.set_next_page_number(next_page_number);
+      ++header.num_pages;
     }
-
-    assert((header.num_free_pages == 0) ==
-           (header.first_free_page == Page::INVALID_NUMBER));
-  } else {
-    new_page.set_page_number(header.num_pages);
-    if (header.first_used_page == Page::INVALID_NUMBER) {
-      header.first_used_page = new_page.page_number();
+    if (previous_page == Page::INVALID_NUMBER) {
+      next_page = header.first_used_page;
+      header.first_used_page = page_number;
     } else {
-      // If we have pages allocated, we need to add the new page to the
-      // tail of the linked list.
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        if ((*iter).next_page_number() == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
+      next_page = open_file_->next_pages[previous_page];
+      open_file_->setPage(previous_page, page_number, true /* used */);
+      open_file_->dirty_links.push_back(previous_page);
+    }
+    open_file_->setPage(page_number, next_page, true /* used */);
+    open_file_->header_dirty = true;
+  }
+
+  new_page.initialize();
+  new_page.set_page_number(page_number);
+  new_page.set_next_page_number(next_page);
+  // The link from the previous page is written with the file header.
+  writePage(page_number, new_page);
+  growMapping(page_number + 1);
+  return true;
+}
+
+bool File::redoAllocation(const PageId page_number) {
+  PageId first_page;
+  {
+    std::lock_guard<std::mutex> guard(open_file_->latch);
+    FileHeader &header = open_file_->header;
+    if (page_number < header.num_pages) {
+      return false;
+    }
+    first_page = header.num_pages;
+    // Each page goes at the end of the used list, as allocatePage() would
+    // link a new page.
+    for (PageId new_page = first_page; new_page <= page_number; new_page++) {
+      const PageId previous_page = previousUsed(new_page);
+      if (previous_page == Page::INVALID_NUMBER) {
+        header.first_used_page = new_page;
+      } else {
+        open_file_->setPage(previous_page, new_page, true /* used */);
+        open_file_->dirty_links.push_back(previous_page);
       }
-      assert(existing_page.isUsed());
-      existing_page.set_next_page_number(new_page.page_number());
+      open_file_->setPage(new_page, Page::INVALID_NUMBER, true /* used */);
+      header.num_pages = new_page + 1;
     }
-    ++header.num_pages;
+    open_file_->header_dirty = true;
   }
-  writePage(new_page.page_number(), new_page);
-  if (existing_page.page_number() != Page::INVALID_NUMBER) {
-    // If we updated an existing page by inserting the new page into the
-    // used list, we need to write it out.
-    writePage(existing_page.page_number(), existing_page);
+  growMapping(page_number + 1);
+
+  for (PageId new_page = first_page; new_page < page_number; new_page++) {
+    Page existing{Page::Uninitialized()};
+    try {
+      readPage(new_page, false /* allow_free */, existing);
+      if (existing.page_number() == new_page) {
+        continue;
+      }
+    } catch (const InvalidPageException &e) {
+    } catch (const CorruptPageException &e) {
+    }
+    Page empty{Page::Uninitialized()};
+    empty.initialize();
+    empty.set_page_number(new_page);
+    writePage(empty);
   }
-  writeHeader(header);
+  return true;
+}
 
-  return new_page;
+PageId File::nextAllocatedPage() const {
+  const FileHeader header = readHeader();
+  return header.num_free_pages > 0 ? header.first_free_page : header.num_pages;
 }
 
 Page File::readPage(const PageId page_number) const {
@@ -152,64 +224,237 @@ Page File::readPage(const PageId page_number) const {
   if (page_number >= header.num_pages) {
     throw InvalidPageException(page_number, filename_);
   }
-  return readPage(page_number, false /* allow_free */);
+  Page page = readPage(page_number, false /* allow_free */);
+  // The next page pointer on disk may not be repaired yet.
+  std::lock_guard<std::mutex> guard(open_file_->latch);
+  page.set_next_page_number(
+      open_file_->nextPage(page_number, page.next_page_number()));
+  return page;
 }
 
 Page File::readPage(const PageId page_number, const bool allow_free) const {
-  Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char *>(&page.header_), sizeof(page.header_));
-  stream_->read(&page.data_[0], Page::DATA_SIZE);
-  if (!allow_free && !page.isUsed()) {
+  Page page{Page::Uninitialized()};
+  readPage(page_number, allow_free, page);
+  return page;
+}
+
+void File::readPage(const PageId page_number, const bool allow_free,
+                    Page &into) const {
+  if (open_file_->compressed) {
+    readCompressed(page_number, into);
+  } else if (!readMapped(page_number, &into, Page::SIZE)) {
+    // A Page is the on-disk image, so one read fills header and data.
+    ssize_t result;
+    do {
+      result = pread(fd_, &into, Page::SIZE, pagePosition(page_number));
+    } while (result < 0 && errno == EINTR);
+    if (result < 0) {
+      throw IoException(filename_, errno);
+    }
+    if (result < (ssize_t)Page::SIZE) {
+      // Past the end of the file.
+      throw InvalidPageException(page_number, filename_);
+    }
+  }
+  verifyPage(page_number, into, allow_free);
+  open_file_->notePage(page_number, into);
+}
+
+void File::readPage(const PageId page_number, Page &into) const {
+  if (page_number == Page::INVALID_NUMBER) {
     throw InvalidPageException(page_number, filename_);
   }
+  readPage(page_number, false /* allow_free */, into);
+}
 
-  return page;
+void File::readPages(const PageId first_page, const std::uint32_t count,
+                     Page *const *into) const {
+  if (count > 0 && first_page == Page::INVALID_NUMBER) {
+    throw InvalidPageException(first_page, filename_);
+  }
+  if (open_file_->mapped || open_file_->compressed) {
+    for (std::uint32_t i = 0; i < count; i++) {
+      readPage(first_page + i, *into[i]);
+    }
+    return;
+  }
+  std::vector<struct iovec> iov;
+  for (std::uint32_t done = 0; done < count;) {
+    const std::uint32_t batch = std::min<std::uint32_t>(count - done, IOV_MAX);
+    iov.resize(batch);
+    for (std::uint32_t i = 0; i < batch; i++) {
+      iov[i] = {into[done + i], Page::SIZE};
+    }
+    ssize_t result;
+    do {
+      result = preadv(fd_, iov.data(), batch,
+                      pagePosition(first_page + done));
+    } while (result < 0 && errno == EINTR);
+    if (result < 0) {
+      throw IoException(filename_, errno);
+    }
+    // A short read ends at the end of the file.
+    const std::uint32_t complete = result / Page::SIZE;
+    for (std::uint32_t i = 0; i < batch; i++) {
+      if (i >= complete) {
+        throw InvalidPageException(first_page + done + i, filename_);
+      }
+      verifyPage(first_page + done + i, *into[done + i]);
+      open_file_->notePage(first_page + done + i, *into[done + i]);
+    }
+    done += batch;
+  }
 }
 
-void File::writePage(const Page &new_page) {
-  PageHeader header = readPageHeader(new_page.page_number());
-  if (header.current_page_number == Page::INVALID_NUMBER) {
-    // Page has been deleted since it was read.
-    throw InvalidPageException(new_page.page_number(), filename_);
+void File::readPageAsync(const PageId page_number, Page &into,
+                         ReadCallback done) const {
+  if (page_number == Page::INVALID_NUMBER) {
+    done(std::make_exception_ptr(
+        InvalidPageException(page_number, filename_)));
+    return;
+  }
+  if (open_file_->compressed) {
+    // Decompressing needs the extent in a buffer first; read it right away.
+    try {
+      readPage(page_number, into);
+    } catch (const BadgerDbException &e) {
+      done(std::current_exception());
+      return;
+    }
+    done(nullptr);
+    return;
   }
+
+  // Read the header and the data straight into the page object; the iovecs
+  // live until the read completed.
+  std::shared_ptr<struct iovec> iov(new struct iovec[2],
+                                    std::default_delete<struct iovec[]>());
+  iov.get()[0] = {&into.header_, sizeof(into.header_)};
+  iov.get()[1] = {&into.data_[0], Page::DATA_SIZE};
+  const std::string filename = filename_;
+  const Page *page = &into;
+  const bool verify = open_file_->verify_checksums;
+  const std::shared_ptr<OpenFile> open_file = open_file_;
+  IoEngine::shared().submit(
+      IoOp::READ, fd_, iov.get(), 2, pagePosition(page_number),
+      [iov, filename, open_file, page_number, page, verify,
+       done](const ssize_t result) {
+        if (result < 0) {
+          done(std::make_exception_ptr(IoException(filename, -result)));
+          return;
+        }
+        if (result < (ssize_t)Page::SIZE) {
+          // Past the end of the file.
+          done(std::make_exception_ptr(
+              InvalidPageException(page_number, filename)));
+          return;
+        }
+        try {
+          verifyPage(filename, page_number, *page, verify,
+                     false /* allow_free */);
+          open_file->notePage(page_number, *page);
+        } catch (const BadgerDbException &e) {
+          done(std::current_exception());
+          return;
+        }
+        done(nullptr);
+      });
+}
+
+void File::writePage(const Page &new_page) {
+  const PageId page_number = new_page.page_number();
   // Page on disk may have had its next page pointer updated since it was read;
   // we don't modify that, but we do keep all the other modifications to the
   // page header.
-  const PageId next_page_number = header.next_page_number;
-  header = new_page.header_;
-  header.next_page_number = next_page_number;
-  writePage(new_page.page_number(), header, new_page);
+  PageHeader header = new_page.header_;
+  {
+    std::lock_guard<std::mutex> guard(open_file_->latch);
+    loadPage(page_number);
+    if (!open_file_->isUsed(page_number)) {
+      // Page has been deleted since it was read.
+      throw InvalidPageException(page_number, filename_);
+    }
+    header.next_page_number = open_file_->next_pages[page_number];
+  }
+  writePage(page_number, header, new_page);
 }
 
-void File::deletePage(const PageId page_number) {
-  FileHeader header = readHeader();
-  Page existing_page = readPage(page_number);
-  Page previous_page;
-  // If this page is the head of the used list, update the header to point to
-  // the next page in line.
-  if (page_number == header.first_used_page) {
-    header.first_used_page = existing_page.next_page_number();
-  } else {
-    // Walk the used list so we can update the page that points to this one.
-    for (FileIterator iter = begin(); iter != end(); ++iter) {
-      previous_page = *iter;
-      if (previous_page.next_page_number() == existing_page.page_number()) {
-        previous_page.set_next_page_number(existing_page.next_page_number());
-        break;
+void File::writePages(const PageId first_page, const std::uint32_t count,
+                      Page *const *pages) {
+  if (open_file_->compressed) {
+    // Every page goes to its own extent anyway.
+    for (std::uint32_t i = 0; i < count; i++) {
+      writePage(*pages[i]);
+    }
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> guard(open_file_->latch);
+    for (std::uint32_t i = 0; i < count; i++) {
+      const PageId page_number = first_page + i;
+      loadPage(page_number);
+      if (!open_file_->isUsed(page_number)) {
+        // Page has been deleted since it was read.
+        throw InvalidPageException(page_number, filename_);
       }
+      pages[i]->set_next_page_number(open_file_->next_pages[page_number]);
+    }
+  }
+  for (std::uint32_t i = 0; i < count; i++) {
+    pages[i]->header_.checksum =
+        Page::computeChecksum(pages[i]->header_, pages[i]->data_);
+  }
+
+  std::vector<struct iovec> iov;
+  for (std::uint32_t done = 0; done < count;) {
+    const std::uint32_t batch = std::min<std::uint32_t>(count - done, IOV_MAX);
+    iov.resize(batch);
+    for (std::uint32_t i = 0; i < batch; i++) {
+      iov[i] = {pages[done + i], Page::SIZE};
+    }
+    ssize_t result;
+    do {
+      result = pwritev(fd_, iov.data(), batch,
+                       pagePosition(first_page + done));
+    } while (result < 0 && errno == EINTR);
+    if (result <= 0) {
+      throw IoException(filename_, result < 0 ? errno : EIO);
     }
+    // After a short write, the partly written page is written again.
+    done += result / Page::SIZE;
   }
-  // Clear the page and add it to the head of the free list.
-  existing_page.initialize();
-  existing_page.set_next_page_number(header.first_free_page);
-  header.first_free_page = page_number;
-  ++header.num_free_pages;
-  if (previous_page.isUsed()) {
-    writePage(previous_page.page_number(), previous_page);
+}
+
+void File::sync() { persistHeader(); }
+
+void File::deletePage(const PageId page_number) {
+  Page existing_page;
+  {
+    std::lock_guard<std::mutex> guard(open_file_->latch);
+    loadPage(page_number);
+    if (!open_file_->isUsed(page_number)) {
+      throw InvalidPageException(page_number, filename_);
+    }
+    FileHeader &header = open_file_->header;
+    // The predecessor in the used list is the closest used page before this
+    // one, so the bitmap finds it without walking the list.
+    const PageId next_page = open_file_->next_pages[page_number];
+    const PageId previous_page = previousUsed(page_number);
+    if (previous_page == Page::INVALID_NUMBER) {
+      header.first_used_page = next_page;
+    } else {
+      open_file_->setPage(previous_page, next_page, true /* used */);
+      open_file_->dirty_links.push_back(previous_page);
+    }
+    // Clear the page and add it to the head of the free list.
+    existing_page.set_next_page_number(header.first_free_page);
+    open_file_->setPage(page_number, header.first_free_page,
+                        false /* used */);
+    header.first_free_page = page_number;
+    ++header.num_free_pages;
+    open_file_->header_dirty = true;
   }
   writePage(page_number, existing_page);
-  writeHeader(header);
 }
 
 FileIterator File::begin() {
@@ -219,26 +464,47 @@ FileIterator File::begin() {
 
 FileIterator File::end() { return FileIterator(this, Page::INVALID_NUMBER); }
 
-File::File(const std::string &name, const bool create_new)
-    : filename_(name), valid_(true) {
+File::File(const std::string &name, const bool create_new,
+           const FileBackend backend, const FileFormat format)
+    : filename_(name), fd_(-1), id_(INVALID_ID), valid_(true) {
   openIfNeeded(create_new);
 
   if (create_new) {
+    if (format == FileFormat::COMPRESSED) {
+      try {
+        openLocationMap(true /* create_new */);
+      } catch (...) {
+        close();
+        throw;
+      }
+    }
     // File starts with 1 page (the header).
     FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
-                         0 /* num_free_pages */, 0 /* first_free_page */};
+                         0 /* num_free_pages */, 0 /* first_free_page */,
+                         format};
     writeHeader(header);
+    persistHeader();
+  }
+  if (backend == FileBackend::MMAP) {
+    try {
+      mapFile();
+    } catch (...) {
+      close();
+      throw;
+    }
   }
 }
 
 void File::openIfNeeded(const bool create_new) {
+  std::lock_guard<std::mutex> guard(registry_mutex_);
   if (open_counts_.find(filename_) !=
       open_counts_.end()) {  // exists an entry already
     ++open_counts_[filename_];
-    stream_ = open_streams_[filename_];
+    fd_ = open_fds_[filename_];
+    id_ = open_ids_[filename_];
+    open_file_ = open_files_[filename_];
   } else {
-    std::ios_base::openmode mode =
-        std::fstream::in | std::fstream::out | std::fstream::binary;
+    int flags = O_RDWR;
     const bool already_exists = exists(filename_);
     if (create_new) {
       // Error if we try to overwrite an existing file.
@@ -246,7 +512,7 @@ void File::openIfNeeded(const bool create_new) {
         throw FileExistsException(filename_);
       }
       // New files have to be truncated on open.
-      mode = mode | std::fstream::trunc;
+      flags |= O_CREAT | O_TRUNC;
     } else {
       // Error if we try to open a file that doesn't exist.
       if (!already_exists) {
@@ -254,18 +520,86 @@ void File::openIfNeeded(const bool create_new) {
         throw FileNotFoundException(filename_);
       }
     }
-    stream_.reset(new std::fstream(filename_, mode));
-    open_streams_[filename_] = stream_;
+    do {
+      fd_ = ::open(filename_.c_str(), flags, 0644);
+    } while (fd_ < 0 && errno == EINTR);
+    if (fd_ < 0) {
+      valid_ = false;
+      throw IoException(filename_, errno);
+    }
+    open_file_ = std::make_shared<OpenFile>();
+    if (!create_new) {
+      const ssize_t result = pread(fd_, &open_file_->header,
+                                   sizeof(open_file_->header), 0 /* offset */);
+      if (result != (ssize_t)sizeof(open_file_->header)) {
+        const int error = result < 0 ? errno : EIO;
+        ::close(fd_);
+        open_file_.reset();
+        valid_ = false;
+        throw IoException(filename_, error);
+      }
+      open_file_->disk_num_pages = open_file_->header.num_pages;
+      if (open_file_->header.format == FileFormat::COMPRESSED) {
+        try {
+          openLocationMap(false /* create_new */);
+        } catch (...) {
+          ::close(fd_);
+          open_file_.reset();
+          valid_ = false;
+          throw;
+        }
+      }
+    }
+    open_fds_[filename_] = fd_;
+    open_files_[filename_] = open_file_;
     open_counts_[filename_] = 1;
+
+    // Hand out the lowest free id so that ids stay dense.
+    if (free_ids_.empty()) {
+      id_ = id_names_.size();
+      id_names_.push_back(filename_);
+    } else {
+      std::pop_heap(free_ids_.begin(), free_ids_.end(), std::greater<FileId>());
+      id_ = free_ids_.back();
+      free_ids_.pop_back();
+      id_names_[id_] = filename_;
+    }
+    open_ids_[filename_] = id_;
   }
 }
 
 void File::close() {
+  if (!valid_) {
+    return;
+  }
+  std::lock_guard<std::mutex> guard(registry_mutex_);
   --open_counts_[filename_];
-  stream_.reset();
+  if (open_counts_[filename_] == 0 &&
+      (open_file_->header_dirty || !open_file_->dirty_links.empty() ||
+       open_file_->locations_dirty)) {
+    try {
+      persistHeader();
+    } catch (const IoException &e) {
+      // Nothing can be done about it while closing; the header on disk stays
+      // the one of the last sync.
+    }
+  }
+  if (open_counts_[filename_] == 0 && open_file_->map != nullptr) {
+    munmap(open_file_->map, open_file_->map_length);
+  }
+  if (open_counts_[filename_] == 0 && open_file_->locations_fd >= 0) {
+    ::close(open_file_->locations_fd);
+  }
+  open_file_.reset();
   if (open_counts_[filename_] == 0) {
-    open_streams_.erase(filename_);
+    ::close(fd_);
+    open_fds_.erase(filename_);
+    open_files_.erase(filename_);
     open_counts_.erase(filename_);
+    open_ids_.erase(filename_);
+    id_names_[id_].clear();
+    free_ids_.push_back(id_);
+    std::push_heap(free_ids_.begin(), free_ids_.end(), std::greater<FileId>());
   }
 }
 
@@ -275,32 +609,638 @@ void File::writePage(const PageId page_number, const Page &new_page) {
 
 void File::writePage(const PageId page_number, const PageHeader &header,
                      const Page &new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char *>(&header), sizeof(header));
-  stream_->write(&new_page.data_[0], Page::DATA_SIZE);
-  stream_->flush();
+  {
+    std::lock_guard<std::mutex> guard(open_file_->latch);
+    if (open_file_->isKnown(page_number)) {
+      open_file_->setPage(page_number, header.next_page_number,
+                          header.current_page_number != Page::INVALID_NUMBER);
+    }
+  }
+
+  PageHeader stamped = header;
+  stamped.checksum = Page::computeChecksum(header, new_page.data_);
+  if (open_file_->compressed) {
+    writeCompressed(page_number, stamped, new_page.data_);
+    return;
+  }
+
+  // Header and data are written together with one system call.  After a
+  // short write, the page is written again.
+  struct iovec iov[2] = {
+      {&stamped, sizeof(stamped)},
+      {const_cast<char *>(&new_page.data_[0]), Page::DATA_SIZE}};
+  ssize_t result;
+  do {
+    result = pwritev(fd_, iov, 2, pagePosition(page_number));
+  } while ((result < 0 && errno == EINTR) ||
+           (result > 0 && result < (ssize_t)Page::SIZE));
+  if (result <= 0) {
+    throw IoException(filename_, result < 0 ? errno : EIO);
+  }
+}
+
+void File::writeNextPageNumber(const PageId page_number,
+                               const PageId next_page_number) {
+  off_t position;
+  {
+    std::lock_guard<std::mutex> guard(open_file_->latch);
+    position = headerPosition(page_number);
+  }
+  if (position < 0) {
+    return;  // never written, so there is nothing to repair
+  }
+  ssize_t result;
+  do {
+    result = pwrite(fd_, &next_page_number, sizeof(next_page_number),
+                    position + (off_t)offsetof(PageHeader, next_page_number));
+  } while (result < 0 && errno == EINTR);
+  if (result != (ssize_t)sizeof(next_page_number)) {
+    throw IoException(filename_, result < 0 ? errno : EIO);
+  }
 }
 
 FileHeader File::readHeader() const {
+  std::lock_guard<std::mutex> guard(open_file_->latch);
+  return open_file_->header;
+}
+
+void File::writeHeader(const FileHeader &header) {
+  std::lock_guard<std::mutex> guard(open_file_->latch);
+  open_file_->header = header;
+  open_file_->header_dirty = true;
+}
+
+void File::persistHeader() {
+  // Repaired links go out in page order.  A link into a page the header on
+  // disk does not cover yet waits until the header that grows num_pages is
+  // durable; otherwise a crash in between leaves the chain pointing past the
+  // end of the file, and the page would be handed out a second time.
+  std::vector<std::pair<PageId, PageId>> links;
+  std::vector<std::pair<PageId, PageId>> late_links;
+  {
+    std::lock_guard<std::mutex> guard(open_file_->latch);
+    std::vector<PageId> &dirty_links = open_file_->dirty_links;
+    std::sort(dirty_links.begin(), dirty_links.end());
+    dirty_links.erase(std::unique(dirty_links.begin(), dirty_links.end()),
+                      dirty_links.end());
+    for (const PageId page_number : dirty_links) {
+      const PageId next_page_number = open_file_->next_pages[page_number];
+      if (next_page_number != Page::INVALID_NUMBER &&
+          next_page_number >= open_file_->disk_num_pages) {
+        late_links.emplace_back(page_number, next_page_number);
+      } else {
+        links.emplace_back(page_number, next_page_number);
+      }
+    }
+    dirty_links.clear();
+  }
+  try {
+    persistLinks(links);
+  } catch (const IoException &e) {
+    std::lock_guard<std::mutex> guard(open_file_->latch);
+    for (const auto &link : late_links) {
+      open_file_->dirty_links.push_back(link.first);
+    }
+    throw;
+  }
+  if (open_file_->compressed) {
+    persistLocationMap();
+  }
   FileHeader header;
-  stream_->seekg(0 /* pos */, std::ios::beg);
-  stream_->read(reinterpret_cast<char *>(&header), sizeof(header));
+  bool header_dirty;
+  {
+    std::lock_guard<std::mutex> guard(open_file_->latch);
+    header_dirty = open_file_->header_dirty;
+    header = open_file_->header;
+    open_file_->header_dirty = false;
+  }
+  if (header_dirty) {
+    ssize_t result;
+    do {
+      result = pwrite(fd_, &header, sizeof(header), 0 /* offset */);
+    } while (result < 0 && errno == EINTR);
+    if (result != (ssize_t)sizeof(header) || fsync(fd_) != 0) {
+      const int error = result < 0 ? errno : EIO;
+      std::lock_guard<std::mutex> guard(open_file_->latch);
+      open_file_->header_dirty = true;
+      for (const auto &link : late_links) {
+        open_file_->dirty_links.push_back(link.first);
+      }
+      throw IoException(filename_, error);
+    }
+    std::lock_guard<std::mutex> guard(open_file_->latch);
+    open_file_->disk_num_pages =
+        std::max(open_file_->disk_num_pages, header.num_pages);
+  }
+  if (!late_links.empty()) {
+    persistLinks(late_links);
+  }
+}
 
-  return header;
+void File::persistLinks(
+    const std::vector<std::pair<PageId, PageId>> &links) {
+  for (std::size_t i = 0; i < links.size(); i++) {
+    try {
+      writeNextPageNumber(links[i].first, links[i].second);
+    } catch (const IoException &e) {
+      std::lock_guard<std::mutex> guard(open_file_->latch);
+      for (; i < links.size(); i++) {
+        open_file_->dirty_links.push_back(links[i].first);
+      }
+      throw;
+    }
+  }
+  if (fsync(fd_) != 0) {
+    const int error = errno;
+    std::lock_guard<std::mutex> guard(open_file_->latch);
+    for (const auto &link : links) {
+      open_file_->dirty_links.push_back(link.first);
+    }
+    throw IoException(filename_, error);
+  }
 }
 
-void File::writeHeader(const FileHeader &header) {
-  stream_->seekp(0 /* pos */, std::ios::beg);
-  stream_->write(reinterpret_cast<const char *>(&header), sizeof(header));
-  stream_->flush();
+void File::loadPage(const PageId page_number) const {
+  const FileHeader &header = open_file_->header;
+  if (page_number == Page::INVALID_NUMBER ||
+      page_number >= header.num_pages || open_file_->isKnown(page_number)) {
+    return;
+  }
+  // A page without a location, or past the end of a file that was cut
+  // short, is not in the used list.
+  PageHeader page_header;
+  page_header.current_page_number = Page::INVALID_NUMBER;
+  page_header.next_page_number = Page::INVALID_NUMBER;
+  const off_t position = headerPosition(page_number);
+  if (position >= 0) {
+    ssize_t result;
+    do {
+      result = pread(fd_, &page_header, sizeof(page_header), position);
+    } while (result < 0 && errno == EINTR);
+    if (result < 0) {
+      throw IoException(filename_, errno);
+    }
+    if (result < (ssize_t)sizeof(page_header)) {
+      page_header.current_page_number = Page::INVALID_NUMBER;
+      page_header.next_page_number = Page::INVALID_NUMBER;
+    }
+  }
+  open_file_->setPage(page_number,
+                      open_file_->nextPage(page_number,
+                                           page_header.next_page_number),
+                      page_header.current_page_number !=
+                          Page::INVALID_NUMBER);
+}
+
+void File::OpenFile::notePage(const PageId page_number, const Page &page) {
+  std::lock_guard<std::mutex> guard(latch);
+  if (page_number >= header.num_pages || isKnown(page_number)) {
+    return;
+  }
+  setPage(page_number, nextPage(page_number, page.next_page_number()),
+          page.isUsed());
+}
+
+void File::OpenFile::setPage(const PageId page_number,
+                             const PageId next_page_number, const bool used) {
+  if (page_number >= next_pages.size()) {
+    next_pages.resize(page_number + 1, Page::INVALID_NUMBER);
+    used_pages.resize(page_number / 64 + 1, 0);
+    known_pages.resize(page_number / 64 + 1, 0);
+  }
+  next_pages[page_number] = next_page_number;
+  const std::uint64_t bit = std::uint64_t(1) << (page_number % 64);
+  known_pages[page_number / 64] |= bit;
+  if (used) {
+    used_pages[page_number / 64] |= bit;
+  } else {
+    used_pages[page_number / 64] &= ~bit;
+  }
+}
+
+void File::OpenFile::markLocations(const PageId from, const PageId to) {
+  if (!locations_dirty) {
+    locations_dirty = true;
+    locations_dirty_from = from;
+    locations_dirty_to = to;
+    return;
+  }
+  locations_dirty_from = std::min(locations_dirty_from, from);
+  locations_dirty_to = std::max(locations_dirty_to, to);
+}
+
+PageId File::previousUsed(const PageId page_number) const {
+  // Scan the bitmaps backwards, one word at a time, from the page before.
+  // Of the used and the unknown pages in a word, the highest one decides:
+  // a used page is the answer, an unknown one is read first.
+  const OpenFile &file = *open_file_;
+  PageId end = page_number;
+  while (end > 1) {
+    const PageId before = end - 1;
+    const std::size_t word = before / 64;
+    std::uint64_t mask = ~std::uint64_t(0) >> (63 - before % 64);
+    if (word == 0) {
+      mask &= ~std::uint64_t(1);  // there is no page 0
+    }
+    const std::uint64_t known =
+        word < file.known_pages.size() ? file.known_pages[word] : 0;
+    const std::uint64_t used = known == 0 ? 0 : file.used_pages[word] & mask;
+    const std::uint64_t unknown = ~known & mask;
+    // The two sets of bits are disjoint, so the larger one has the highest.
+    if (used > unknown) {
+      return word * 64 + 63 - __builtin_clzll(used);
+    }
+    if (unknown == 0) {
+      end = word * 64;
+      continue;
+    }
+    loadPage(word * 64 + 63 - __builtin_clzll(unknown));
+  }
+  return Page::INVALID_NUMBER;
+}
+
+const Page *File::viewPage(const PageId page_number) const {
+  std::shared_lock<std::shared_timed_mutex> guard(open_file_->map_latch);
+  if (open_file_->map == nullptr) {
+    throw IoException(filename_, ENOTSUP);
+  }
+  if (page_number == Page::INVALID_NUMBER ||
+      page_number >= open_file_->map_pages) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  const Page *page = reinterpret_cast<const Page *>(
+      open_file_->map + pagePosition(page_number));
+  verifyPage(page_number, *page);
+  return page;
+}
+
+void File::advise(const FileAdvice advice) const {
+  static const int kMadvise[] = {MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM,
+                                 MADV_WILLNEED};
+  static const int kFadvise[] = {POSIX_FADV_NORMAL, POSIX_FADV_SEQUENTIAL,
+                                 POSIX_FADV_RANDOM, POSIX_FADV_WILLNEED};
+  const int index = static_cast<int>(advice);
+  std::shared_lock<std::shared_timed_mutex> guard(open_file_->map_latch);
+  if (open_file_->map != nullptr) {
+    // The whole mapping: advising part of it would split it in two, which
+    // mremap() cannot grow.
+    if (madvise(open_file_->map, open_file_->map_length, kMadvise[index]) !=
+        0) {
+      throw IoException(filename_, errno);
+    }
+    return;
+  }
+  const int error = posix_fadvise(fd_, 0, 0, kFadvise[index]);
+  if (error != 0) {
+    throw IoException(filename_, error);
+  }
+}
+
+FileBackend File::backend() const {
+  return open_file_->mapped ? FileBackend::MMAP : FileBackend::PREAD;
+}
+
+void File::verifyChecksums(const bool verify) {
+  open_file_->verify_checksums = verify;
+}
+
+bool File::verifiesChecksums() const { return open_file_->verify_checksums; }
+
+FileFormat File::format() const { return readHeader().format; }
+
+void File::mapFile() {
+  if (open_file_->compressed) {
+    // The mapping would hold compressed extents, not pages.
+    throw IoException(filename_, ENOTSUP);
+  }
+  std::lock_guard<std::shared_timed_mutex> guard(open_file_->map_latch);
+  if (open_file_->map != nullptr) {
+    return;
+  }
+  const PageId num_pages = readHeader().num_pages;
+  const std::size_t length = mappingLength(num_pages);
+  void *map = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd_, 0);
+  if (map == MAP_FAILED) {
+    throw IoException(filename_, errno);
+  }
+  open_file_->map = static_cast<char *>(map);
+  open_file_->map_length = length;
+  open_file_->map_pages = num_pages;
+  open_file_->mapped = true;
+}
+
+void File::growMapping(const PageId num_pages) {
+  if (!open_file_->mapped) {
+    return;
+  }
+  std::lock_guard<std::shared_timed_mutex> guard(open_file_->map_latch);
+  if (num_pages <= open_file_->map_pages) {
+    return;
+  }
+  if ((std::size_t)pagePosition(num_pages) > open_file_->map_length) {
+    const std::size_t length = mappingLength(num_pages);
+    void *map = mremap(open_file_->map, open_file_->map_length, length,
+                       MREMAP_MAYMOVE);
+    if (map == MAP_FAILED) {
+      throw IoException(filename_, errno);
+    }
+    open_file_->map = static_cast<char *>(map);
+    open_file_->map_length = length;
+  }
+  open_file_->map_pages = num_pages;
+}
+
+bool File::readMapped(const PageId page_number, void *into,
+                      const std::size_t length) const {
+  if (!open_file_->mapped) {
+    return false;
+  }
+  std::shared_lock<std::shared_timed_mutex> guard(open_file_->map_latch);
+  if (page_number == Page::INVALID_NUMBER ||
+      page_number >= open_file_->map_pages) {
+    // Reading past the end of the file through the mapping would fault.
+    throw InvalidPageException(page_number, filename_);
+  }
+  std::memcpy(into, open_file_->map + pagePosition(page_number), length);
+  return true;
+}
+
+std::size_t File::mappingLength(const PageId num_pages) {
+  // Twice the file, so that appending pages remaps rarely; pages of the
+  // mapping past the end of the file are never touched.
+  static const std::size_t kMinimum = 1 << 20;
+  const std::size_t page_size = sysconf(_SC_PAGESIZE);
+  const std::size_t length =
+      std::max<std::size_t>(2 * (std::size_t)pagePosition(num_pages), kMinimum);
+  return (length + page_size - 1) / page_size * page_size;
 }
 
 PageHeader File::readPageHeader(PageId page_number) const {
   PageHeader header;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!readMapped(page_number, &header, sizeof(header))) {
+    off_t position;
+    {
+      std::lock_guard<std::mutex> guard(open_file_->latch);
+      position = headerPosition(page_number);
+    }
+    if (position < 0) {
+      throw InvalidPageException(page_number, filename_);
+    }
+    ssize_t result;
+    do {
+      result = pread(fd_, &header, sizeof(header), position);
+    } while (result < 0 && errno == EINTR);
+    if (result < 0) {
+      throw IoException(filename_, errno);
+    }
+    if (result < (ssize_t)sizeof(header)) {
+      throw InvalidPageException(page_number, filename_);
+    }
+  }
+  // The next page pointer on disk may not be repaired yet.
+  std::lock_guard<std::mutex> guard(open_file_->latch);
+  header.next_page_number =
+      open_file_->nextPage(page_number, header.next_page_number);
 
   return header;
 }
 
+off_t File::headerPosition(const PageId page_number) const {
+  if (!open_file_->compressed) {
+    return pagePosition(page_number);
+  }
+  const std::vector<PageLocation> &locations = open_file_->locations;
+  if (page_number >= locations.size() ||
+      locations[page_number].capacity == 0) {
+    return -1;
+  }
+  return locations[page_number].offset;
+}
+
+void File::openLocationMap(const bool create_new) {
+  const std::string name = locationMapFilename(filename_);
+  int fd;
+  do {
+    fd = ::open(name.c_str(), O_RDWR | (create_new ? O_CREAT | O_TRUNC : 0),
+                0644);
+  } while (fd < 0 && errno == EINTR);
+  if (fd < 0) {
+    throw IoException(name, errno);
+  }
+  std::vector<PageLocation> locations;
+  if (!create_new) {
+    struct stat status;
+    if (fstat(fd, &status) != 0) {
+      const int error = errno;
+      ::close(fd);
+      throw IoException(name, error);
+    }
+    locations.resize(status.st_size / sizeof(PageLocation));
+    const std::size_t bytes = locations.size() * sizeof(PageLocation);
+    for (std::size_t done = 0; done < bytes;) {
+      const ssize_t result =
+          pread(fd, reinterpret_cast<char *>(locations.data()) + done,
+                bytes - done, done);
+      if (result <= 0) {
+        if (result < 0 && errno == EINTR) continue;
+        const int error = result < 0 ? errno : EIO;
+        ::close(fd);
+        throw IoException(name, error);
+      }
+      done += result;
+    }
+  }
+
+  // Whatever lies between the extents in the map is free; the first extent
+  // starts after the file header.
+  std::vector<std::pair<std::uint64_t, std::uint32_t>> extents;
+  for (const PageLocation &location : locations) {
+    if (location.capacity > 0) {
+      extents.emplace_back(location.offset, location.capacity);
+    }
+  }
+  std::sort(extents.begin(), extents.end());
+  std::multimap<std::uint32_t, std::uint64_t> free_extents;
+  std::uint64_t end = EXTENT_ALIGNMENT;
+  for (const auto &extent : extents) {
+    if (extent.first > end) {
+      free_extents.emplace(extent.first - end, end);
+    }
+    end = std::max<std::uint64_t>(end, extent.first + extent.second);
+  }
+
+  std::lock_guard<std::mutex> guard(open_file_->latch);
+  open_file_->compressed = true;
+  open_file_->locations_fd = fd;
+  open_file_->locations.swap(locations);
+  open_file_->free_extents.swap(free_extents);
+  open_file_->end_offset = end;
+}
+
+void File::writeCompressed(const PageId page_number, const PageHeader &header,
+                           const char *data) {
+  std::vector<char> extent(EXTENT_HEADER_SIZE + Page::DATA_SIZE);
+  // Data that does not get smaller is stored as is.
+  std::uint32_t length = lzCompress(data, Page::DATA_SIZE,
+                                    &extent[EXTENT_HEADER_SIZE],
+                                    Page::DATA_SIZE - 1);
+  if (length == 0) {
+    length = Page::DATA_SIZE;
+    std::memcpy(&extent[EXTENT_HEADER_SIZE], data, Page::DATA_SIZE);
+  }
+  std::memcpy(&extent[0], &header, sizeof(header));
+  std::memcpy(&extent[sizeof(header)], &length, sizeof(length));
+  const std::size_t bytes = EXTENT_HEADER_SIZE + length;
+  const std::uint32_t capacity =
+      (bytes + EXTENT_ALIGNMENT - 1) / EXTENT_ALIGNMENT * EXTENT_ALIGNMENT;
+
+  std::uint64_t offset;
+  {
+    std::lock_guard<std::mutex> guard(open_file_->latch);
+    std::vector<PageLocation> &locations = open_file_->locations;
+    if (page_number >= locations.size()) {
+      locations.resize(page_number + 1, PageLocation{0, 0});
+    }
+    PageLocation &location = locations[page_number];
+    if (location.capacity < capacity) {
+      // Move to the smallest free extent that fits, or to the end.  The old
+      // extent stays reserved until the map on disk stops pointing to it.
+      if (location.capacity > 0) {
+        open_file_->pending_extents.emplace_back(location.offset,
+                                                 location.capacity);
+      }
+      auto fit = open_file_->free_extents.lower_bound(capacity);
+      if (fit != open_file_->free_extents.end()) {
+        location.offset = fit->second;
+        const std::uint32_t rest = fit->first - capacity;
+        open_file_->free_extents.erase(fit);
+        if (rest > 0) {
+          open_file_->free_extents.emplace(rest, location.offset + capacity);
+        }
+      } else {
+        location.offset = open_file_->end_offset;
+        open_file_->end_offset += capacity;
+      }
+      location.capacity = capacity;
+      open_file_->markLocations(page_number, page_number);
+    }
+    offset = location.offset;
+  }
+
+  for (std::size_t done = 0; done < bytes;) {
+    const ssize_t result =
+        pwrite(fd_, &extent[done], bytes - done, offset + done);
+    if (result <= 0) {
+      if (result < 0 && errno == EINTR) continue;
+      throw IoException(filename_, result < 0 ? errno : EIO);
+    }
+    done += result;
+  }
+}
+
+void File::readCompressed(const PageId page_number, Page &into) const {
+  PageLocation location;
+  {
+    std::lock_guard<std::mutex> guard(open_file_->latch);
+    const std::vector<PageLocation> &locations = open_file_->locations;
+    if (page_number == Page::INVALID_NUMBER ||
+        page_number >= locations.size() ||
+        locations[page_number].capacity == 0) {
+      throw InvalidPageException(page_number, filename_);
+    }
+    location = locations[page_number];
+  }
+
+  // The extent is read whole; the last one in the file may end early.
+  std::vector<char> extent(location.capacity);
+  ssize_t result;
+  do {
+    result = pread(fd_, extent.data(), extent.size(), location.offset);
+  } while (result < 0 && errno == EINTR);
+  if (result < 0) {
+    throw IoException(filename_, errno);
+  }
+  std::uint32_t length = 0;
+  if (result >= (ssize_t)EXTENT_HEADER_SIZE) {
+    std::memcpy(&length, &extent[sizeof(PageHeader)], sizeof(length));
+  }
+  if (result < (ssize_t)EXTENT_HEADER_SIZE || length > Page::DATA_SIZE ||
+      EXTENT_HEADER_SIZE + length > (std::size_t)result) {
+    throw CorruptPageException(page_number, filename_);
+  }
+  std::memcpy(&into.header_, &extent[0], sizeof(PageHeader));
+  const char *data = &extent[EXTENT_HEADER_SIZE];
+  if (length == Page::DATA_SIZE) {
+    std::memcpy(into.data_, data, Page::DATA_SIZE);
+  } else if (!lzDecompress(data, length, into.data_, Page::DATA_SIZE)) {
+    throw CorruptPageException(page_number, filename_);
+  }
+}
+
+void File::persistLocationMap() {
+  PageId from;
+  std::vector<PageLocation> changed;
+  std::vector<std::pair<std::uint64_t, std::uint32_t>> released;
+  {
+    std::lock_guard<std::mutex> guard(open_file_->latch);
+    if (!open_file_->locations_dirty) {
+      return;
+    }
+    from = open_file_->locations_dirty_from;
+    const PageId to = open_file_->locations_dirty_to;
+    changed.assign(open_file_->locations.begin() + from,
+                   open_file_->locations.begin() + to + 1);
+    released.swap(open_file_->pending_extents);
+    open_file_->locations_dirty = false;
+  }
+
+  const std::string name = locationMapFilename(filename_);
+  const char *bytes = reinterpret_cast<const char *>(changed.data());
+  const std::size_t length = changed.size() * sizeof(PageLocation);
+  const off_t position = (off_t)from * sizeof(PageLocation);
+  int error = 0;
+  for (std::size_t done = 0; done < length;) {
+    const ssize_t result = pwrite(open_file_->locations_fd, bytes + done,
+                                  length - done, position + done);
+    if (result <= 0) {
+      if (result < 0 && errno == EINTR) continue;
+      error = result < 0 ? errno : EIO;
+      break;
+    }
+    done += result;
+  }
+  if (error == 0 && fdatasync(open_file_->locations_fd) != 0) {
+    error = errno;
+  }
+
+  std::lock_guard<std::mutex> guard(open_file_->latch);
+  if (error != 0) {
+    // Everything has to be written again next time.
+    open_file_->markLocations(from, from + changed.size() - 1);
+    open_file_->pending_extents.insert(open_file_->pending_extents.end(),
+                                       released.begin(), released.end());
+    throw IoException(name, error);
+  }
+  for (const auto &extent : released) {
+    open_file_->free_extents.emplace(extent.second, extent.first);
+  }
+}
+
+void File::verifyPage(const PageId page_number, const Page &page,
+                      const bool allow_free) const {
+  verifyPage(filename_, page_number, page, open_file_->verify_checksums,
+             allow_free);
+}
+
+void File::verifyPage(const std::string &filename, const PageId page_number,
+                      const Page &page, const bool verify_checksum,
+                      const bool allow_free) {
+  if (verify_checksum && !page.hasValidChecksum()) {
+    throw CorruptPageException(page_number, filename);
+  }
+  if (!allow_free && !page.isUsed()) {
+    throw InvalidPageException(page_number, filename);
+  }
+}
+
 }  // namespace badgerdb
@@ -8,10 +8,16 @@
 
 #pragma once
 
-#include <fstream>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <vector>
 
 #include "page.h"
 
@@ -19,6 +25,46 @@ namespace badgerdb {
 
 class FileIterator;
 
+/**
+ * @brief How the pages of a file are read.
+ */
+enum class FileBackend {
+  /**
+   * Reads with pread() into the caller's page objects.
+   */
+  PREAD,
+
+  /**
+   * Reads out of a shared read-only mapping of the file, so that the data
+   * stays in the kernel page cache and viewPage() needs no copy at all.
+   * Writes still go through system calls, which the mapping sees at once.
+   */
+  MMAP
+};
+
+/**
+ * @brief Access pattern hints for File::advise().
+ */
+enum class FileAdvice { NORMAL, SEQUENTIAL, RANDOM, WILLNEED };
+
+/**
+ * @brief How the pages of a file are stored, chosen when it is created.
+ */
+enum class FileFormat : std::uint32_t {
+  /**
+   * Every page is stored as is, page n at a fixed position.
+   */
+  PLAIN = 0,
+
+  /**
+   * The data of every page is compressed with lzCompress() on write and
+   * decompressed on read; the page header stays as is.  Pages take as much
+   * room as they need, and a location map next to the file, named by
+   * File::locationMapFilename(), records where each page is.
+   */
+  COMPRESSED = 1
+};
+
 /**
  * @brief Header metadata for files on disk which contain pages.
  */
@@ -43,6 +89,11 @@ struct FileHeader {
    */
   PageId first_free_page;
 
+  /**
+   * How the pages are stored.
+   */
+  FileFormat format;
+
   /**
    * Returns true if this file header is equal to the other.
    *
@@ -52,49 +103,115 @@ struct FileHeader {
   bool operator==(const FileHeader &rhs) const {
     return num_pages == rhs.num_pages && num_free_pages == rhs.num_free_pages &&
            first_used_page == rhs.first_used_page &&
-           first_free_page == rhs.first_free_page;
+           first_free_page == rhs.first_free_page && format == rhs.format;
   }
 };
 
+/**
+ * @brief Where a page of a compressed file is stored: an entry of the
+ * location map.
+ *
+ * The page takes an extent of the file: its header, the number of data bytes
+ * stored, and the data bytes, compressed unless that saved nothing.  The
+ * extent may be larger than that, so that the page can be written again in
+ * place when it grows a little.
+ */
+struct PageLocation {
+  /**
+   * Offset of the extent in the file, 0 if the page was never written.
+   */
+  std::uint64_t offset;
+
+  /**
+   * Size of the extent.
+   */
+  std::uint32_t capacity;
+};
+
 /**
  * @brief Class which represents a file in the filesystem containing database
  *        pages.
  *
- * The File class wraps a stream to an underlying file on disk.  Files contain
- * fixed-sized pages, and they never deallocate space (though they do reuse
- * deleted pages if possible).  If multiple File objects refer to the same
- * underlying file, they will share the stream in memory.
+ * The File class wraps a file descriptor of an underlying file on disk.  Files
+ * contain fixed-sized pages, and they never deallocate space (though they do
+ * reuse deleted pages if possible).  If multiple File objects refer to the same
+ * underlying file, they will share the descriptor.
  * If a file that has already been opened (possibly by another query), then the
- * File class detects this (by looking in the open_streams_ map) and just
- * returns a file object with the already created stream for the file without
- * actually opening the UNIX file again.
+ * File class detects this (by looking in the open_fds_ map) and just returns a
+ * file object with the already open descriptor for the file without actually
+ * opening the UNIX file again.
  *
- * @warning This class is not threadsafe.
+ * Pages are read and written with pread() and pwrite() at the position of the
+ * page, so no call depends on a file offset left behind by another one.
+ *
+ * Every open file is also given a small integer FileId, shared by all File
+ * objects for it, so that callers on hot paths (such as the buffer manager) can
+ * identify a file without comparing or hashing its name.  The id is released
+ * when the file is closed and may then be reused for another file.
+ *
+ * The file header is kept in memory, shared like the descriptor, and written to
+ * disk only by sync() and when the last File object of the file is closed.
+ * It is written after the pages have been synced and is synced itself, so
+ * the header on disk never describes pages that are not on disk.  The used
+ * and free page lists are mirrored in memory as well, so that allocating,
+ * deleting and writing a page need no reads; the next page pointers that
+ * allocatePage() and deletePage() repair in other pages are written along
+ * with the header.
+ *
+ * Every page is written with a CRC-32C checksum in its header, and reads
+ * check it unless verifyChecksums() turned that off, so that a page damaged
+ * on disk, or only partly written, is reported instead of used.
+ *
+ * A file created with FileFormat::COMPRESSED stores the data of its pages
+ * compressed, so reading it reads fewer bytes, at the cost of compressing
+ * on every write and decompressing on every read.  Such a file cannot be
+ * mapped, and its pages are read one system call each.
+ *
+ * The registry of open files and reading pages may be used from several
+ * threads at once, through one File object or several for the same file.
+ *
+ * @warning A page that is being written while it is read may be read half
+ * written; callers such as the buffer manager order the two themselves.
  */
 class File {
  public:
+  /**
+   * FileId of a File object that does not refer to an open file.
+   */
+  static const FileId INVALID_ID = ~FileId(0);
+
   /**
    * Creates a new file.
    *
    * @param filename  Name of the file.
+   * @param format    How the pages of the file are stored.
    * @throws  FileExistsException     If the requested file already exists.
    */
-  static File create(const std::string &filename);
+  static File create(const std::string &filename,
+                     const FileFormat format = FileFormat::PLAIN);
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
    * It first checks if the file is already open. If so, then the new File
-   * object created uses the same input-output stream to read to or write fom
+   * object created uses the same file descriptor to read from or write to
    * that already open file. Reference count (open_counts_ static variable
    * inside the File object) is incremented whenever an already open file is
    * opened again. Otherwise the UNIX file is actually opened. The fileName and
-   * the stream associated with this File object are inserted into the
-   * open_streams_ map.
+   * the descriptor associated with this File object are inserted into the
+   * open_fds_ map, and the file is assigned a new FileId.
+   *
+   * With FileBackend::MMAP, the file is mapped into memory unless it is
+   * mapped already; all File objects for the file then read through the
+   * mapping until the last of them is closed.
    *
    * @param filename  Name of the file.
+   * @param backend   How the pages of the file are read.
    * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  IoException             If the file cannot be mapped, as a
+   *                                  compressed file cannot.
    */
-  static File open(const std::string &filename);
+  static File open(const std::string &filename,
+                   const FileBackend backend = FileBackend::PREAD);
 
   /**
    * Deletes an existing file.
@@ -140,14 +257,14 @@ class File {
    * @param rhs File object to compare.
    * @return True if the two files are equal.
    */
-  bool operator==(const File &rhs) const { return filename_ == rhs.filename_; }
+  bool operator==(const File &rhs) const { return id_ == rhs.id_; }
 
   /**
    * Check if two files are not equal.
    * @param rhs File object to compare.
    * @return True if the two files are not equal.
    */
-  bool operator!=(const File &rhs) const { return filename_ != rhs.filename_; }
+  bool operator!=(const File &rhs) const { return id_ != rhs.id_; }
 
   /**
    * Destructor that automatically closes the underlying file if no other
@@ -162,6 +279,57 @@ class File {
    */
   Page allocatePage();
 
+  /**
+   * Allocates a new page in the file and initializes the given page object,
+   * typically a buffer frame, as that page instead of returning a copy.
+   *
+   * The new page is linked after the closest used page before it, found in
+   * the used-page bitmap of the page chain.  Appending a page takes constant
+   * time.  Reusing a free page scans the bitmap backwards from it a word at
+   * a time, so it takes time proportional to the distance to that used
+   * page, at worst the number of pages / 64.  Pages the chain does not know
+   * yet have their headers read on the way; see writePage().
+   *
+   * @param new_page  Page object that becomes the new page.
+   */
+  void allocatePage(Page &new_page);
+
+  /**
+   * Like allocatePage(Page &), but allocates only the given page, so that a
+   * caller can prepare for the page nextAllocatedPage() named and find out
+   * whether another allocation got in first.
+   *
+   * @param expected_page Page to allocate; Page::INVALID_NUMBER allocates
+   *                      whichever page is next.
+   * @param new_page      Page object that becomes the new page.
+   * @return  False, with nothing allocated, if the next page is a different
+   *          one.
+   */
+  bool allocatePage(const PageId expected_page, Page &new_page);
+
+  /**
+   * Redoes the allocation of a page past the end of the file as its header
+   * on disk records it, for recovery after a crash that lost the header.
+   * Only allocations move the end of the file, so the page and every page
+   * between the old end and it were allocated: they are added to the end of
+   * the used list.  Pages before the given one whose image on disk is not a
+   * used page are written as empty pages; the given page is left for the
+   * caller to write.  The header reaches the disk with the next sync().
+   *
+   * @param page_number   Number of page.
+   * @return  False, with nothing changed, if the page is within the file.
+   * @throws  IoException  If a page cannot be read or written.
+   */
+  bool redoAllocation(const PageId page_number);
+
+  /**
+   * Returns the number of the page the next call to allocatePage() will
+   * allocate, provided nothing else changes the file in between.
+   *
+   * @return  Page number.
+   */
+  PageId nextAllocatedPage() const;
+
   /**
    * Reads an existing page from the file.
    *
@@ -169,22 +337,176 @@ class File {
    * @return  The page.
    * @throws  InvalidPageException  If the page doesn't exist in the file or is
    *                                not currently used.
+   * @throws  CorruptPageException  If the page does not match its checksum.
    */
   Page readPage(const PageId page_number) const;
 
+  /**
+   * Reads an existing page from the file straight into the given page object,
+   * typically a buffer frame.  This costs a single read: unlike
+   * readPage(const PageId), the file header is not read, and a page past the
+   * end of the file is detected by the short read.  The contents of the page
+   * object are undefined if an exception is thrown.
+   *
+   * @param page_number   Number of page to read.
+   * @param into          Page object the page is read into.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   * @throws  CorruptPageException  If the page does not match its checksum.
+   * @throws  IoException  If the read fails.
+   */
+  void readPage(const PageId page_number, Page &into) const;
+
+  /**
+   * Reads a run of consecutive pages into the given page objects with
+   * vectored reads, one system call for up to IOV_MAX pages.  The contents
+   * of the page objects are undefined if an exception is thrown.
+   *
+   * @param first_page    Number of the first page of the run.
+   * @param count         Number of pages in the run.
+   * @param into          Page object for each page of the run, in order.
+   * @throws  InvalidPageException  If a page doesn't exist in the file or is
+   *                                not currently used.
+   * @throws  CorruptPageException  If a page does not match its checksum.
+   * @throws  IoException  If a read fails.
+   */
+  void readPages(const PageId first_page, const std::uint32_t count,
+                 Page *const *into) const;
+
+  /**
+   * Returns the page in the mapping of a file opened with FileBackend::MMAP,
+   * without copying it.  The page is the file's current contents, not a
+   * snapshot.  The pointer stays valid until the file grows past the space
+   * reserved for the mapping, which remaps it, or is closed; the caller must
+   * not hold it across allocatePage().
+   *
+   * @param page_number   Number of page to view.
+   * @return  The page in the mapping.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   * @throws  CorruptPageException  If the page does not match its checksum.
+   * @throws  IoException  If the file is not mapped.
+   */
+  const Page *viewPage(const PageId page_number) const;
+
+  /**
+   * Tells the kernel how the file is about to be read: with madvise() on the
+   * mapping of a mapped file, and with posix_fadvise() otherwise.
+   *
+   * @param advice  Expected access pattern.
+   * @throws  IoException  If the kernel rejects the hint.
+   */
+  void advise(const FileAdvice advice) const;
+
+  /**
+   * Returns how the pages of the file are read.
+   */
+  FileBackend backend() const;
+
+  /**
+   * Returns how the pages of the file are stored.
+   */
+  FileFormat format() const;
+
+  /**
+   * Returns the name of the location map of a compressed file.
+   *
+   * @param filename  Name of the file.
+   */
+  static std::string locationMapFilename(const std::string &filename) {
+    return filename + ".loc";
+  }
+
+  /**
+   * Turns checking page checksums on reads on or off for every File object
+   * of this file.  It is on when the file is opened; a scan that trusts the
+   * file can turn it off to save computing the checksum of every page.
+   * Writes always store the checksum.
+   *
+   * @param verify  Whether reads check checksums.
+   */
+  void verifyChecksums(const bool verify);
+
+  /**
+   * Returns whether reads check page checksums.
+   */
+  bool verifiesChecksums() const;
+
+  /**
+   * Called once an asynchronous read completed, with nullptr on success or
+   * the exception the synchronous call would have thrown.
+   */
+  typedef std::function<void(std::exception_ptr error)> ReadCallback;
+
+  /**
+   * Starts reading an existing page from the file into the given page object
+   * through IoEngine::shared() and returns without waiting.  The callback
+   * runs on an I/O engine thread once the read completed; the page object
+   * must not be used or destroyed before then.
+   *
+   * Unlike readPage(), this does not read the file header: a page past the
+   * end of the file is detected by the short read.  The File object may be
+   * destroyed before the read completes only if another File object keeps
+   * the file open.
+   *
+   * @param page_number   Number of page to read.
+   * @param into          Page object the page is read into.
+   * @param done          Called on completion with nullptr, an
+   *                      InvalidPageException if the page doesn't exist in
+   *                      the file or is not currently used, or an
+   *                      IoException.
+   */
+  void readPageAsync(const PageId page_number, Page &into,
+                     ReadCallback done) const;
+
   /**
    * Writes a page into the file, replacing any existing contents.  The page
    * must have been already allocated in this file by a call to allocatePage().
+   * The next page pointer of the page on disk is kept; it is taken from the
+   * page chain held in memory, so the page is written with a single system
+   * call.  Only the first write, allocation or deletion that touches a page
+   * after the file is opened reads its header, to add it to the chain.
    *
    * @see allocatePage()
    * @param new_page  Page to write.
+   * @throws  InvalidPageException  If the page has been deleted.
+   * @throws  IoException  If the write fails.
    */
   void writePage(const Page &new_page);
 
   /**
-   * Deletes a page from the file.
+   * Writes a run of consecutive pages with vectored writes, one system call
+   * for up to IOV_MAX pages.  As with writePage(), the next page pointers
+   * stored on disk are kept; they are copied from the in-memory page chain
+   * into the page objects before writing.  The data is not synced; call
+   * sync() once all writes are done.
+   *
+   * @param first_page    Number of the first page of the run.
+   * @param count         Number of pages in the run.
+   * @param pages         Page object for each page of the run, in order.
+   * @throws  InvalidPageException  If a page has been deleted.
+   * @throws  IoException  If a write fails.
+   */
+  void writePages(const PageId first_page, const std::uint32_t count,
+                  Page *const *pages);
+
+  /**
+   * Flushes everything written to the file to stable storage.  The pages are
+   * synced first; then the cached file header is written, if it changed,
+   * and synced too.
+   *
+   * @throws  IoException  If the sync fails.
+   */
+  void sync();
+
+  /**
+   * Deletes a page from the file.  This writes the cleared page only; the
+   * predecessor of the page in the used list is updated on disk with the
+   * next sync().
    *
    * @param page_number   Number of page to delete.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or
+   *                                is not currently used.
    */
   void deletePage(const PageId page_number);
 
@@ -195,6 +517,21 @@ class File {
    */
   const std::string &filename() const { return filename_; }
 
+  /**
+   * Returns the identifier of the open file this object represents.
+   *
+   * @return FileId of the file, or INVALID_ID if the object is not valid.
+   */
+  FileId id() const { return id_; }
+
+  /**
+   * Returns the name of the open file with the given identifier.
+   *
+   * @param file_id   Identifier of an open file.
+   * @return Name of file.
+   */
+  static std::string filename(const FileId file_id);
+
   /**
    * Returns an iterator at the first page in the file.
    *
@@ -221,7 +558,7 @@ class File {
    * Creates an empty file
    * @return File object with valid_ bit set to false
    */
-  File() : valid_(false) {}
+  File() : fd_(-1), id_(INVALID_ID), valid_(false) {}
 
  private:
   friend class BufMgr;
@@ -235,12 +572,16 @@ class File {
    * @see File::open()
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param backend     How the pages of the file are read.
+   * @param format      How the pages of a new file are stored.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  explicit File(const std::string &name, const bool create_new);
+  explicit File(const std::string &name, const bool create_new,
+                const FileBackend backend = FileBackend::PREAD,
+                const FileFormat format = FileFormat::PLAIN);
 
   /**
    * Returns the position of the page with the given number in the file (as an
@@ -249,25 +590,26 @@ class File {
    * @param page_number   Number of page.
    * @return  Position of page in file.
    */
-  static std::streampos pagePosition(const PageId page_number) {
+  static off_t pagePosition(const PageId page_number) {
     return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
   }
 
   /**
    * Opens the underlying file named in filename_.
    * This method only opens the file if no other File objects exist that access
-   * the same filesystem file; otherwise, it reuses the existing stream.
+   * the same filesystem file; otherwise, it reuses the existing descriptor.
    *
    * @param create_new  Whether to create a new file.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
+   * @throws  IoException             If the file cannot be opened.
    */
   void openIfNeeded(const bool create_new);
 
   /**
-   * Closes the underlying file stream in <stream_>.
+   * Closes the underlying file descriptor in <fd_>.
    * This method only closes the file if no other File objects exist that access
    * the same file.
    */
@@ -277,16 +619,29 @@ class File {
    * Reads a page from the file.  If <allow_free> is not set, an exception
    * will be thrown if the page read from disk is not currently in use.
    *
-   * No bounds checking is performed; the underlying file stream will throw
-   * an exception if the page is past the end of the file.
+   * No bounds checking is performed against the file header; a page past
+   * the end of the file comes back short and is rejected.
    *
    * @param page_number   Number of page to read.
    * @param allow_free    Whether to allow reading a free (unused) page.
    * @return  The page.
+   * @throws  InvalidPageException  If the page is past the end of the file,
+   *                                or free (unused) and allow_free is false.
+   */
+  Page readPage(const PageId page_number, const bool allow_free) const;
+
+  /**
+   * Like readPage(const PageId, const bool), but reads into the given page
+   * object.
+   *
+   * @param page_number   Number of page to read.
+   * @param allow_free    Whether to allow reading a free (unused) page.
+   * @param into          Page object the page is read into.
    * @throws  InvalidPageException  If the page is free (unused) and
    *                                allow_free is false.
    */
-  Page readPage(const PageId page_number, const bool allow_free) const;
+  void readPage(const PageId page_number, const bool allow_free,
+                Page &into) const;
 
   /**
    * Writes a page into the file at the given page number.  This does not
@@ -301,7 +656,8 @@ class File {
   /**
    * Writes a page into the file at the given page number with the given header.
    * This does not ensure that the number in the header equals the position on
-   * disk.  No bounds checking is performed.
+   * disk.  No bounds checking is performed.  If the page chain is loaded, the
+   * entry of the page is updated from the header.
    *
    * @param page_number Number of page whose contents to replace.
    * @param header      Header of page to write.
@@ -311,19 +667,49 @@ class File {
                  const Page &new_page);
 
   /**
-   * Reads the header for this file from disk.
+   * Writes only the next page pointer in the header of a page on disk.
+   *
+   * @param page_number       Number of page to update.
+   * @param next_page_number  New next page pointer.
+   * @throws  IoException  If the write fails.
+   */
+  void writeNextPageNumber(const PageId page_number,
+                           const PageId next_page_number);
+
+  /**
+   * Returns the cached header for this file.
    *
    * @return  The file header.
    */
   FileHeader readHeader() const;
 
   /**
-   * Writes the given header to the disk as the header for this file.
+   * Replaces the cached header for this file.  It reaches the disk with the
+   * next sync() or when the file is closed.
    *
    * @param header  File header to write.
    */
   void writeHeader(const FileHeader &header);
 
+  /**
+   * Writes the next page pointers repaired since the last call, syncs the
+   * pages of the file, then writes the cached header if it is dirty and
+   * syncs it.  Pointers to pages the header on disk does not cover yet are
+   * written and synced after the header.
+   *
+   * @throws  IoException  If a write or sync fails.
+   */
+  void persistHeader();
+
+  /**
+   * Writes the given next page pointers and syncs the file.  Pointers that
+   * were not written are queued again in dirty_links.
+   *
+   * @param links  Pairs of page number and next page number.
+   * @throws  IoException  If a write or sync fails.
+   */
+  void persistLinks(const std::vector<std::pair<PageId, PageId>> &links);
+
   /**
    * Reads only the header of the given page from disk (not the record data
    * or slot table).  No bounds checking is performed.
@@ -333,28 +719,421 @@ class File {
    */
   PageHeader readPageHeader(const PageId page_number) const;
 
-  typedef std::map<std::string, std::shared_ptr<std::fstream>> StreamMap;
-  typedef std::map<std::string, int> CountMap;
+  /**
+   * Checks a page just read in full: its checksum, unless checking is turned
+   * off, and that it is used, unless free pages are allowed.
+   *
+   * @param page_number   Number of page.
+   * @param page          The page as read.
+   * @param allow_free    Whether a free (unused) page passes.
+   * @throws  CorruptPageException  If the checksum does not match.
+   * @throws  InvalidPageException  If the page is free and allow_free is
+   *                                false.
+   */
+  void verifyPage(const PageId page_number, const Page &page,
+                  const bool allow_free = false) const;
+
+  /**
+   * Like verifyPage(const PageId, const Page &, const bool), but needs no
+   * File object, for the completion of readPageAsync().
+   *
+   * @param filename        Name of the file, for the exceptions.
+   * @param page_number     Number of page.
+   * @param page            The page as read.
+   * @param verify_checksum Whether to check the checksum.
+   * @param allow_free      Whether a free (unused) page passes.
+   */
+  static void verifyPage(const std::string &filename,
+                         const PageId page_number, const Page &page,
+                         const bool verify_checksum, const bool allow_free);
+
+  /**
+   * Returns the position of the header of a page on disk: its fixed position
+   * in a plain file, the start of its extent in a compressed one.
+   *
+   * @param page_number   Number of page.
+   * @return  Position, or -1 if the page of a compressed file has no extent.
+   */
+  off_t headerPosition(const PageId page_number) const;
+
+  /**
+   * Opens the location map of a compressed file and reads it, or creates an
+   * empty one.  Space between the extents in the map is free.
+   *
+   * @param create_new  Whether the file is new.
+   * @throws  IoException  If the map cannot be opened or read.
+   */
+  void openLocationMap(const bool create_new);
+
+  /**
+   * Writes a page of a compressed file, in place if it still fits its
+   * extent and into a new one otherwise.
+   *
+   * @param page_number   Number of page.
+   * @param header        Header of the page, as it goes to disk.
+   * @param data          Data of the page.
+   * @throws  IoException  If the write fails.
+   */
+  void writeCompressed(const PageId page_number, const PageHeader &header,
+                       const char *data);
+
+  /**
+   * Reads a page of a compressed file.
+   *
+   * @param page_number   Number of page.
+   * @param into          Page object the page is read into.
+   * @throws  InvalidPageException  If the page has never been written.
+   * @throws  CorruptPageException  If the data cannot be decompressed.
+   * @throws  IoException  If the read fails.
+   */
+  void readCompressed(const PageId page_number, Page &into) const;
+
+  /**
+   * Writes the entries of the location map changed since the last call and
+   * syncs the map.  Extents that pages moved away from become free only
+   * now, when the map on disk no longer points to them.
+   *
+   * @throws  IoException  If the map cannot be written or synced.
+   */
+  void persistLocationMap();
+
+  /**
+   * Size of the part of an extent in front of the page data: the page
+   * header and the number of data bytes stored.
+   */
+  static const std::size_t EXTENT_HEADER_SIZE =
+      sizeof(PageHeader) + sizeof(std::uint32_t);
+
+  /**
+   * Extents are multiples of this many bytes, which leaves room to grow in
+   * place.
+   */
+  static const std::uint32_t EXTENT_ALIGNMENT = 512;
+
+  /**
+   * Reads the next page pointer and used bit of a page into the page chain
+   * of the open file from the page header on disk, unless they are known
+   * already.  Must be called with the latch of open_file_ held.
+   *
+   * @param page_number   Number of page, which must be in the file.
+   * @throws  IoException  If the header cannot be read.
+   */
+  void loadPage(const PageId page_number) const;
+
+  /**
+   * Returns the closest used page before the given page number, or
+   * Page::INVALID_NUMBER if there is none.  As the used list is sorted by
+   * page number, this is the page that precedes the given page in the used
+   * list once it is used.  Reads the headers of pages that are not known
+   * yet, from the given page backwards, until it finds a used one.  Must be
+   * called with the latch of open_file_ held.
+   *
+   * @param page_number   Number of page.
+   * @return  Number of the closest preceding used page.
+   * @throws  IoException  If a header cannot be read.
+   */
+  PageId previousUsed(const PageId page_number) const;
+
+  /**
+   * Maps the file unless it is mapped already, reserving room for it to
+   * grow.
+   *
+   * @throws  IoException  If the file cannot be mapped.
+   */
+  void mapFile();
 
   /**
-   * Streams for opened files.
+   * Makes pages up to the given number readable through the mapping, if the
+   * file is mapped, remapping it if they lie past the reserved space.
+   *
+   * @param num_pages   Number of pages in the file, as in FileHeader.
+   * @throws  IoException  If the file cannot be remapped.
    */
-  static StreamMap open_streams_;
+  void growMapping(const PageId num_pages);
+
+  /**
+   * Copies the start of a page out of the mapping.
+   *
+   * @param page_number   Number of page.
+   * @param into          Where to copy to.
+   * @param length        Number of bytes to copy, at most Page::SIZE.
+   * @return  False if the file is not mapped.
+   * @throws  InvalidPageException  If the page is past the end of the file.
+   */
+  bool readMapped(const PageId page_number, void *into,
+                  const std::size_t length) const;
+
+  /**
+   * Returns the length of the mapping to reserve for a file of the given
+   * number of pages.
+   */
+  static std::size_t mappingLength(const PageId num_pages);
+
+  /**
+   * @brief State shared by all File objects that refer to the same open file.
+   */
+  struct OpenFile {
+    OpenFile()
+        : header_dirty(false),
+          disk_num_pages(0),
+          mapped(false),
+          map(nullptr),
+          map_length(0),
+          map_pages(0),
+          verify_checksums(true),
+          compressed(false),
+          locations_fd(-1),
+          locations_dirty(false),
+          locations_dirty_from(0),
+          locations_dirty_to(0),
+          end_offset(0) {}
+
+    /**
+     * Returns whether the next page pointer and used bit of the given page
+     * are in the page chain.
+     */
+    bool isKnown(const PageId page_number) const {
+      return page_number / 64 < known_pages.size() &&
+             (known_pages[page_number / 64] >> (page_number % 64)) & 1;
+    }
+
+    /**
+     * Returns whether the given page is in the used list, if it is known.
+     */
+    bool isUsed(const PageId page_number) const {
+      return page_number < next_pages.size() &&
+             (used_pages[page_number / 64] >> (page_number % 64)) & 1;
+    }
+
+    /**
+     * Returns the next page pointer of a page, taken from the page chain if
+     * the page is known and from the given pointer on disk otherwise.  A
+     * pointer on disk past the end of the file was written ahead of the
+     * header that would have covered it, so it ends the chain.
+     *
+     * @param page_number  Number of page.
+     * @param next_on_disk Next page pointer of the page as read from disk.
+     */
+    PageId nextPage(const PageId page_number,
+                    const PageId next_on_disk) const {
+      if (isKnown(page_number)) {
+        return next_pages[page_number];
+      }
+      return next_on_disk >= header.num_pages ? Page::INVALID_NUMBER
+                                              : next_on_disk;
+    }
+
+    /**
+     * Records the next page pointer of a page and whether it is used, making
+     * it known and growing the chain if the page is past its end.
+     *
+     * @param page_number       Number of page.
+     * @param next_page_number  Next page pointer of the page.
+     * @param used              Whether the page is in the used list.
+     */
+    void setPage(const PageId page_number, const PageId next_page_number,
+                 const bool used);
+
+    /**
+     * Records the next page pointer and used state of a page just read in
+     * full, unless the page is known already, so that writing it back does
+     * not have to read its header again.  Takes latch.
+     *
+     * @param page_number   Number of page.
+     * @param page          The page as read.
+     */
+    void notePage(const PageId page_number, const Page &page);
+
+    /**
+     * Records that the locations of a range of pages have to be written to
+     * the location map.
+     *
+     * @param from  Number of the first page.
+     * @param to    Number of the last page.
+     */
+    void markLocations(const PageId from, const PageId to);
+
+    /**
+     * Protects the members below.
+     */
+    std::mutex latch;
+
+    /**
+     * Header of the file, read when the file is opened.
+     */
+    FileHeader header;
+
+    /**
+     * Whether header differs from the header on disk.
+     */
+    bool header_dirty;
+
+    /**
+     * Number of pages in the header last written to or read from disk.
+     */
+    PageId disk_num_pages;
+
+    /**
+     * Next page number of the known pages as stored on disk, indexed by page
+     * number.  This mirrors the used and free lists so that writing a page
+     * does not have to read its header first.  The chain is built up page by
+     * page: a header is read the first time a write, allocation or deletion
+     * needs it, so opening a file reads none of them and files that are only
+     * read never pay for it.
+     */
+    std::vector<PageId> next_pages;
+
+    /**
+     * Bitmap of the known pages in the used list, 64 pages per word.
+     */
+    std::vector<std::uint64_t> used_pages;
+
+    /**
+     * Bitmap of the pages whose entries in next_pages and used_pages are
+     * known, 64 pages per word.
+     */
+    std::vector<std::uint64_t> known_pages;
+
+    /**
+     * Whether the file is mapped; checked before taking map_latch.
+     */
+    std::atomic<bool> mapped;
+
+    /**
+     * Protects the mapping: shared by readers, exclusive to map or remap.
+     */
+    std::shared_timed_mutex map_latch;
+
+    /**
+     * Read-only shared mapping of the file, or nullptr.
+     */
+    char *map;
+
+    /**
+     * Length of the mapping, which reaches past the end of the file so that
+     * the file can grow without being remapped every time.
+     */
+    std::size_t map_length;
+
+    /**
+     * Number of pages readable through the mapping, counting the file
+     * header like FileHeader::num_pages.
+     */
+    PageId map_pages;
+
+    /**
+     * Whether reads check page checksums; read without the latch.
+     */
+    std::atomic<bool> verify_checksums;
+
+    /**
+     * Whether the file is FileFormat::COMPRESSED; set when it is opened.
+     * The members below are only used for compressed files.
+     */
+    bool compressed;
+
+    /**
+     * Descriptor of the location map.
+     */
+    int locations_fd;
+
+    /**
+     * Location of every page, indexed by page number.
+     */
+    std::vector<PageLocation> locations;
+
+    /**
+     * Whether a location changed since the map was last written, and the
+     * range of page numbers the changes are in.
+     */
+    bool locations_dirty;
+    PageId locations_dirty_from;
+    PageId locations_dirty_to;
+
+    /**
+     * Free extents by size, reused best fit.
+     */
+    std::multimap<std::uint32_t, std::uint64_t> free_extents;
+
+    /**
+     * Extents pages moved away from, as (offset, size), which the location
+     * map on disk may still point to.
+     */
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> pending_extents;
+
+    /**
+     * End of the last extent, where new extents are appended.
+     */
+    std::uint64_t end_offset;
+
+    /**
+     * Pages whose next page pointer changed when another page was
+     * allocated or deleted and has not been written yet.  The pointers are
+     * written with the file header; until then next_pages holds them.
+     */
+    std::vector<PageId> dirty_links;
+  };
+
+  typedef std::map<std::string, int> CountMap;
+  typedef std::map<std::string, int> FdMap;
+  typedef std::map<std::string, FileId> IdMap;
+  typedef std::map<std::string, std::shared_ptr<OpenFile>> OpenFileMap;
 
   /**
    * Counts for opened files.
    */
   static CountMap open_counts_;
 
+  /**
+   * File descriptors of opened files.
+   */
+  static FdMap open_fds_;
+
+  /**
+   * FileIds of opened files.
+   */
+  static IdMap open_ids_;
+
+  /**
+   * Shared state of opened files.
+   */
+  static OpenFileMap open_files_;
+
+  /**
+   * Names of opened files indexed by FileId; empty for unused ids.
+   */
+  static std::vector<std::string> id_names_;
+
+  /**
+   * FileIds released by closed files, reused before new ones are handed out.
+   */
+  static std::vector<FileId> free_ids_;
+
+  /**
+   * Protects the maps and vectors above.
+   */
+  static std::mutex registry_mutex_;
+
   /**
    * Name of the file this object represents.
    */
   std::string filename_;
 
   /**
-   * Stream for underlying filesystem object.
+   * Descriptor for underlying filesystem object, shared with the other File
+   * objects of the same file.
+   */
+  int fd_;
+
+  /**
+   * State shared with the other File objects of the same file.
+   */
+  std::shared_ptr<OpenFile> open_file_;
+
+  /**
+   * Identifier of the open file.
    */
-  std::shared_ptr<std::fstream> stream_;
+  FileId id_;
 
   /**
    * Whether this file is valid.
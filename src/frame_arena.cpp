@@ -0,0 +1,59 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "frame_arena.h"
+
+#include <sys/mman.h>
+
+#include <new>
+#include <type_traits>
+
+namespace badgerdb {
+
+static_assert(std::is_trivially_destructible<Page>::value,
+              "Frames are unmapped without destroying their pages.");
+
+const std::size_t FrameArena::HUGE_PAGE_SIZE;
+
+FrameArena::FrameArena(const std::uint32_t frames, const bool hugePages)
+    : pages(nullptr),
+      numFrames(frames),
+      mappedBytes((std::size_t)frames * Page::SIZE),
+      explicitHugePages(false) {
+  if (mappedBytes == 0) return;
+
+  void* memory = MAP_FAILED;
+  if (hugePages) {
+    mappedBytes = (mappedBytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE *
+                  HUGE_PAGE_SIZE;
+    memory = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    explicitHugePages = memory != MAP_FAILED;
+  }
+  if (memory == MAP_FAILED) {
+    memory = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+    if (hugePages) madvise(memory, mappedBytes, MADV_HUGEPAGE);
+#endif
+  }
+
+  // Frames are always filled by a read or a page allocation before use, so
+  // they are not initialized here; untouched frames stay unfaulted.
+  pages = static_cast<Page*>(memory);
+  for (FrameId i = 0; i < numFrames; i++) {
+    new (&pages[i]) Page(Page::Uninitialized());
+  }
+}
+
+FrameArena::~FrameArena() {
+  if (pages != nullptr) munmap(pages, mappedBytes);
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,90 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Contiguous memory for the frames of a buffer pool.
+ *
+ * All frames live in one anonymous mapping, frame i at byte offset
+ * i * Page::SIZE, so every frame is aligned to the system page size and the
+ * footprint of the pool is known up front.  The mapping can be backed by
+ * 2 MB huge pages to reduce TLB misses on large pools.
+ */
+class FrameArena {
+ public:
+  /**
+   * Size of a huge page.
+   */
+  static const std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+  /**
+   * Maps the arena.  Frame contents are undefined until a page is read or
+   * allocated into them.
+   *
+   * @param frames      Number of frames
+   * @param hugePages   Back the arena by huge pages.  Uses explicit huge pages
+   *                    if the system has enough reserved, and asks for
+   *                    transparent huge pages otherwise.
+   * @throws std::bad_alloc  If the memory cannot be mapped
+   */
+  FrameArena(const std::uint32_t frames, const bool hugePages = false);
+
+  /**
+   * Unmaps the arena.
+   */
+  ~FrameArena();
+
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+
+  /**
+   * Returns the page held by a frame.
+   */
+  Page& operator[](const FrameId frame) { return pages[frame]; }
+  const Page& operator[](const FrameId frame) const { return pages[frame]; }
+
+  /**
+   * Returns the frame holding the given page of the arena.
+   */
+  FrameId frameOf(const Page* page) const {
+    return static_cast<FrameId>(page - pages);
+  }
+
+  /**
+   * Returns the number of frames.
+   */
+  std::uint32_t size() const { return numFrames; }
+
+  /**
+   * Returns the number of bytes mapped, which may exceed
+   * size() * Page::SIZE when huge pages are used.
+   */
+  std::size_t bytes() const { return mappedBytes; }
+
+  /**
+   * Returns true if the arena got explicit huge pages.
+   */
+  bool hugePages() const { return explicitHugePages; }
+
+ private:
+  Page* pages;
+  std::uint32_t numFrames;
+  std::size_t mappedBytes;
+  bool explicitHugePages;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,164 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "free_space_map.h"
+
+#include <algorithm>
+
+#include "buffer.h"
+
+namespace badgerdb {
+
+const std::uint32_t FreeSpaceMap::CATEGORY_BYTES;
+const std::uint32_t FreeSpaceMap::LEAVES;
+const int FreeSpaceMap::LEVELS;
+
+static_assert(2 * FreeSpaceMap::LEAVES - 1 <= Page::DATA_SIZE,
+              "The tree of a map page must fit on the page.");
+
+namespace {
+
+// First node of the bottom level of the tree of a map page.  LEAVES is not a
+// power of two, so the bottom level holds only some of the leaves; the others
+// sit one level up, to the right of them.
+constexpr std::uint32_t bottomLevel() {
+  std::uint32_t width = 1;
+  while (width < FreeSpaceMap::LEAVES) width *= 2;
+  return width - 1;
+}
+
+const std::uint32_t kBottom = bottomLevel();
+const std::uint32_t kBottomLeaves = 2 * FreeSpaceMap::LEAVES - 1 - kBottom;
+
+// Node of a leaf, numbering the leaves from left to right.
+std::uint32_t leafNode(const std::uint32_t slot) {
+  return slot < kBottomLeaves ? kBottom + slot
+                              : FreeSpaceMap::LEAVES - 1 + slot - kBottomLeaves;
+}
+
+// Inverse of leafNode().
+std::uint32_t leafSlot(const std::uint32_t node) {
+  return node >= kBottom ? node - kBottom
+                         : node - (FreeSpaceMap::LEAVES - 1) + kBottomLeaves;
+}
+
+}  // namespace
+
+FreeSpaceMap::FreeSpaceMap(BufMgr &bufMgr, const File &heapFile,
+                           const File &mapFile)
+    : bufMgr(bufMgr), heapFile(heapFile), mapFile(mapFile) {}
+
+void FreeSpaceMap::update(const PageId pageNo, const std::uint16_t space) {
+  std::lock_guard<std::mutex> guard(latch);
+  set(0, pageNo, category(space));
+}
+
+PageId FreeSpaceMap::find(const std::size_t bytes) {
+  std::lock_guard<std::mutex> guard(latch);
+  const std::size_t steps = (bytes + CATEGORY_BYTES - 1) / CATEGORY_BYTES;
+  const std::uint8_t need = steps == 0 ? 1 : std::min<std::size_t>(steps, 255);
+  while (true) {
+    std::uint64_t index = 0;
+    std::uint8_t root = 0;
+    int level = LEVELS - 1;
+    for (; level >= 0; level--) {
+      PageId pageNo;
+      Page *page = pin(level, index, false /* extend */, pageNo);
+      if (page == nullptr) {
+        root = 0;
+        break;
+      }
+      const std::uint8_t *tree = nodes(page);
+      root = tree[0];
+      if (root < need) {
+        bufMgr.unPinPage(mapFile, pageNo, false);
+        break;
+      }
+      // Go down to the leftmost child that is large enough.
+      std::uint32_t node = 0;
+      while (node < LEAVES - 1) {
+        node = tree[2 * node + 1] >= need ? 2 * node + 1 : 2 * node + 2;
+      }
+      bufMgr.unPinPage(mapFile, pageNo, false);
+      index = index * LEAVES + leafSlot(node);
+    }
+    if (level < 0) {
+      return index;
+    }
+    if (level == LEVELS - 1) {
+      return Page::INVALID_NUMBER;
+    }
+    // The parent promised more than this page has, say after a crash lost a
+    // map page; correct the parent and search again.
+    set(level + 1, index, root);
+  }
+}
+
+void FreeSpaceMap::set(int level, std::uint64_t index, std::uint8_t value) {
+  for (; level < LEVELS; level++) {
+    const std::uint32_t slot = index % LEAVES;
+    index /= LEAVES;
+    PageId pageNo;
+    Page *page = pin(level, index, value != 0 /* extend */, pageNo);
+    if (page == nullptr) {
+      // Pages past the end of the map have category 0 already.
+      return;
+    }
+    std::uint8_t *tree = nodes(page);
+    const std::uint8_t oldRoot = tree[0];
+    std::uint32_t node = leafNode(slot);
+    const bool changed = tree[node] != value;
+    tree[node] = value;
+    while (node > 0) {
+      node = (node - 1) / 2;
+      const std::uint8_t largest =
+          std::max(tree[2 * node + 1], tree[2 * node + 2]);
+      if (tree[node] == largest) break;
+      tree[node] = largest;
+    }
+    value = tree[0];
+    bufMgr.unPinPage(mapFile, pageNo, changed);
+    if (value == oldRoot) return;
+  }
+}
+
+Page *FreeSpaceMap::pin(const int level, const std::uint64_t index,
+                        const bool extend, PageId &pageNo) {
+  // Depth first: the root, then every page of level 1 followed by the pages
+  // of level 0 below it.  Map page numbers start at 1.
+  std::uint64_t position;
+  if (level == 2) {
+    position = 0;
+  } else if (level == 1) {
+    position = 1 + index * (LEAVES + 1);
+  } else {
+    position = 1 + (index / LEAVES) * (LEAVES + 1) + 1 + index % LEAVES;
+  }
+  pageNo = position + 1;
+
+  Page *page;
+  if (pageNo < mapFile.nextAllocatedPage()) {
+    bufMgr.readPage(mapFile, pageNo, page);
+    return page;
+  }
+  if (!extend) {
+    return nullptr;
+  }
+  // Map files only grow, so pages are handed out in order; new pages are
+  // zeroed, which is category 0 throughout.
+  while (true) {
+    PageId newPageNo;
+    bufMgr.allocPage(mapFile, newPageNo, page);
+    if (newPageNo == pageNo) {
+      return page;
+    }
+    bufMgr.unPinPage(mapFile, newPageNo, false);
+  }
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,160 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+class BufMgr;
+
+/**
+ * @brief Approximate free space of every page of a file, to find a page
+ *        where a record fits without reading the pages.
+ *
+ * The map records for each page of the heap file one byte, the category of
+ * the longest record that fits on it: the number of whole CATEGORY_BYTES
+ * steps.  A page of category c holds a record of up to c * CATEGORY_BYTES
+ * bytes, so the map never promises space a page does not have, as long as it
+ * is kept current.
+ *
+ * The categories are the leaves of a tree of maxima stored in the pages of a
+ * companion file, which are read and written through the buffer manager like
+ * any other page.  Every map page holds a complete binary tree in heap order
+ * with LEAVES leaves; the leaves of a page on an upper level are the roots of
+ * the pages below it.  Three levels cover every page number.  The pages are
+ * laid out depth first, so a map grows at the end of its file along with the
+ * heap file, and pages past the end of the map have category 0.
+ *
+ * Updating a page and finding a page with enough room both touch one map page
+ * per level.
+ */
+class FreeSpaceMap {
+ public:
+  /**
+   * Free space covered by one step of the categories.
+   */
+  static const std::uint32_t CATEGORY_BYTES = 32;
+
+  /**
+   * Leaves of the tree on one map page.
+   */
+  static const std::uint32_t LEAVES = Page::DATA_SIZE / 2;
+
+  /**
+   * Levels of map pages.
+   */
+  static const int LEVELS = 3;
+
+  /**
+   * Returns the name of the companion file holding the map of a file.
+   *
+   * @param filename  Name of the heap file.
+   * @return  Name of the map file.
+   */
+  static std::string mapFilename(const std::string &filename) {
+    return filename + ".fsm";
+  }
+
+  /**
+   * Returns the category of a page.
+   *
+   * @param space   Length of the longest record that fits on the page.
+   * @return  Category.
+   */
+  static std::uint8_t category(const std::uint16_t space) {
+    return space / CATEGORY_BYTES > 255 ? 255 : space / CATEGORY_BYTES;
+  }
+
+  /**
+   * Constructs the map of a file.
+   *
+   * @param bufMgr    Buffer manager that holds the pages of the map.
+   * @param heapFile  File whose pages the map describes; kept open.
+   * @param mapFile   File holding the map.
+   */
+  FreeSpaceMap(BufMgr &bufMgr, const File &heapFile, const File &mapFile);
+
+  /**
+   * Records the free space of a page.
+   *
+   * @param pageNo  Number of the page in the heap file.
+   * @param space   Length of the longest record that fits on the page.
+   */
+  void update(const PageId pageNo, const std::uint16_t space);
+
+  /**
+   * Returns a page that a record of the given length fits on, the one with
+   * the lowest page number, or Page::INVALID_NUMBER if there is none.
+   * A record longer than 255 steps is only matched with a page in the top
+   * category, so the caller should check Page::hasSpaceForRecord().
+   *
+   * @param bytes   Length of the record.
+   * @return  Number of a page in the heap file.
+   */
+  PageId find(const std::size_t bytes);
+
+  /**
+   * Returns the file holding the map.
+   */
+  File &file() { return mapFile; }
+
+ private:
+  /**
+   * Sets a leaf of a map page and carries the change up the levels.
+   *
+   * @param level   Level of the map page, 0 for the pages with heap pages
+   *                as leaves.
+   * @param index   Leaf index on that level: the page is index / LEAVES and
+   *                the leaf index % LEAVES.
+   * @param value   New category.
+   */
+  void set(int level, std::uint64_t index, std::uint8_t value);
+
+  /**
+   * Pins a map page.
+   *
+   * @param level   Level of the map page.
+   * @param index   Index of the page on its level.
+   * @param extend  Whether to grow the map file if the page is past its end.
+   * @param pageNo  Set to the number of the page in the map file.
+   * @return  The page, or nullptr if it is past the end and extend is false.
+   */
+  Page *pin(const int level, const std::uint64_t index, const bool extend,
+            PageId &pageNo);
+
+  /**
+   * Returns the tree nodes of a map page.
+   */
+  static std::uint8_t *nodes(Page *page) {
+    return reinterpret_cast<std::uint8_t *>(&page->data_[0]);
+  }
+
+  BufMgr &bufMgr;
+
+  /**
+   * Heap file; holding it keeps its FileId from being reused.
+   */
+  File heapFile;
+
+  File mapFile;
+
+  /**
+   * Serializes updates and searches.  Taken before any buffer manager latch.
+   */
+  std::mutex latch;
+};
+
+}  // namespace badgerdb
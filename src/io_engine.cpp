@@ -0,0 +1,301 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "io_engine.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include "exceptions/io_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+int ioUringSetup(unsigned entries, struct io_uring_params *params) {
+  return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+int ioUringEnter(int ringFd, unsigned toSubmit, unsigned minComplete,
+                 unsigned flags) {
+  return (int)syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete,
+                      flags, nullptr, 0);
+}
+
+void *mapRing(int ringFd, std::size_t size, off_t offset) {
+  return mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+              ringFd, offset);
+}
+
+}  // namespace
+
+//----------------------------------------
+// IoEngine
+//----------------------------------------
+
+std::unique_ptr<IoEngine> IoEngine::create(const std::uint32_t queueDepth) {
+  try {
+    return std::unique_ptr<IoEngine>(new IoUringEngine(queueDepth));
+  } catch (const IoException &e) {
+    return createThreadPool(queueDepth);
+  }
+}
+
+std::unique_ptr<IoEngine> IoEngine::createThreadPool(
+    const std::uint32_t queueDepth) {
+  return std::unique_ptr<IoEngine>(new ThreadPoolEngine(queueDepth));
+}
+
+IoEngine &IoEngine::shared() {
+  static std::unique_ptr<IoEngine> engine = create(32);
+  return *engine;
+}
+
+//----------------------------------------
+// IoUringEngine
+//----------------------------------------
+
+IoUringEngine::IoUringEngine(const std::uint32_t queueDepth)
+    : sqRing(MAP_FAILED),
+      cqRing(MAP_FAILED),
+      sqeMemory(MAP_FAILED),
+      inFlight(0),
+      unsubmitted(0),
+      completions(0) {
+  struct io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  ringFd = ioUringSetup(std::max<std::uint32_t>(1, queueDepth), &params);
+  if (ringFd < 0) {
+    throw IoException("io_uring", errno);
+  }
+  entries = params.sq_entries;
+
+  sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cqRingSize =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (singleMmap) {
+    sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+  }
+  sqeSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+  sqRing = mapRing(ringFd, sqRingSize, IORING_OFF_SQ_RING);
+  if (sqRing != MAP_FAILED) {
+    cqRing =
+        singleMmap ? sqRing : mapRing(ringFd, cqRingSize, IORING_OFF_CQ_RING);
+  }
+  if (cqRing != MAP_FAILED) {
+    sqeMemory = mapRing(ringFd, sqeSize, IORING_OFF_SQES);
+  }
+  if (sqeMemory == MAP_FAILED) {
+    const int error = errno;
+    if (cqRing != MAP_FAILED && cqRing != sqRing) munmap(cqRing, cqRingSize);
+    if (sqRing != MAP_FAILED) munmap(sqRing, sqRingSize);
+    close(ringFd);
+    throw IoException("io_uring", error);
+  }
+
+  char *sq = static_cast<char *>(sqRing);
+  sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  char *cq = static_cast<char *>(cqRing);
+  cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  cqes = cq + params.cq_off.cqes;
+
+  reaper = std::thread(&IoUringEngine::reap, this);
+}
+
+IoUringEngine::~IoUringEngine() {
+  {
+    // Let everything submitted complete, then wake the reaper with a no-op
+    // that carries no callback.
+    std::unique_lock<std::mutex> guard(latch);
+    slotFree.wait(guard, [this]() { return inFlight == 0; });
+    if (!push(guard, IORING_OP_NOP, -1, nullptr, 0, 0, nullptr)) {
+      // Nothing will wake the reaper, so it keeps the ring.
+      reaper.detach();
+      return;
+    }
+  }
+  reaper.join();
+
+  munmap(sqeMemory, sqeSize);
+  if (cqRing != sqRing) munmap(cqRing, cqRingSize);
+  munmap(sqRing, sqRingSize);
+  close(ringFd);
+}
+
+void IoUringEngine::submit(const IoOp op, const int fd,
+                           const struct iovec *iov, const int iovcnt,
+                           const off_t offset, Callback callback) {
+  Callback *pending = new Callback(std::move(callback));
+  std::unique_lock<std::mutex> guard(latch);
+  slotFree.wait(guard, [this]() { return inFlight < entries; });
+  push(guard, op == IoOp::READ ? IORING_OP_READV : IORING_OP_WRITEV, fd, iov,
+       iovcnt, offset, pending);
+}
+
+bool IoUringEngine::push(std::unique_lock<std::mutex> &guard,
+                         const std::uint8_t opcode, const int fd,
+                         const struct iovec *iov, const int iovcnt,
+                         const off_t offset, Callback *callback) {
+  // Only submitters write the tail, and they hold latch.
+  const unsigned tail = *sqTail;
+  const unsigned index = tail & *sqMask;
+  struct io_uring_sqe *sqe =
+      static_cast<struct io_uring_sqe *>(sqeMemory) + index;
+  std::memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<std::uint64_t>(iov);
+  sqe->len = iovcnt;
+  sqe->off = offset;
+  sqe->user_data = reinterpret_cast<std::uint64_t>(callback);
+  sqArray[index] = index;
+  __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+  inFlight++;
+  unsubmitted++;
+
+  // The entry is submitted by this call or, while the latch is released
+  // below, by another submitter entering its own.
+  while (unsubmitted > 0) {
+    const int entered = ioUringEnter(ringFd, unsubmitted, 0, 0);
+    if (entered >= 0) {
+      unsubmitted -= std::min<std::uint32_t>(entered, unsubmitted);
+    } else if (errno == EAGAIN || errno == EBUSY) {
+      // The kernel is short of resources or the completion queue is full;
+      // either eases once the reaper takes completions.  The wait is
+      // bounded, as there may be no request in flight that was entered.
+      const std::uint64_t seen = completions;
+      slotFree.wait_for(guard, std::chrono::milliseconds(1), [&]() {
+        return completions != seen || unsubmitted == 0;
+      });
+    } else if (errno != EINTR) {
+      break;
+    }
+  }
+  if (unsubmitted == 0) return true;
+
+  // The kernel took none of the remaining entries, so they are withdrawn
+  // from the ring and their requests fail.
+  const int error = errno;
+  std::vector<Callback *> failed;
+  const unsigned end = *sqTail;
+  for (unsigned entry = end - unsubmitted; entry != end; entry++) {
+    const struct io_uring_sqe *unused =
+        static_cast<struct io_uring_sqe *>(sqeMemory) +
+        sqArray[entry & *sqMask];
+    failed.push_back(reinterpret_cast<Callback *>(unused->user_data));
+  }
+  __atomic_store_n(sqTail, end - unsubmitted, __ATOMIC_RELEASE);
+  inFlight -= unsubmitted;
+  unsubmitted = 0;
+  guard.unlock();
+  slotFree.notify_all();
+  for (Callback *pending : failed) {
+    if (pending == nullptr) continue;
+    (*pending)(-error);
+    delete pending;
+  }
+  return false;
+}
+
+void IoUringEngine::reap() {
+  while (true) {
+    // Only the reaper writes the head.
+    const unsigned head = *cqHead;
+    if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+      ioUringEnter(ringFd, 0, 1, IORING_ENTER_GETEVENTS);
+      continue;
+    }
+
+    const struct io_uring_cqe *cqe =
+        static_cast<struct io_uring_cqe *>(cqes) + (head & *cqMask);
+    Callback *callback = reinterpret_cast<Callback *>(cqe->user_data);
+    const ssize_t result = cqe->res;
+    __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+
+    {
+      std::lock_guard<std::mutex> guard(latch);
+      inFlight--;
+      completions++;
+    }
+    slotFree.notify_all();
+
+    if (callback == nullptr) return;  // the no-op sent by the destructor
+    (*callback)(result);
+    delete callback;
+  }
+}
+
+//----------------------------------------
+// ThreadPoolEngine
+//----------------------------------------
+
+ThreadPoolEngine::ThreadPoolEngine(const std::uint32_t threads)
+    : stopping(false) {
+  for (std::uint32_t i = 0; i < std::max<std::uint32_t>(1, threads); i++) {
+    workers.emplace_back(&ThreadPoolEngine::work, this);
+  }
+}
+
+ThreadPoolEngine::~ThreadPoolEngine() {
+  {
+    std::lock_guard<std::mutex> guard(latch);
+    stopping = true;
+  }
+  queued.notify_all();
+  for (std::thread &worker : workers) worker.join();
+}
+
+void ThreadPoolEngine::submit(const IoOp op, const int fd,
+                              const struct iovec *iov, const int iovcnt,
+                              const off_t offset, Callback callback) {
+  {
+    std::lock_guard<std::mutex> guard(latch);
+    queue.push_back(
+        Request{op, fd, iov, iovcnt, offset, std::move(callback)});
+  }
+  queued.notify_one();
+}
+
+void ThreadPoolEngine::work() {
+  std::unique_lock<std::mutex> guard(latch);
+  while (true) {
+    queued.wait(guard, [this]() { return stopping || !queue.empty(); });
+    if (queue.empty()) return;  // stopping, and nothing left to do
+
+    Request request = std::move(queue.front());
+    queue.pop_front();
+    guard.unlock();
+
+    ssize_t result;
+    do {
+      result = request.op == IoOp::READ
+                   ? preadv(request.fd, request.iov, request.iovcnt,
+                            request.offset)
+                   : pwritev(request.fd, request.iov, request.iovcnt,
+                             request.offset);
+    } while (result < 0 && errno == EINTR);
+    request.callback(result < 0 ? -errno : result);
+
+    guard.lock();
+  }
+}
+
+}  // namespace badgerdb
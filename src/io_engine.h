@@ -0,0 +1,238 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace badgerdb {
+
+/**
+ * @brief Kind of an asynchronous I/O request.
+ */
+enum class IoOp { READ, WRITE };
+
+/**
+ * @brief Asynchronous positional reads and writes of file descriptors.
+ *
+ * Requests are submitted with submit() and complete later on a thread owned
+ * by the engine, which then calls the request's callback with the number of
+ * bytes transferred, or with a negative errno value on failure.  The iovec
+ * array and the buffers it points to have to stay valid until then.
+ *
+ * Callbacks should be short; they must not wait for other requests of the
+ * same engine to complete.
+ *
+ * The destructor waits for all submitted requests to complete.
+ */
+class IoEngine {
+ public:
+  /**
+   * Called once a request completed, with the number of bytes transferred or
+   * a negative errno value.
+   */
+  typedef std::function<void(const ssize_t result)> Callback;
+
+  /**
+   * Creates an io_uring engine if the kernel supports io_uring and a thread
+   * pool engine otherwise.
+   *
+   * @param queueDepth  Maximum number of requests in flight; further
+   *                    submissions wait for a slot.
+   * @return  The engine.
+   */
+  static std::unique_ptr<IoEngine> create(const std::uint32_t queueDepth = 64);
+
+  /**
+   * Creates an engine that runs blocking preadv/pwritev calls on a pool of
+   * threads.
+   *
+   * @param queueDepth  Number of threads, and so of requests in flight;
+   *                    further submissions are queued.
+   * @return  The engine.
+   */
+  static std::unique_ptr<IoEngine> createThreadPool(
+      const std::uint32_t queueDepth = 64);
+
+  /**
+   * Returns the engine shared by all files of the process, created on first
+   * use.
+   */
+  static IoEngine &shared();
+
+  virtual ~IoEngine() {}
+
+  /**
+   * Submits a read into, or a write from, the given buffers.
+   *
+   * @param op        Read or write.
+   * @param fd        File descriptor.
+   * @param iov       Buffers, filled or written in order.
+   * @param iovcnt    Number of buffers.
+   * @param offset    Position in the file.
+   * @param callback  Called on completion.
+   */
+  virtual void submit(const IoOp op, const int fd, const struct iovec *iov,
+                      const int iovcnt, const off_t offset,
+                      Callback callback) = 0;
+
+  /**
+   * Returns the name of the backend, for reports.
+   */
+  virtual const char *name() const = 0;
+};
+
+/**
+ * @brief IoEngine on a Linux io_uring instance.
+ *
+ * The rings are set up with raw system calls.  Submissions are serialized
+ * and entered one at a time; a reaper thread waits for completions and runs
+ * the callbacks.
+ */
+class IoUringEngine : public IoEngine {
+ public:
+  /**
+   * Sets up an io_uring instance.
+   *
+   * @param queueDepth  Number of submission queue entries.
+   * @throws  IoException  If io_uring is not available.
+   */
+  explicit IoUringEngine(const std::uint32_t queueDepth);
+  ~IoUringEngine() override;
+
+  void submit(const IoOp op, const int fd, const struct iovec *iov,
+              const int iovcnt, const off_t offset,
+              Callback callback) override;
+  const char *name() const override { return "io_uring"; }
+
+ private:
+  /**
+   * Queues one submission queue entry and enters it.  Must be called with
+   * latch held and a free slot.  While the kernel is short of resources or
+   * the completion queue is full, the latch is released to wait for
+   * completions before entering again.  If entering fails otherwise, the
+   * entries not taken by the kernel are withdrawn and their callbacks are
+   * called with the negative errno value, after the latch is released.
+   *
+   * @param guard     Holds latch.
+   * @param callback  Callback of the entry, or nullptr.
+   * @return  True if the entry was submitted.
+   */
+  bool push(std::unique_lock<std::mutex> &guard, const std::uint8_t opcode,
+            const int fd, const struct iovec *iov, const int iovcnt,
+            const off_t offset, Callback *callback);
+
+  /**
+   * Body of the reaper thread.
+   */
+  void reap();
+
+  int ringFd;
+  std::uint32_t entries;
+
+  void *sqRing;
+  std::size_t sqRingSize;
+  void *cqRing;
+  std::size_t cqRingSize;
+  void *sqeMemory;
+  std::size_t sqeSize;
+
+  unsigned *sqTail;
+  unsigned *sqMask;
+  unsigned *sqArray;
+  unsigned *cqHead;
+  unsigned *cqTail;
+  unsigned *cqMask;
+  void *cqes;
+
+  /**
+   * Protects the submission queue and inFlight
+   */
+  std::mutex latch;
+
+  /**
+   * Signals that a slot became free
+   */
+  std::condition_variable slotFree;
+
+  std::uint32_t inFlight;
+
+  /**
+   * Entries in the submission queue that were not entered yet
+   */
+  std::uint32_t unsubmitted;
+
+  /**
+   * Number of completions taken by the reaper, to wait for the next one
+   */
+  std::uint64_t completions;
+  std::thread reaper;
+};
+
+/**
+ * @brief IoEngine that runs blocking preadv/pwritev calls on a thread pool.
+ */
+class ThreadPoolEngine : public IoEngine {
+ public:
+  /**
+   * Starts the threads.
+   *
+   * @param threads   Number of threads, and of requests in flight.
+   */
+  explicit ThreadPoolEngine(const std::uint32_t threads);
+  ~ThreadPoolEngine() override;
+
+  void submit(const IoOp op, const int fd, const struct iovec *iov,
+              const int iovcnt, const off_t offset,
+              Callback callback) override;
+  const char *name() const override { return "threadpool"; }
+
+ private:
+  /**
+   * @brief A request waiting for a thread
+   */
+  struct Request {
+    IoOp op;
+    int fd;
+    const struct iovec *iov;
+    int iovcnt;
+    off_t offset;
+    Callback callback;
+  };
+
+  /**
+   * Body of every thread.
+   */
+  void work();
+
+  /**
+   * Protects queue and stopping
+   */
+  std::mutex latch;
+
+  /**
+   * Signals that a request was queued or that the threads should stop
+   */
+  std::condition_variable queued;
+
+  std::deque<Request> queue;
+  bool stopping;
+  std::vector<std::thread> workers;
+};
+
+}  // namespace badgerdb
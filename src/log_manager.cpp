@@ -0,0 +1,310 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "log_manager.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "checksum.h"
+#include "exceptions/io_exception.h"
+
+namespace badgerdb {
+
+const std::uint32_t LogManager::FRAME_BYTES;
+
+LogManager::LogManager(const std::string& filename, const LogConfig& config)
+    : filename_(filename),
+      config(config),
+      activeStart(0),
+      requestedLsn(0),
+      durableLsn(0),
+      stop(false) {
+  do {
+    fd = ::open(filename_.c_str(), O_RDWR | O_CREAT, 0644);
+  } while (fd < 0 && errno == EINTR);
+  if (fd < 0) {
+    throw IoException(filename_, errno);
+  }
+
+  // Append after the last complete record, dropping a torn one.  The log is
+  // complete up to the last checkpoint, unless it was replaced since.
+  Lsn end;
+  try {
+    Lsn start = readMaster(filename_).checkpointLsn;
+    struct stat status;
+    if (fstat(fd, &status) != 0) {
+      throw IoException(filename_, errno);
+    }
+    if (start > (Lsn)status.st_size) start = 0;
+    end = scan(fd, filename_, start, RecordCallback());
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  if (ftruncate(fd, end) != 0) {
+    const int error = errno;
+    ::close(fd);
+    throw IoException(filename_, error);
+  }
+  activeStart = requestedLsn = end;
+  durableLsn = end;
+
+  active.reserve(config.bufferBytes);
+  writing.reserve(config.bufferBytes);
+  writer = std::thread(&LogManager::writerLoop, this);
+}
+
+LogManager::~LogManager() {
+  try {
+    flushAll();
+  } catch (const IoException& e) {
+    // Nothing can be done about it here; the records that were not written
+    // are lost.
+  }
+  {
+    std::lock_guard<std::mutex> guard(latch);
+    stop = true;
+  }
+  writerWakeup.notify_one();
+  writer.join();
+  ::close(fd);
+}
+
+Lsn LogManager::append(const void* data, const std::uint32_t length) {
+  const std::uint32_t frame[3] = {length, ~length, crc32c(data, length)};
+  const std::size_t bytes = FRAME_BYTES + length;
+  std::unique_lock<std::mutex> guard(latch);
+  checkError();
+  while (!active.empty() && active.size() + bytes > config.bufferBytes) {
+    // Hand the full buffer to the log writer and wait until it took it.
+    requestedLsn = std::max(requestedLsn, activeStart + active.size());
+    writerWakeup.notify_one();
+    progress.wait(guard);
+    checkError();
+  }
+  const char* framing = reinterpret_cast<const char*>(frame);
+  const char* payload = static_cast<const char*>(data);
+  active.insert(active.end(), framing, framing + FRAME_BYTES);
+  active.insert(active.end(), payload, payload + length);
+  stats.appends++;
+  stats.bytes += bytes;
+  return activeStart + active.size();
+}
+
+void LogManager::flush(Lsn lsn) {
+  if (durableLsn >= lsn) return;
+
+  std::unique_lock<std::mutex> guard(latch);
+  checkError();
+  // Pages may carry LSNs of an older log that got further.
+  lsn = std::min(lsn, activeStart + active.size());
+  if (durableLsn >= lsn) return;
+  stats.flushWaits++;
+  if (lsn > requestedLsn) {
+    requestedLsn = lsn;
+    writerWakeup.notify_one();
+  }
+  progress.wait(guard, [this, lsn]() { return error || durableLsn >= lsn; });
+  checkError();
+}
+
+void LogManager::flushAll() { flush(lastLsn()); }
+
+Lsn LogManager::flushedLsn() const { return durableLsn; }
+
+Lsn LogManager::lastLsn() {
+  std::lock_guard<std::mutex> guard(latch);
+  return activeStart + active.size();
+}
+
+LogStats LogManager::getStats() {
+  std::lock_guard<std::mutex> guard(latch);
+  return stats;
+}
+
+Lsn LogManager::writeCheckpoint(const Lsn redoLsn) {
+  CheckpointRecord record;
+  std::memset(&record, 0, sizeof(record));
+  record.type = LogRecordType::CHECKPOINT;
+  record.redoLsn = redoLsn;
+  const Lsn lsn = append(&record, sizeof(record));
+  flush(lsn);
+
+  // The master record fits in one sector, so it is written whole or not at
+  // all.
+  const std::string master = masterFilename(filename_);
+  const Master contents = {lsn, redoLsn};
+  int masterFd;
+  do {
+    masterFd = ::open(master.c_str(), O_WRONLY | O_CREAT, 0644);
+  } while (masterFd < 0 && errno == EINTR);
+  if (masterFd < 0) {
+    throw IoException(master, errno);
+  }
+  ssize_t result;
+  do {
+    result = pwrite(masterFd, &contents, sizeof(contents), 0 /* offset */);
+  } while (result < 0 && errno == EINTR);
+  if (result != (ssize_t)sizeof(contents) || fdatasync(masterFd) != 0) {
+    const int error =
+        result >= 0 && result < (ssize_t)sizeof(contents) ? EIO : errno;
+    ::close(masterFd);
+    throw IoException(master, error);
+  }
+  ::close(masterFd);
+  return lsn;
+}
+
+Lsn LogManager::redoLsn(const std::string& filename) {
+  return readMaster(filename).redoLsn;
+}
+
+LogManager::Master LogManager::readMaster(const std::string& filename) {
+  Master contents = {0, 0};
+  const int fd = ::open(masterFilename(filename).c_str(), O_RDONLY);
+  if (fd < 0) {
+    return contents;
+  }
+  if (pread(fd, &contents, sizeof(contents), 0 /* offset */) !=
+      (ssize_t)sizeof(contents)) {
+    contents = {0, 0};
+  }
+  ::close(fd);
+  return contents;
+}
+
+void LogManager::checkError() {
+  if (error) std::rethrow_exception(error);
+}
+
+void LogManager::writerLoop() {
+  std::unique_lock<std::mutex> guard(latch);
+  while (true) {
+    writerWakeup.wait(guard, [this]() {
+      return stop || (!error && requestedLsn > durableLsn);
+    });
+    if (stop) return;
+
+    if (config.commitDelay.count() > 0) {
+      // Let more committers join this write.
+      guard.unlock();
+      std::this_thread::sleep_for(config.commitDelay);
+      guard.lock();
+    }
+
+    // Take everything appended so far; appends continue into the other
+    // buffer while this one is written.
+    writing.swap(active);
+    const Lsn start = activeStart;
+    activeStart += writing.size();
+    progress.notify_all();
+    guard.unlock();
+
+    int failure = 0;
+    for (std::size_t done = 0; done < writing.size();) {
+      const ssize_t result = pwrite(fd, writing.data() + done,
+                                    writing.size() - done, start + done);
+      if (result < 0) {
+        if (errno == EINTR) continue;
+        failure = errno;
+        break;
+      }
+      done += result;
+    }
+    if (failure == 0 && fdatasync(fd) != 0) {
+      failure = errno;
+    }
+    const Lsn end = start + writing.size();
+    writing.clear();
+
+    guard.lock();
+    if (failure != 0) {
+      error = std::make_exception_ptr(IoException(filename_, failure));
+    } else {
+      durableLsn = end;
+      stats.flushes++;
+    }
+    progress.notify_all();
+  }
+}
+
+void LogManager::replay(const std::string& filename, const Lsn from,
+                        const RecordCallback& callback) {
+  int fd;
+  do {
+    fd = ::open(filename.c_str(), O_RDONLY);
+  } while (fd < 0 && errno == EINTR);
+  if (fd < 0) {
+    throw IoException(filename, errno);
+  }
+  try {
+    scan(fd, filename, from, callback);
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+}
+
+Lsn LogManager::scan(const int fd, const std::string& filename, const Lsn from,
+                     const RecordCallback& callback) {
+  // Unparsed bytes are buffer[begin, end), starting at LSN position.
+  std::vector<char> buffer(1 << 20);
+  std::size_t begin = 0;
+  std::size_t end = 0;
+  Lsn position = from;
+  bool eof = false;
+  while (true) {
+    std::size_t need = FRAME_BYTES;
+    if (end - begin >= FRAME_BYTES) {
+      std::uint32_t frame[3];
+      std::memcpy(frame, &buffer[begin], FRAME_BYTES);
+      if (frame[0] != ~frame[1]) {
+        return position;  // a torn frame, or not a frame at all
+      }
+      need = FRAME_BYTES + frame[0];
+      if (end - begin >= need) {
+        if (crc32c(&buffer[begin + FRAME_BYTES], frame[0]) != frame[2]) {
+          return position;  // an intact frame around a torn or stale payload
+        }
+        position += need;
+        if (callback) {
+          callback(position, &buffer[begin + FRAME_BYTES], frame[0]);
+        }
+        begin += need;
+        continue;
+      }
+    }
+    if (eof) {
+      return position;  // the last record is incomplete
+    }
+
+    // Move the partial record to the front and read more after it.
+    std::memmove(&buffer[0], &buffer[begin], end - begin);
+    end -= begin;
+    begin = 0;
+    if (buffer.size() < need) buffer.resize(need);
+    ssize_t result;
+    do {
+      result = pread(fd, &buffer[end], buffer.size() - end, position + end);
+    } while (result < 0 && errno == EINTR);
+    if (result < 0) {
+      throw IoException(filename, errno);
+    }
+    eof = result == 0;
+    end += result;
+  }
+}
+
+}  // namespace badgerdb
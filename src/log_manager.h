@@ -0,0 +1,409 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Kind of a log record, stored in its first byte.
+ */
+enum class LogRecordType : std::uint8_t {
+  /**
+   * New contents of a byte range of a page, see PageUpdateRecord
+   */
+  PAGE_UPDATE = 1,
+
+  /**
+   * Fuzzy checkpoint, see CheckpointRecord
+   */
+  CHECKPOINT = 2
+};
+
+/**
+ * @brief Header of a log record written by BufMgr::logUpdate().
+ *
+ * The header is followed by the length bytes at offset in the page image
+ * after the change, and then by the nameLength bytes of the name of the
+ * page's file.
+ */
+struct PageUpdateRecord {
+  /**
+   * LogRecordType::PAGE_UPDATE
+   */
+  LogRecordType type;
+
+  /**
+   * Offset of the first changed byte in the page image
+   */
+  std::uint16_t offset;
+
+  /**
+   * Number of bytes logged
+   */
+  std::uint16_t length;
+
+  /**
+   * Length of the file name
+   */
+  std::uint16_t nameLength;
+
+  /**
+   * Number of the page in its file
+   */
+  PageId pageNo;
+};
+
+/**
+ * @brief Log record written by LogManager::writeCheckpoint().
+ */
+struct CheckpointRecord {
+  /**
+   * LogRecordType::CHECKPOINT
+   */
+  LogRecordType type;
+
+  /**
+   * Recovery replays the records after this LSN
+   */
+  Lsn redoLsn;
+};
+
+/**
+ * @brief Settings of a LogManager
+ */
+struct LogConfig {
+  /**
+   * Size of each of the two log buffers.  Appends wait for the log to be
+   * written when the buffer in use is full; a record larger than the buffer
+   * grows it.
+   */
+  std::size_t bufferBytes = 1 << 20;
+
+  /**
+   * Time the log writer waits after being asked to flush, so that more
+   * committers join the same write and sync.  0 flushes at once; committers
+   * that arrive while a sync is in progress join the next one anyway.
+   */
+  std::chrono::microseconds commitDelay = std::chrono::microseconds(0);
+};
+
+/**
+ * @brief Statistics of a LogManager
+ */
+struct LogStats {
+  /**
+   * Number of records appended
+   */
+  std::uint64_t appends;
+
+  /**
+   * Number of bytes appended, framing included
+   */
+  std::uint64_t bytes;
+
+  /**
+   * Number of writes of the log, each followed by one sync
+   */
+  std::uint64_t flushes;
+
+  /**
+   * Number of flush() calls that had to wait for a sync
+   */
+  std::uint64_t flushWaits;
+
+  /**
+   * Clear all values
+   */
+  void clear() { appends = bytes = flushes = flushWaits = 0; }
+
+  /**
+   * Constructor of LogStats class
+   */
+  LogStats() { clear(); }
+};
+
+/**
+ * @brief Write-ahead log: an append-only file of records identified by LSN.
+ *
+ * Records are appended to an in-memory buffer and written sequentially by a
+ * log writer thread, which syncs the log once for everything appended since
+ * its last write.  flush() waits until the log is durable up to an LSN, so
+ * callers that flush at about the same time share one write and one sync
+ * (group commit).  While one buffer is written, appends go to the other.
+ *
+ * The LSN of a record is the position in the log file just past it, so LSNs
+ * grow with every record and stay valid when the log is opened again.  Every
+ * record is framed by its length and the CRC-32C of its payload, and a torn
+ * record at the end of the log is cut off when the log is opened, even if
+ * only its payload is torn.
+ *
+ * Checkpoints bound the part of the log that recovery has to replay.  The
+ * last one is found through a small master file next to the log, named by
+ * masterFilename(), so that neither opening the log nor recovery has to read
+ * the log before the checkpoint's redo LSN.
+ *
+ * All methods may be called from several threads.  The latches of the log
+ * manager are taken after any latch of a BufMgr, never before.
+ */
+class LogManager {
+ public:
+  /**
+   * Called by replay() for every record, with its LSN and payload.
+   */
+  typedef std::function<void(const Lsn lsn, const char* data,
+                             const std::uint32_t length)>
+      RecordCallback;
+
+  /**
+   * Opens the log, creating it if it doesn't exist, and starts the log
+   * writer.  New records are appended after the last complete one.
+   *
+   * @param filename  Name of the log file
+   * @param config    Buffer size and commit delay
+   * @throws  IoException  If the log cannot be opened
+   */
+  explicit LogManager(const std::string& filename,
+                      const LogConfig& config = LogConfig());
+
+  /**
+   * Flushes the log, stops the log writer and closes the log.
+   */
+  ~LogManager();
+
+  LogManager(const LogManager&) = delete;
+  LogManager& operator=(const LogManager&) = delete;
+
+  /**
+   * Appends a record.  The record is durable once flush() was called with
+   * its LSN or a later one.
+   *
+   * @param data    Payload of the record
+   * @param length  Length of the payload
+   * @return  LSN of the record
+   * @throws  IoException  If an earlier write of the log failed
+   */
+  Lsn append(const void* data, const std::uint32_t length);
+
+  /**
+   * Waits until every record up to the given LSN is on disk.
+   *
+   * @param lsn   LSN to make durable
+   * @throws  IoException  If the log cannot be written or synced
+   */
+  void flush(const Lsn lsn);
+
+  /**
+   * Waits until every record appended so far is on disk.
+   *
+   * @throws  IoException  If the log cannot be written or synced
+   */
+  void flushAll();
+
+  /**
+   * Returns the LSN up to which the log is on disk.
+   */
+  Lsn flushedLsn() const;
+
+  /**
+   * Returns the LSN of the last record appended, or of the end of the log
+   * when it was opened.
+   */
+  Lsn lastLsn();
+
+  /**
+   * Appends a checkpoint record, flushes the log and then records the
+   * checkpoint in the master file.  The caller guarantees that every change
+   * logged up to redoLsn is in the data files on disk.
+   *
+   * @param redoLsn   Recovery may start replaying after this LSN
+   * @return  LSN of the checkpoint record
+   * @throws  IoException  If the log or the master file cannot be written
+   */
+  Lsn writeCheckpoint(const Lsn redoLsn);
+
+  /**
+   * Returns the redo LSN of the last checkpoint of a log, or 0 if the log
+   * has no checkpoint.
+   *
+   * @param filename  Name of the log file
+   */
+  static Lsn redoLsn(const std::string& filename);
+
+  /**
+   * Returns the name of the master file of a log.
+   *
+   * @param filename  Name of the log file
+   */
+  static std::string masterFilename(const std::string& filename) {
+    return filename + ".master";
+  }
+
+  /**
+   * Returns the name of the log file.
+   */
+  const std::string& filename() const { return filename_; }
+
+  /**
+   * Get log statistics
+   */
+  LogStats getStats();
+
+  /**
+   * Reads the complete records of a log file in order.
+   *
+   * @param filename  Name of the log file
+   * @param from      Reading starts here, so this has to be 0, the LSN of a
+   * record or a redo LSN; the records after it are passed on
+   * @param callback  Called for every record
+   * @throws  IoException  If the log cannot be read
+   */
+  static void replay(const std::string& filename, const Lsn from,
+                     const RecordCallback& callback);
+
+ private:
+  /**
+   * Length of the frame around every record: the payload length, its
+   * complement and the CRC-32C of the payload
+   */
+  static const std::uint32_t FRAME_BYTES = 12;
+
+  /**
+   * @brief Contents of the master file
+   */
+  struct Master {
+    /**
+     * LSN of the last checkpoint record
+     */
+    Lsn checkpointLsn;
+
+    /**
+     * Redo LSN of that checkpoint
+     */
+    Lsn redoLsn;
+  };
+
+  /**
+   * Reads the master file of a log.
+   *
+   * @return  The master record, all 0 if there is none
+   */
+  static Master readMaster(const std::string& filename);
+
+  /**
+   * Reads the complete records of the open log file in order, starting at
+   * the given LSN.
+   *
+   * @return  LSN of the end of the last complete record
+   */
+  static Lsn scan(const int fd, const std::string& filename, const Lsn from,
+                  const RecordCallback& callback);
+
+  /**
+   * Body of the log writer thread
+   */
+  void writerLoop();
+
+  /**
+   * Rethrows the error of a failed log write.  Must be called with latch
+   * held.
+   */
+  void checkError();
+
+  /**
+   * Name of the log file
+   */
+  const std::string filename_;
+
+  /**
+   * Descriptor of the log file
+   */
+  int fd;
+
+  /**
+   * Settings of the log
+   */
+  const LogConfig config;
+
+  /**
+   * Protects everything below but durableLsn, which is only written with it
+   * held
+   */
+  std::mutex latch;
+
+  /**
+   * Signals the log writer that there is work or that it should stop
+   */
+  std::condition_variable writerWakeup;
+
+  /**
+   * Signals that the log writer made progress: the log became durable up to
+   * a new LSN, a buffer became free, or a write failed
+   */
+  std::condition_variable progress;
+
+  /**
+   * Records appended but not handed to the log writer yet
+   */
+  std::vector<char> active;
+
+  /**
+   * Buffer being written by the log writer, empty in between
+   */
+  std::vector<char> writing;
+
+  /**
+   * LSN of the first byte of active
+   */
+  Lsn activeStart;
+
+  /**
+   * Highest LSN that flush() waits for
+   */
+  Lsn requestedLsn;
+
+  /**
+   * LSN up to which the log is on disk; read without latch by flushedLsn()
+   */
+  std::atomic<Lsn> durableLsn;
+
+  /**
+   * Error of a failed write or sync; every later flush rethrows it
+   */
+  std::exception_ptr error;
+
+  /**
+   * Tells the log writer to exit once the log is durable
+   */
+  bool stop;
+
+  /**
+   * Statistics of the log
+   */
+  LogStats stats;
+
+  /**
+   * Log writer thread
+   */
+  std::thread writer;
+};
+
+}  // namespace badgerdb
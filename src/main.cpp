@@ -1,15 +1,31 @@
 #include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include <iostream>
 //#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <cstring>
+#include <fstream>
+#include <future>
 #include <memory>
 #include <optional>
+#include <random>
+#include <thread>
+#include <vector>
 
 #include "buffer.h"
+#include "checksum.h"
+#include "compression.h"
+#include "exceptions/corrupt_page_exception.h"
 #include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/file_exists_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/io_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "file_iterator.h"
@@ -40,6 +56,29 @@ void test3(File &file4);
 void test4(File &file4);
 void test5(File &file4);
 void test6(File &file1);
+void test7(File &file1);
+void test8(File &file1);
+void test9(File &file1);
+void test10(File &file1);
+void test11(File &file1);
+void test12(File &file1);
+void test13(File &file1);
+void test14(File &file1);
+void test15(File &file1);
+void test16(File &file1);
+void test17();
+void test18();
+void test19();
+void test20();
+void test21();
+void test22();
+void test23();
+void test24();
+void test25();
+void test26();
+void test27();
+void test28();
+void test29(File &file1);
 // Calls the above tests
 void testBufMgr();
 
@@ -140,6 +179,29 @@ void testBufMgr() {
     test4(file4);
     test5(file5);
     test6(file1);
+    test7(file1);
+    test8(file1);
+    test9(file1);
+    test10(file1);
+    test11(file1);
+    test12(file1);
+    test13(file1);
+    test14(file1);
+    test15(file1);
+    test16(file1);
+    test17();
+    test18();
+    test19();
+    test20();
+    test21();
+    test22();
+    test23();
+    test24();
+    test25();
+    test26();
+    test27();
+    test28();
+    test29(file1);
 
     // Close the files by going out of scope
   }
@@ -297,3 +359,1635 @@ void test6(File &file1) {
 
   bufMgr->flushFile(file1);
 }
+
+void test7(File &file1) {
+  // Concurrent readers on a sharded buffer manager. The pool is smaller than
+  // the file so hits and misses (with evictions) race in every shard.
+  BufMgr shardedMgr(num / 2, 4);
+  const int numThreads = 4;
+  std::vector<File> files(numThreads, file1);
+  std::vector<bool> matched(numThreads, true);
+  std::vector<std::thread> threads;
+
+  for (int t = 0; t < numThreads; t++) {
+    threads.emplace_back([&shardedMgr, &files, &matched, t]() {
+      char buf[100];
+      Page *threadPage;
+      for (PageId j = 0; j < 10 * num; j++) {
+        // Every page of file1 holds a single record in its first slot.
+        PageId pageNo = 1 + (j * 7 + t * 13) % num;
+        RecordId recordId = {pageNo, 1};
+        shardedMgr.readPage(files[t], pageNo, threadPage);
+        sprintf(buf, "test.1 Page %u %7.1f", pageNo, (float)pageNo);
+        if (strncmp(threadPage->getRecord(recordId).c_str(), buf,
+                    strlen(buf)) != 0) {
+          matched[t] = false;
+        }
+        shardedMgr.unPinPage(files[t], pageNo, false);
+      }
+    });
+  }
+  for (std::thread &thread : threads) thread.join();
+
+  for (int t = 0; t < numThreads; t++) {
+    if (!matched[t]) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+  }
+  shardedMgr.flushFile(file1);
+
+  std::cout << "Test 7 passed"
+            << "\n";
+}
+
+// Drives a replacement policy the way the buffer manager does, for pages
+// that are unpinned right after they are pinned, and records the pages it
+// evicts.  Page keys start at 1; 0 marks a free frame.
+struct PolicyDriver {
+  PolicyDriver(const ReplacementPolicyType type, const std::uint32_t frames)
+      : policy(ReplacementPolicy::create(type, frames)), pages(frames, 0) {}
+
+  void access(const PageKey key) {
+    const auto found = std::find(pages.begin(), pages.end(), key);
+    if (found != pages.end()) {
+      const FrameId frame = found - pages.begin();
+      policy->access(frame);
+      policy->unpin(frame);
+      return;
+    }
+    FrameId frame;
+    if (!policy->evict(key, frame)) {
+      PRINT_ERROR("ERROR :: Policy found no victim among unpinned frames");
+    }
+    if (pages[frame] != 0) evicted.push_back(pages[frame]);
+    pages[frame] = key;
+    policy->fill(frame, key);
+    policy->unpin(frame);
+  }
+
+  bool resident(const PageKey key) const {
+    return std::find(pages.begin(), pages.end(), key) != pages.end();
+  }
+
+  std::unique_ptr<ReplacementPolicy> policy;
+  std::vector<PageKey> pages;
+  std::vector<PageKey> evicted;
+};
+
+void test8(File &file1) {
+  // Every replacement policy has to keep page contents intact while evicting
+  // and must never hand out a pinned frame.  Each one also has to pick its
+  // own victims: LRU the least recently unpinned page, CLOCK the first page
+  // the hand finds unreferenced, LRU-2 pages with fewer than two accesses
+  // first, and 2Q, ARC and CLOCK-Pro have to keep a hot set through a
+  // one-time scan.
+  {
+    PolicyDriver lru(ReplacementPolicyType::LRU, 4);
+    for (const PageKey key : {1, 2, 3, 4, 1, 5, 6}) lru.access(key);
+    if (lru.evicted != std::vector<PageKey>{2, 3}) {
+      PRINT_ERROR("ERROR :: LRU did not evict the least recently used pages");
+    }
+
+    PolicyDriver clock(ReplacementPolicyType::CLOCK, 4);
+    for (const PageKey key : {1, 2, 3, 4, 5, 2, 6}) clock.access(key);
+    if (clock.evicted != std::vector<PageKey>{1, 3}) {
+      PRINT_ERROR("ERROR :: CLOCK did not give referenced pages a second "
+                  "chance");
+    }
+
+    PolicyDriver lruK(ReplacementPolicyType::LRU_K, 4);
+    for (const PageKey key : {1, 1, 2, 2, 3, 4, 5, 6}) lruK.access(key);
+    if (lruK.evicted != std::vector<PageKey>{3, 4}) {
+      PRINT_ERROR("ERROR :: LRU-2 did not evict pages seen once first");
+    }
+  }
+
+  for (const ReplacementPolicyType policy :
+       {ReplacementPolicyType::TWO_Q, ReplacementPolicyType::ARC,
+        ReplacementPolicyType::CLOCK_PRO, ReplacementPolicyType::LRU}) {
+    // Pages 1 and 2 are read, pushed out by eight others and read twice
+    // more, then 100 pages are scanned once.
+    PolicyDriver driver(policy, 8);
+    for (PageKey key = 1; key <= 10; key++) driver.access(key);
+    for (const PageKey key : {1, 2, 1, 2}) driver.access(key);
+    for (PageKey key = 100; key < 200; key++) driver.access(key);
+    const bool kept = driver.resident(1) && driver.resident(2);
+    // LRU, for contrast, loses them.
+    if (kept != (policy != ReplacementPolicyType::LRU)) {
+      PRINT_ERROR("ERROR :: " << ReplacementPolicy::name(policy)
+                              << " did not keep the hot pages through a "
+                                 "scan");
+    }
+  }
+
+  const ReplacementPolicyType policies[] = {
+      ReplacementPolicyType::CLOCK, ReplacementPolicyType::LRU,
+      ReplacementPolicyType::LRU_K, ReplacementPolicyType::TWO_Q,
+      ReplacementPolicyType::ARC,   ReplacementPolicyType::CLOCK_PRO};
+
+  for (ReplacementPolicyType policy : policies) {
+    BufMgr policyMgr(num / 4, 1, policy);
+
+    // A small hot set interleaved with a scan over the whole file.
+    for (PageId j = 0; j < 10 * num; j++) {
+      PageId pageNo = j % 2 ? 1 + j % 5 : 1 + (j / 2) % num;
+      RecordId recordId = {pageNo, 1};
+      policyMgr.readPage(file1, pageNo, page);
+      sprintf(tmpbuf, "test.1 Page %u %7.1f", pageNo, (float)pageNo);
+      if (strncmp(page->getRecord(recordId).c_str(), tmpbuf,
+                  strlen(tmpbuf)) != 0) {
+        PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+      }
+      policyMgr.unPinPage(file1, pageNo, false);
+    }
+
+    BufStats stats = policyMgr.getBufStats();
+    if (stats.accesses != 10 * (int)num || stats.hits == 0 ||
+        stats.hits + stats.diskreads != stats.accesses) {
+      PRINT_ERROR("ERROR :: BUFFER STATISTICS DID NOT MATCH");
+    }
+
+    for (i = 1; i <= num / 4; i++) policyMgr.readPage(file1, i, page);
+    try {
+      policyMgr.readPage(file1, num / 4 + 1, page);
+      PRINT_ERROR(
+          "ERROR :: All frames are pinned. Exception should have been "
+          "thrown before execution reaches this point.");
+    } catch (const BufferExceededException &e) {
+    }
+    for (i = 1; i <= num / 4; i++) policyMgr.unPinPage(file1, i, false);
+
+    policyMgr.flushFile(file1);
+  }
+
+  std::cout << "Test 8 passed"
+            << "\n";
+}
+
+void test9(File &file1) {
+  // The background writer has to write back dirty pages before any miss
+  // needs their frames, and flushFile then has nothing left to write.
+  BufMgr writerMgr(num);
+  BgWriterConfig config;
+  config.lowWatermark = 0;
+  config.highWatermark = 0;
+  config.interval = std::chrono::milliseconds(1);
+  writerMgr.startBgWriter(config);
+
+  for (i = 1; i <= num; i++) {
+    RecordId recordId = {i, 1};
+    writerMgr.readPage(file1, i, page);
+    sprintf(tmpbuf, "test.1 Page %u %7.1f", i, (float)i);
+    page->updateRecord(recordId, tmpbuf);
+    writerMgr.unPinPage(file1, i, true);
+  }
+
+  for (int wait = 0; writerMgr.getBufStats().diskwrites < (int)num; wait++) {
+    if (wait == 5000) {
+      PRINT_ERROR("ERROR :: Background writer did not write the dirty pages");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  writerMgr.stopBgWriter();
+
+  writerMgr.flushFile(file1);
+  if (writerMgr.getBufStats().diskwrites != (int)num) {
+    PRINT_ERROR("ERROR :: Pages were written back more than once");
+  }
+
+  std::cout << "Test 9 passed"
+            << "\n";
+}
+
+void test10(File &file1) {
+  // A sequential scan with read-ahead has to see the same contents, and an
+  // explicit prefetch has to turn the following reads into hits.
+  BufMgr prefetchMgr(num / 2);
+  prefetchMgr.enableReadAhead();
+  for (i = 1; i <= num; i++) {
+    RecordId recordId = {i, 1};
+    prefetchMgr.readPage(file1, i, page);
+    sprintf(tmpbuf, "test.1 Page %u %7.1f", i, (float)i);
+    if (strncmp(page->getRecord(recordId).c_str(), tmpbuf, strlen(tmpbuf)) !=
+        0) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+    prefetchMgr.unPinPage(file1, i, false);
+  }
+  prefetchMgr.flushFile(file1);
+  prefetchMgr.disableReadAhead();
+
+  prefetchMgr.clearBufStats();
+  prefetchMgr.prefetch(file1, 1, 10);
+  for (int wait = 0; prefetchMgr.getBufStats().prefetched < 10; wait++) {
+    if (wait == 5000) {
+      PRINT_ERROR("ERROR :: Prefetched pages were not read");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  for (i = 1; i <= 10; i++) {
+    prefetchMgr.readPage(file1, i, page);
+    prefetchMgr.unPinPage(file1, i, false);
+  }
+  BufStats stats = prefetchMgr.getBufStats();
+  if (stats.hits != 10 || stats.diskreads != 10) {
+    PRINT_ERROR("ERROR :: Prefetched pages were read again");
+  }
+
+  // Prefetching past the end of the file stops quietly, and a page that was
+  // prefetched but never read is counted when it leaves the pool.
+  prefetchMgr.prefetch(file1, num, 10);
+  for (int wait = 0; prefetchMgr.getBufStats().prefetched < 11; wait++) {
+    if (wait == 5000) {
+      PRINT_ERROR("ERROR :: Prefetched pages were not read");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  prefetchMgr.flushFile(file1);
+  stats = prefetchMgr.getBufStats();
+  if (stats.prefetched != 11 || stats.prefetchUnused != 1) {
+    PRINT_ERROR("ERROR :: Unused prefetched pages were not counted");
+  }
+
+  std::cout << "Test 10 passed"
+            << "\n";
+}
+
+void test11(File &file1) {
+  // Asynchronous reads have to return the same contents as synchronous ones,
+  // and concurrent requests for one page have to share a single read.
+  BufMgr asyncMgr(num / 2);
+  std::vector<std::future<Page *>> pages;
+  for (i = 1; i <= num / 4; i++) {
+    pages.push_back(asyncMgr.readPageAsync(file1, i));
+    pages.push_back(asyncMgr.readPageAsync(file1, i));
+  }
+  for (i = 1; i <= num / 4; i++) {
+    RecordId recordId = {i, 1};
+    Page *first = pages[2 * (i - 1)].get();
+    if (pages[2 * (i - 1) + 1].get() != first) {
+      PRINT_ERROR("ERROR :: Concurrent reads used different frames");
+    }
+    sprintf(tmpbuf, "test.1 Page %u %7.1f", i, (float)i);
+    if (strncmp(first->getRecord(recordId).c_str(), tmpbuf, strlen(tmpbuf)) !=
+        0) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+    asyncMgr.unPinPage(file1, i, false);
+    asyncMgr.unPinPage(file1, i, false);
+  }
+  BufStats stats = asyncMgr.getBufStats();
+  if (stats.diskreads != (int)num / 4 || stats.hits != (int)num / 4) {
+    PRINT_ERROR("ERROR :: Concurrent reads of a page were not shared");
+  }
+
+  // A synchronous read of a page read asynchronously is a hit.
+  std::promise<Page *> read;
+  asyncMgr.readPageAsync(file1, num / 2,
+                         [&read](Page *page, std::exception_ptr error) {
+                           read.set_value(error ? nullptr : page);
+                         });
+  asyncMgr.readPage(file1, num / 2, page);
+  if (read.get_future().get() != page) {
+    PRINT_ERROR("ERROR :: Asynchronous read returned another frame");
+  }
+  asyncMgr.unPinPage(file1, num / 2, false);
+  asyncMgr.unPinPage(file1, num / 2, false);
+
+  // Errors are delivered through the future and leave no frame behind.
+  try {
+    asyncMgr.readPageAsync(file1, num + 1).get();
+    PRINT_ERROR("ERROR :: Reading past the end should have failed");
+  } catch (const InvalidPageException &e) {
+  }
+  asyncMgr.flushFile(file1);
+
+  std::cout << "Test 11 passed"
+            << "\n";
+}
+
+void test12(File &file1) {
+  // Frames are laid out back to back in one page-aligned arena, with or
+  // without huge pages.
+  for (bool hugePages : {false, true}) {
+    BufMgr arenaMgr(num / 2, 1, ReplacementPolicyType::CLOCK, hugePages);
+    Page *base = &arenaMgr.bufPool[0];
+    if (reinterpret_cast<std::uintptr_t>(base) % 4096 != 0) {
+      PRINT_ERROR("ERROR :: Buffer pool is not page-aligned");
+    }
+    for (i = 1; i <= num / 2; i++) {
+      RecordId recordId = {i, 1};
+      arenaMgr.readPage(file1, i, page);
+      const std::ptrdiff_t offset = reinterpret_cast<char *>(page) -
+                                    reinterpret_cast<char *>(base);
+      if (offset < 0 || offset % Page::SIZE != 0 ||
+          offset / Page::SIZE >= num / 2) {
+        PRINT_ERROR("ERROR :: Page is not a frame of the arena");
+      }
+      sprintf(tmpbuf, "test.1 Page %u %7.1f", i, (float)i);
+      if (strncmp(page->getRecord(recordId).c_str(), tmpbuf,
+                  strlen(tmpbuf)) != 0) {
+        PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+      }
+      arenaMgr.unPinPage(file1, i, false);
+    }
+    arenaMgr.flushFile(file1);
+  }
+
+  std::cout << "Test 12 passed"
+            << "\n";
+}
+
+void test13(File &file1) {
+  // Reading into a caller's page has to match reading a copy, and must fail
+  // the same way for pages that don't exist.
+  Page into{Page::Uninitialized()};
+  for (i = 1; i <= num; i++) {
+    file1.readPage(i, into);
+    Page copy = file1.readPage(i);
+    if (memcmp(&into, &copy, Page::SIZE) != 0) {
+      PRINT_ERROR("ERROR :: Page read in place differs from its copy");
+    }
+  }
+  try {
+    file1.readPage(num + 1, into);
+    PRINT_ERROR("ERROR :: Reading past the end should have failed");
+  } catch (const InvalidPageException &e) {
+  }
+
+  // Allocating into a page object hands out the announced page number.
+  const PageId expected = file1.nextAllocatedPage();
+  file1.allocatePage(into);
+  if (into.page_number() != expected ||
+      into.getFreeSpace() != Page::DATA_SIZE) {
+    PRINT_ERROR("ERROR :: Page allocated in place is wrong");
+  }
+  file1.deletePage(expected);
+
+  std::cout << "Test 13 passed"
+            << "\n";
+}
+
+void test14(File &file1) {
+  // Guards unpin when they go out of scope, also when an exception is thrown,
+  // and moving one hands over the pin.
+  BufMgr guardMgr(num / 2, 4);
+  {
+    ReadPageGuard first = guardMgr.readPageGuard(file1, 1);
+    Page *second;
+    guardMgr.readPage(file1, 1, second);
+    RecordId recordId = {1, 1};
+    sprintf(tmpbuf, "test.1 Page %u %7.1f", 1, 1.0f);
+    if (strncmp(first->getRecord(recordId).c_str(), tmpbuf, strlen(tmpbuf)) !=
+        0) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+    ReadPageGuard moved = std::move(first);
+    if (first || !moved || &*moved != second) {
+      PRINT_ERROR("ERROR :: Moving a guard did not hand over the pin");
+    }
+    try {
+      guardMgr.flushFile(file1);
+      PRINT_ERROR("ERROR :: Guarded page was not pinned");
+    } catch (const PagePinnedException &e) {
+    }
+    guardMgr.unPinPage(file1, 1, false);
+  }
+  try {
+    WritePageGuard guard = guardMgr.writePageGuard(file1, 2);
+    throw InvalidPageException(2, file1.filename());
+  } catch (const InvalidPageException &e) {
+  }
+  for (i = 3; i <= num / 2; i++) {
+    ReadPageGuard guard = guardMgr.readPageGuard(file1, i);
+    if (guard.pageNo() != i) {
+      PRINT_ERROR("ERROR :: Guard holds the wrong page");
+    }
+  }
+  guardMgr.flushFile(file1);
+  // The write guard marked page 2 dirty.
+  if (guardMgr.getBufStats().diskwrites != 1) {
+    PRINT_ERROR("ERROR :: Write guard did not mark its page dirty");
+  }
+
+  // A page allocated through a guard can be filled in place.
+  PageId pageNo;
+  {
+    WritePageGuard guard = guardMgr.allocPageGuard(file1, pageNo);
+    guard->insertRecord("guarded");
+  }
+  {
+    ReadPageGuard guard = guardMgr.readPageGuard(file1, pageNo);
+    RecordId recordId = {pageNo, 1};
+    if (guard->getRecord(recordId) != "guarded") {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+  }
+  guardMgr.disposePage(file1, pageNo);
+  guardMgr.flushFile(file1);
+
+  std::cout << "Test 14 passed"
+            << "\n";
+}
+
+void test15(File &file1) {
+  // A batch with runs, gaps, a repeated page and a resident page has to pin
+  // every entry and read every missing page exactly once.
+  BufMgr batchMgr(num / 2, 2);
+  batchMgr.readPage(file1, 7, page);
+  batchMgr.unPinPage(file1, 7, false);
+  batchMgr.clearBufStats();
+  const std::vector<PageId> pageNos = {12, 3, 4, 5, 7, 20, 11, 4, 13, 30};
+  std::vector<Page *> pages;
+  batchMgr.readPages(file1, pageNos, pages);
+  for (std::size_t k = 0; k < pageNos.size(); k++) {
+    RecordId recordId = {pageNos[k], 1};
+    sprintf(tmpbuf, "test.1 Page %u %7.1f", pageNos[k], (float)pageNos[k]);
+    if (strncmp(pages[k]->getRecord(recordId).c_str(), tmpbuf,
+                strlen(tmpbuf)) != 0) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+  }
+  BufStats stats = batchMgr.getBufStats();
+  if (stats.diskreads != 8 || stats.hits != 2 || pages[2] != pages[7]) {
+    PRINT_ERROR("ERROR :: Batch read pages more than once");
+  }
+  for (PageId pageNo : pageNos) {
+    batchMgr.unPinPage(file1, pageNo, false);
+  }
+
+  // A failing batch leaves nothing pinned.
+  try {
+    batchMgr.readPages(file1, {1, 2, num + 1, 3}, pages);
+    PRINT_ERROR("ERROR :: Reading past the end should have failed");
+  } catch (const InvalidPageException &e) {
+  }
+  std::vector<PageId> tooMany;
+  for (i = 1; i <= num; i++) tooMany.push_back(i);
+  try {
+    batchMgr.readPages(file1, tooMany, pages);
+    PRINT_ERROR("ERROR :: Batch larger than the pool should have failed");
+  } catch (const BufferExceededException &e) {
+  }
+  batchMgr.flushFile(file1);
+
+  std::cout << "Test 15 passed"
+            << "\n";
+}
+
+void test16(File &file1) {
+  // flushAll writes every unpinned dirty page, keeps the pages resident and
+  // leaves pinned pages alone.
+  BufMgr flushMgr(num, 3);
+  for (i = 1; i <= num / 2; i++) {
+    flushMgr.readPage(file1, i, page);
+    if (i % 3 != 0) {
+      page->updateRecord({i, 1}, "flushed");
+    }
+    if (i != 1) {
+      flushMgr.unPinPage(file1, i, i % 3 != 0);
+    }
+  }
+  flushMgr.unPinPage(file1, 1, false);
+  flushMgr.readPage(file1, 1, page);
+  page->updateRecord({1, 1}, "pinned");
+  flushMgr.unPinPage(file1, 1, true);
+  flushMgr.readPage(file1, 1, page);
+  flushMgr.flushAll();
+  BufStats stats = flushMgr.getBufStats();
+  const int dirtyUnpinned = num / 2 - num / 6 - 1;
+  if (stats.diskwrites != dirtyUnpinned) {
+    PRINT_ERROR("ERROR :: flushAll wrote the wrong pages");
+  }
+  if (file1.readPage(2).getRecord({2, 1}) != "flushed" ||
+      file1.readPage(1).getRecord({1, 1}) == "pinned") {
+    PRINT_ERROR("ERROR :: flushAll did not write the pages");
+  }
+  flushMgr.readPage(file1, 2, page);
+  flushMgr.unPinPage(file1, 2, false);
+  if (flushMgr.getBufStats().diskreads != stats.diskreads) {
+    PRINT_ERROR("ERROR :: flushAll evicted pages");
+  }
+  flushMgr.unPinPage(file1, 1, false);
+  flushMgr.flushFile(file1);
+  if (flushMgr.getBufStats().diskwrites != dirtyUnpinned + 1) {
+    PRINT_ERROR("ERROR :: Pinned page was not written later");
+  }
+
+  std::cout << "Test 16 passed"
+            << "\n";
+}
+
+// Counts the pages in the used list of a file.
+int countUsedPages(File &file) {
+  int count = 0;
+  for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+    count++;
+  }
+  return count;
+}
+
+void test17() {
+  // Writing a page keeps the next page pointer on disk, which is taken from
+  // the in-memory page chain, even if the page object is stale.
+  const std::string filename = "test.17";
+  Page first{Page::Uninitialized()};
+  {
+    File file = File::create(filename);
+    for (i = 0; i < 3; i++) {
+      file.allocatePage();
+    }
+    Page stale = file.readPage(3);
+    file.allocatePage();
+    stale.insertRecord("stale");
+    file.writePage(stale);
+    if (countUsedPages(file) != 4 ||
+        file.readPage(3).getRecord({3, 1}) != "stale") {
+      PRINT_ERROR("ERROR :: Writing a stale page broke the used list");
+    }
+
+    Page deleted = file.readPage(2);
+    file.deletePage(2);
+    try {
+      file.writePage(deleted);
+      PRINT_ERROR("ERROR :: Writing a deleted page should have failed");
+    } catch (const InvalidPageException &e) {
+    }
+    first = file.readPage(1);
+  }
+
+  // The chain of a reopened file is loaded from disk.
+  {
+    File file = File::open(filename);
+    File other = file;
+    other.writePage(first);
+    if (countUsedPages(file) != 3) {
+      PRINT_ERROR("ERROR :: Page chain was not loaded from disk");
+    }
+    // A page reused from the free list is writable again.
+    Page reused = file.allocatePage();
+    if (reused.page_number() != 2) {
+      PRINT_ERROR("ERROR :: Deleted page was not reused");
+    }
+    other.writePage(reused);
+    if (countUsedPages(file) != 4) {
+      PRINT_ERROR("ERROR :: Writing a reused page broke the used list");
+    }
+  }
+  File::remove(filename);
+
+  std::cout << "Test 17 passed"
+            << "\n";
+}
+
+// Reads the file header as it is on disk.
+FileHeader readHeaderOnDisk(const std::string &filename) {
+  FileHeader header;
+  std::ifstream stream(filename, std::ios::binary);
+  stream.read(reinterpret_cast<char *>(&header), sizeof(header));
+  return header;
+}
+
+void test18() {
+  // The file header is cached and only reaches the disk on sync and close.
+  const std::string filename = "test.18";
+  {
+    File file = File::create(filename);
+    if (readHeaderOnDisk(filename).num_pages != 1) {
+      PRINT_ERROR("ERROR :: Header of a new file was not written");
+    }
+    for (i = 0; i < 5; i++) {
+      file.allocatePage();
+    }
+    File other = File::open(filename);
+    if (other.readPage(5).page_number() != 5 ||
+        readHeaderOnDisk(filename).num_pages != 1) {
+      PRINT_ERROR("ERROR :: File header is not cached");
+    }
+    other.sync();
+    if (readHeaderOnDisk(filename).num_pages != 6) {
+      PRINT_ERROR("ERROR :: Sync did not write the file header");
+    }
+    file.allocatePage();
+    file.deletePage(2);
+  }
+
+  // Closing the last File object writes the header.
+  {
+    File file = File::open(filename);
+    if (readHeaderOnDisk(filename).num_pages != 7 ||
+        file.nextAllocatedPage() != 2 || countUsedPages(file) != 5) {
+      PRINT_ERROR("ERROR :: Close did not write the file header");
+    }
+  }
+  File::remove(filename);
+
+  std::cout << "Test 18 passed"
+            << "\n";
+}
+
+void test19() {
+  // Pages reused from the free list are linked into the used list in page
+  // number order, and the list on disk matches after reopening the file.
+  const std::string filename = "test.19";
+  {
+    File file = File::create(filename);
+    for (i = 0; i < num; i++) {
+      file.allocatePage();
+    }
+    for (i = 1; i <= num; i += 3) {
+      file.deletePage(i);
+    }
+    while (file.nextAllocatedPage() <= num) {
+      file.allocatePage();
+    }
+    file.allocatePage();
+  }
+  {
+    File file = File::open(filename);
+    PageId expected = 1;
+    for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+      if ((*iter).page_number() != expected++) {
+        PRINT_ERROR("ERROR :: Used list is not in page number order");
+      }
+    }
+    if (expected != num + 2) {
+      PRINT_ERROR("ERROR :: Used list lost pages");
+    }
+  }
+  File::remove(filename);
+
+  std::cout << "Test 19 passed"
+            << "\n";
+}
+
+// Reads the next page pointer of a page as it is on disk.
+PageId readNextPageOnDisk(const std::string &filename, PageId pageNo) {
+  PageHeader header;
+  std::ifstream stream(filename, std::ios::binary);
+  stream.seekg(sizeof(FileHeader) + (pageNo - 1) * Page::SIZE);
+  stream.read(reinterpret_cast<char *>(&header), sizeof(header));
+  return header.next_page_number;
+}
+
+void test20() {
+  // Deleting a page unlinks it in memory at once; the repaired pointer of
+  // its predecessor reaches the disk with the header.
+  const std::string filename = "test.20";
+  {
+    File file = File::create(filename);
+    for (i = 0; i < 10; i++) {
+      file.allocatePage();
+    }
+    file.sync();
+    file.deletePage(5);
+    if (countUsedPages(file) != 9 || file.readPage(4).next_page_number() != 6) {
+      PRINT_ERROR("ERROR :: Deleted page is still in the used list");
+    }
+    if (readNextPageOnDisk(filename, 4) != 5) {
+      PRINT_ERROR("ERROR :: Predecessor was written before the sync");
+    }
+    file.sync();
+    if (readNextPageOnDisk(filename, 4) != 6) {
+      PRINT_ERROR("ERROR :: Sync did not repair the predecessor");
+    }
+    file.deletePage(1);
+    file.deletePage(10);
+    try {
+      file.deletePage(5);
+      PRINT_ERROR("ERROR :: Deleting a free page should have failed");
+    } catch (const InvalidPageException &e) {
+    }
+  }
+  {
+    File file = File::open(filename);
+    if (countUsedPages(file) != 7 || file.begin() == file.end() ||
+        (*file.begin()).page_number() != 2) {
+      PRINT_ERROR("ERROR :: Used list on disk is wrong after deletes");
+    }
+    // After reopening, the chain is read back page by page as it is needed.
+    file.deletePage(7);
+    if (countUsedPages(file) != 6 || file.readPage(6).next_page_number() != 8) {
+      PRINT_ERROR("ERROR :: Deleted page is still in the used list");
+    }
+    for (const PageId expected : {7, 10, 1, 5}) {
+      if (file.allocatePage().page_number() != expected) {
+        PRINT_ERROR("ERROR :: Free pages were not reused in order");
+      }
+    }
+    PageId expected = 1;
+    for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+      if ((*iter).page_number() != expected++) {
+        PRINT_ERROR("ERROR :: Used list is not sorted after reuse");
+      }
+    }
+    if (expected != 11) {
+      PRINT_ERROR("ERROR :: Used list lost pages after reuse");
+    }
+  }
+  // A crash after the link to a new page was written but before the header
+  // that covers the page leaves the link pointing past the end of the file.
+  {
+    std::fstream stream(filename,
+                        std::ios::binary | std::ios::in | std::ios::out);
+    const PageId next = 11;
+    stream.seekp(sizeof(FileHeader) + 9 * Page::SIZE +
+                 offsetof(PageHeader, next_page_number));
+    stream.write(reinterpret_cast<const char *>(&next), sizeof(next));
+  }
+  {
+    File file = File::open(filename);
+    if (countUsedPages(file) != 10) {
+      PRINT_ERROR("ERROR :: Link past the end of the file was followed");
+    }
+    Page newPage = file.allocatePage();
+    if (newPage.page_number() != 11 ||
+        newPage.next_page_number() != Page::INVALID_NUMBER ||
+        countUsedPages(file) != 11) {
+      PRINT_ERROR("ERROR :: Page past the end of the file was linked twice");
+    }
+    file.sync();
+    if (readNextPageOnDisk(filename, 10) != 11) {
+      PRINT_ERROR("ERROR :: Link to the new page was not written");
+    }
+  }
+  // A page read in full puts its next page pointer in the chain, so writing
+  // it back does not read its header from disk again.
+  {
+    File file = File::open(filename);
+    Page page = file.readPage(3);
+    {
+      std::fstream stream(filename,
+                          std::ios::binary | std::ios::in | std::ios::out);
+      const PageId next = 7;
+      stream.seekp(sizeof(FileHeader) + 2 * Page::SIZE +
+                   offsetof(PageHeader, next_page_number));
+      stream.write(reinterpret_cast<const char *>(&next), sizeof(next));
+    }
+    file.writePage(page);
+    if (readNextPageOnDisk(filename, 3) != 4) {
+      PRINT_ERROR("ERROR :: Page header was read again to write the page");
+    }
+  }
+  File::remove(filename);
+
+  std::cout << "Test 20 passed"
+            << "\n";
+}
+
+// Fills a page with records of the given length.
+void fillPage(Page *page, std::size_t length) {
+  const std::string record(length, 'x');
+  while (page->hasSpaceForRecord(record)) {
+    page->insertRecord(record);
+  }
+}
+
+void test21() {
+  // The free-space map finds the first page with room and follows inserts,
+  // deletes and disposed pages.
+  const std::string filename = "test.21";
+  const std::string mapFilename = FreeSpaceMap::mapFilename(filename);
+  {
+    File file = File::create(filename);
+    // Pages written before the map exists are measured when it is built.
+    for (i = 0; i < 3; i++) {
+      Page page = file.allocatePage();
+      if (i == 0) fillPage(&page, 500);
+      file.writePage(page);
+    }
+
+    BufMgr fsmMgr(num);
+    if (fsmMgr.findPageWithSpace(file, 500) != 2) {
+      PRINT_ERROR("ERROR :: Map was not built from the file");
+    }
+    PageId pageNo;
+    for (i = 0; i < 5; i++) {
+      fsmMgr.allocPage(file, pageNo, page);
+      if (i < 4) fillPage(page, 500);
+      fsmMgr.unPinPage(file, pageNo, true);
+    }
+    fsmMgr.readPage(file, 2, page);
+    fillPage(page, 500);
+    fsmMgr.unPinPage(file, 2, true);
+    {
+      WritePageGuard guard = fsmMgr.writePageGuard(file, 3);
+      const std::string record(500, 'x');
+      while (guard->hasSpaceForRecord(record)) {
+        guard->insertRecord(record);
+      }
+    }
+    if (fsmMgr.findPageWithSpace(file, 500) != 8 ||
+        fsmMgr.findPageWithSpace(file, 10) == Page::INVALID_NUMBER) {
+      PRINT_ERROR("ERROR :: Map does not follow inserts");
+    }
+
+    fsmMgr.readPage(file, 5, page);
+    page->deleteRecord({5, 1});
+    fsmMgr.unPinPage(file, 5, true);
+    if (fsmMgr.findPageWithSpace(file, 500) != 5) {
+      PRINT_ERROR("ERROR :: Map does not follow deletes");
+    }
+    fsmMgr.disposePage(file, 5);
+    if (fsmMgr.findPageWithSpace(file, 500) != 8) {
+      PRINT_ERROR("ERROR :: Map does not follow disposed pages");
+    }
+    fsmMgr.flushFile(file);
+  }
+
+  // The map is kept in its own file.
+  {
+    File file = File::open(filename);
+    BufMgr fsmMgr(num);
+    if (fsmMgr.findPageWithSpace(file, 500) != 8 ||
+        fsmMgr.getBufStats().diskreads > FreeSpaceMap::LEVELS) {
+      PRINT_ERROR("ERROR :: Map was not kept in its file");
+    }
+  }
+  File::remove(filename);
+  File::remove(mapFilename);
+
+  std::cout << "Test 21 passed"
+            << "\n";
+}
+
+void test22() {
+  // A mapped file reads through the mapping, sees writes made with system
+  // calls at once and keeps up when it grows past the reserved mapping.
+  const std::string filename = "test.22";
+  File::create(filename);
+  {
+    File file = File::open(filename, FileBackend::MMAP);
+    File other = File::open(filename);
+    if (file.backend() != FileBackend::MMAP ||
+        other.backend() != FileBackend::MMAP) {
+      PRINT_ERROR("ERROR :: File is not mapped");
+    }
+    file.advise(FileAdvice::SEQUENTIAL);
+    // 1 MB of mapping is reserved at first, so this remaps.
+    const PageId pages = 2 * (1 << 20) / Page::SIZE;
+    for (i = 1; i <= pages; i++) {
+      Page page = file.allocatePage();
+      sprintf(tmpbuf, "mapped %d", i);
+      page.insertRecord(tmpbuf);
+      other.writePage(page);
+    }
+    for (i = 1; i <= pages; i++) {
+      sprintf(tmpbuf, "mapped %d", i);
+      if (file.viewPage(i)->getRecord({i, 1}) != tmpbuf ||
+          other.readPage(i).getRecord({i, 1}) != tmpbuf) {
+        PRINT_ERROR("ERROR :: Mapped page does not match what was written");
+      }
+    }
+
+    BufMgr mapMgr(num);
+    mapMgr.readPage(file, pages, page);
+    sprintf(tmpbuf, "mapped %d", pages);
+    if (page->getRecord({pages, 1}) != tmpbuf) {
+      PRINT_ERROR("ERROR :: Buffer manager read the wrong mapped page");
+    }
+    mapMgr.unPinPage(file, pages, false);
+
+    file.deletePage(3);
+    try {
+      file.viewPage(3);
+      PRINT_ERROR("ERROR :: Viewing a deleted page should have failed");
+    } catch (const InvalidPageException &e) {
+    }
+    try {
+      Page past{Page::Uninitialized()};
+      file.readPage(pages + 1, past);
+      PRINT_ERROR("ERROR :: Reading past the mapping should have failed");
+    } catch (const InvalidPageException &e) {
+    }
+  }
+  File::remove(filename);
+
+  std::cout << "Test 22 passed"
+            << "\n";
+}
+
+void test23() {
+  // Pages are read with pread(), so threads can read one file at once, even
+  // through the same File object, while another thread writes other pages.
+  const std::string filename = "test.23";
+  File::create(filename);
+  {
+    File file = File::open(filename);
+    const PageId pages = 64;
+    for (i = 1; i <= pages; i++) {
+      Page page = file.allocatePage();
+      sprintf(tmpbuf, "pread %d", i);
+      page.insertRecord(tmpbuf);
+      file.writePage(page);
+    }
+
+    const int numThreads = 4;
+    File copy = file;
+    std::vector<bool> matched(numThreads, true);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++) {
+      threads.emplace_back([&file, &copy, &matched, pages, t]() {
+        char buf[100];
+        File &reader = t % 2 == 0 ? file : copy;
+        Page page{Page::Uninitialized()};
+        for (PageId j = 0; j < 20 * pages; j++) {
+          // Only the first half of the file, which the writer leaves alone.
+          const PageId pageNo = 1 + (j * 7 + t * 13) % (pages / 2);
+          reader.readPage(pageNo, page);
+          sprintf(buf, "pread %u", pageNo);
+          if (page.getRecord({pageNo, 1}) != buf ||
+              reader.readPage(pageNo).getRecord({pageNo, 1}) != buf) {
+            matched[t] = false;
+          }
+        }
+      });
+    }
+    for (PageId pageNo = pages / 2 + 1; pageNo <= pages; pageNo++) {
+      Page page = file.readPage(pageNo);
+      sprintf(tmpbuf, "rewritten %u", pageNo);
+      page.updateRecord({pageNo, 1}, tmpbuf);
+      file.writePage(page);
+    }
+    for (std::thread &thread : threads) thread.join();
+
+    for (int t = 0; t < numThreads; t++) {
+      if (!matched[t]) {
+        PRINT_ERROR("ERROR :: Concurrent reads did not match");
+      }
+    }
+    sprintf(tmpbuf, "rewritten %u", pages);
+    if (copy.readPage(pages).getRecord({pages, 1}) != tmpbuf) {
+      PRINT_ERROR("ERROR :: Rewritten page does not match");
+    }
+  }
+
+  try {
+    File::create(filename);
+    PRINT_ERROR("ERROR :: Creating an existing file should have failed");
+  } catch (const FileExistsException &e) {
+  }
+  File::remove(filename);
+  if (File::exists(filename)) {
+    PRINT_ERROR("ERROR :: Removed file still exists");
+  }
+
+  std::cout << "Test 23 passed"
+            << "\n";
+}
+
+void test24() {
+  // Changes are logged before their pages are written: flushFile() makes the
+  // log durable up to the LSNs of the pages first, and the pages keep their
+  // LSNs on disk.  Concurrent committers share log syncs, and a torn record
+  // at the end of the log is cut off when the log is opened again, also if
+  // only its payload is torn.
+  const std::string filename = "test.24";
+  const std::string logFilename = "test.24.log";
+  std::remove(logFilename.c_str());
+  File::create(filename);
+  Lsn logEnd;
+  std::vector<Lsn> lsns;
+  {
+    LogManager log(logFilename);
+    {
+      BufMgr walMgr(num);
+      walMgr.enableLogging(log);
+      File file = File::open(filename);
+      Lsn last = 0;
+      for (i = 0; i < 20; i++) {
+        walMgr.allocPage(file, pid[i], page);
+        sprintf(tmpbuf, "logged %d", pid[i]);
+        page->insertRecord(tmpbuf);
+        const Lsn lsn = walMgr.logUpdate(file, pid[i]);
+        if (lsn <= last || page->lsn() != lsn) {
+          PRINT_ERROR("ERROR :: Page LSN does not follow the log");
+        }
+        last = lsn;
+        lsns.push_back(lsn);
+        walMgr.unPinPage(file, pid[i], true);
+      }
+      if (log.flushedLsn() >= last) {
+        PRINT_ERROR("ERROR :: Log was flushed before it had to be");
+      }
+      try {
+        walMgr.logUpdate(file, pid[0]);
+        PRINT_ERROR("ERROR :: Logging an unpinned page should have failed");
+      } catch (const PageNotPinnedException &e) {
+      }
+
+      walMgr.flushFile(file);
+      if (log.flushedLsn() < last) {
+        PRINT_ERROR("ERROR :: Pages were written before their log records");
+      }
+      for (i = 0; i < 20; i++) {
+        if (file.readPage(pid[i]).lsn() != lsns[i]) {
+          PRINT_ERROR("ERROR :: Page LSN was not written");
+        }
+      }
+    }
+
+    const int numThreads = 4;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++) {
+      threads.emplace_back([&log, t]() {
+        for (int j = 0; j < 25; j++) {
+          const std::string record =
+              "commit " + std::to_string(t) + " " + std::to_string(j);
+          log.flush(log.append(record.data(), record.size()));
+        }
+      });
+    }
+    for (std::thread &thread : threads) thread.join();
+    const LogStats stats = log.getStats();
+    // Every allocation logs the new page header as well.
+    if (stats.appends != 2 * 20 + 100 || log.flushedLsn() != log.lastLsn() ||
+        stats.flushes > stats.flushWaits) {
+      PRINT_ERROR("ERROR :: Log statistics are wrong");
+    }
+    logEnd = log.lastLsn();
+  }
+
+  std::vector<Lsn> replayed;
+  int commits = 0;
+  LogManager::replay(
+      logFilename, 0,
+      [&replayed, &commits](const Lsn lsn, const char *data,
+                            const std::uint32_t length) {
+        PageUpdateRecord header;
+        std::memcpy(&header, data,
+                    std::min<std::size_t>(length, sizeof(header)));
+        if (header.type != LogRecordType::PAGE_UPDATE ||
+            length != sizeof(header) + header.length + header.nameLength) {
+          commits++;
+        } else if (header.length == Page::SIZE) {
+          replayed.push_back(lsn);
+        }
+      });
+  // The header logged by every allocation is the first change of the page,
+  // so it is logged as a whole page too.
+  bool images = replayed.size() == 2 * lsns.size();
+  for (std::size_t j = 0; images && j < lsns.size(); j++) {
+    images = replayed[2 * j + 1] == lsns[j];
+  }
+  if (!images || commits != 100) {
+    PRINT_ERROR("ERROR :: Log does not hold the records appended");
+  }
+
+  {
+    // The frame made it to disk, but the payload is stale.
+    std::ofstream torn(logFilename, std::ios::binary | std::ios::app);
+    const std::string payload(100, 'x');
+    const std::uint32_t frame[3] = {100, ~100u,
+                                    crc32c(payload.data(), payload.size())};
+    torn.write(reinterpret_cast<const char *>(frame), sizeof(frame));
+    torn.write(std::string(100, '\0').data(), 100);
+  }
+  {
+    LogManager log(logFilename);
+    if (log.lastLsn() != logEnd) {
+      PRINT_ERROR("ERROR :: Record with a stale payload was not cut off");
+    }
+  }
+  {
+    std::ofstream torn(logFilename, std::ios::binary | std::ios::app);
+    const std::uint32_t frame[3] = {100, ~100u, 0};
+    torn.write(reinterpret_cast<const char *>(frame), sizeof(frame));
+    torn.write("torn", 4);
+  }
+  {
+    LogManager log(logFilename);
+    if (log.lastLsn() != logEnd) {
+      PRINT_ERROR("ERROR :: Torn log record was not cut off");
+    }
+    log.append("after", 5);
+  }
+  std::string after;
+  LogManager::replay(logFilename, logEnd,
+                     [&after](const Lsn lsn, const char *data,
+                              const std::uint32_t length) {
+                       after.append(data, length);
+                     });
+  if (after != "after") {
+    PRINT_ERROR("ERROR :: Record after the torn one was not read back");
+  }
+
+  File::remove(filename);
+  std::remove(logFilename.c_str());
+
+  std::cout << "Test 24 passed"
+            << "\n";
+}
+
+void test25() {
+  // A checkpoint records how far the data files are up to date, and
+  // recovery replays only the log after it.  Changes that were logged but
+  // never written, as after a crash, come back from the log.  The
+  // checkpointer writes old dirty pages to keep the log to replay short.
+  const std::string filename = "test.25";
+  const std::string logFilename = "test.25.log";
+  std::remove(logFilename.c_str());
+  std::remove(LogManager::masterFilename(logFilename).c_str());
+  File::create(filename);
+  {
+    LogManager log(logFilename);
+    BufMgr walMgr(num);
+    walMgr.enableLogging(log);
+    File file = File::open(filename);
+    for (i = 0; i < 10; i++) {
+      walMgr.allocPage(file, pid[i], page);
+      sprintf(tmpbuf, "checkpointed %d", pid[i]);
+      rid[i] = page->insertRecord(tmpbuf);
+      walMgr.logUpdate(file, pid[i]);
+      walMgr.unPinPage(file, pid[i], true);
+    }
+    walMgr.flushAll();
+    const Lsn beforeCheckpoint = log.lastLsn();
+    walMgr.checkpoint();
+    const CheckpointStats stats = walMgr.getCheckpointStats();
+    if (stats.checkpoints != 1 || stats.redoLsn != beforeCheckpoint ||
+        LogManager::redoLsn(logFilename) != beforeCheckpoint) {
+      PRINT_ERROR("ERROR :: Checkpoint did not record the end of the log");
+    }
+
+    // Crash: the changes are in the log only.
+    for (i = 0; i < 5; i++) {
+      walMgr.readPage(file, pid[i], page);
+      sprintf(tmpbuf, "recovered %d", pid[i]);
+      page->updateRecord(rid[i], tmpbuf);
+      walMgr.logUpdate(file, pid[i]);
+      walMgr.unPinPage(file, pid[i], true);
+    }
+    log.flushAll();
+  }
+
+  if (BufMgr::recover(logFilename) != 5) {
+    PRINT_ERROR(
+        "ERROR :: Recovery did not replay the log after the checkpoint");
+  }
+  if (BufMgr::recover(logFilename) != 0) {
+    PRINT_ERROR("ERROR :: Recovery applied changes that were on disk");
+  }
+  {
+    File file = File::open(filename);
+    for (i = 0; i < 10; i++) {
+      sprintf(tmpbuf, i < 5 ? "recovered %d" : "checkpointed %d", pid[i]);
+      if (file.readPage(pid[i]).getRecord(rid[i]) != tmpbuf) {
+        PRINT_ERROR("ERROR :: Recovered page does not hold the last change");
+      }
+    }
+  }
+
+  {
+    LogManager log(logFilename);
+    BufMgr walMgr(num);
+    walMgr.enableLogging(log);
+    File file = File::open(filename);
+    CheckpointConfig config;
+    config.targetRecoveryTime = std::chrono::milliseconds(1);
+    config.interval = std::chrono::milliseconds(1);
+    walMgr.startCheckpointer(config);
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    CheckpointStats stats;
+    do {
+      for (i = 0; i < 10; i++) {
+        walMgr.readPage(file, pid[i], page);
+        walMgr.logUpdate(file, pid[i]);
+        walMgr.unPinPage(file, pid[i], true);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      stats = walMgr.getCheckpointStats();
+    } while ((stats.checkpoints == 0 || stats.pagesWritten == 0) &&
+             std::chrono::steady_clock::now() < deadline);
+    walMgr.stopCheckpointer();
+    if (stats.checkpoints == 0 || stats.pagesWritten == 0) {
+      PRINT_ERROR("ERROR :: Checkpointer did not write old pages");
+    }
+    walMgr.flushFile(file);
+  }
+
+  // A crash that loses the file header: the pages allocated since it was
+  // written lie past the end of the file on disk, and recovery allocates
+  // them again.
+  File::remove(filename);
+  std::remove(logFilename.c_str());
+  std::remove(LogManager::masterFilename(logFilename).c_str());
+  File::create(filename);
+  const pid_t child = fork();
+  if (child == 0) {
+    LogManager log(logFilename);
+    BufMgr walMgr(num);
+    walMgr.enableLogging(log);
+    File file = File::open(filename);
+    for (i = 0; i < 3; i++) {
+      walMgr.allocPage(file, pid[i], page);
+      sprintf(tmpbuf, "allocated %d", pid[i]);
+      rid[i] = page->insertRecord(tmpbuf);
+      walMgr.logUpdate(file, pid[i]);
+      walMgr.unPinPage(file, pid[i], true);
+    }
+    log.flushAll();
+    _exit(0);
+  }
+  int status;
+  if (child < 0 || waitpid(child, &status, 0) != child ||
+      !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    PRINT_ERROR("ERROR :: Crashing process did not run");
+  }
+  if (BufMgr::recover(logFilename) != 6) {
+    PRINT_ERROR("ERROR :: Recovery skipped pages past the end of the file");
+  }
+  {
+    File file = File::open(filename);
+    for (i = 0; i < 3; i++) {
+      sprintf(tmpbuf, "allocated %d", pid[i]);
+      if (file.readPage(pid[i]).getRecord(rid[i]) != tmpbuf) {
+        PRINT_ERROR("ERROR :: Allocated page was not recovered");
+      }
+    }
+    if (countUsedPages(file) != 3 ||
+        file.allocatePage().page_number() != pid[2] + 1) {
+      PRINT_ERROR("ERROR :: Recovered pages are not in the used list");
+    }
+  }
+
+  File::remove(filename);
+  std::remove(logFilename.c_str());
+  std::remove(LogManager::masterFilename(logFilename).c_str());
+
+  std::cout << "Test 25 passed"
+            << "\n";
+}
+
+void test26() {
+  // Pages are written with a checksum and reads check it, through File and
+  // the buffer manager alike, unless checking is turned off.  Next page
+  // pointers that the file repairs on disk do not count.  Recovery rebuilds
+  // torn pages it has a whole image of.
+  const char *check = "123456789";
+  if (crc32c(check, 9) != 0xe3069283 ||
+      crc32cPortable(check, 9) != 0xe3069283 ||
+      crc32c(check + 4, 5, crc32c(check, 4)) != 0xe3069283 ||
+      crc32cPortable(tmpbuf, sizeof(tmpbuf), 7) !=
+          crc32c(tmpbuf, sizeof(tmpbuf), 7)) {
+    PRINT_ERROR("ERROR :: CRC-32C is wrong");
+  }
+  Page full;
+  for (i = 0; full.hasSpaceForRecord("a record to checksum"); i++) {
+    full.insertRecord("a record to checksum");
+  }
+  // Odd offsets and lengths take every path through crc32c().
+  if (crc32c(&full, Page::SIZE) != crc32cPortable(&full, Page::SIZE) ||
+      crc32c(reinterpret_cast<char *>(&full) + 3, Page::SIZE - 8) !=
+          crc32cPortable(reinterpret_cast<char *>(&full) + 3,
+                         Page::SIZE - 8)) {
+    PRINT_ERROR("ERROR :: CRC-32C is wrong");
+  }
+
+  const std::string filename = "test.26";
+  {
+    File file = File::create(filename);
+    for (i = 0; i < 10; i++) {
+      Page newPage = file.allocatePage();
+      sprintf(tmpbuf, "checksummed %d", i);
+      newPage.insertRecord(tmpbuf);
+      file.writePage(newPage);
+    }
+    // Repairs the next page pointer of page 4 on disk.
+    file.deletePage(5);
+    file.sync();
+    if (file.readPage(4).checksum() == 0) {
+      PRINT_ERROR("ERROR :: Page was written without a checksum");
+    }
+  }
+
+  // Flip one byte of the record on page 7.
+  {
+    std::fstream stream(filename,
+                        std::ios::binary | std::ios::in | std::ios::out);
+    stream.seekp(sizeof(FileHeader) + 7 * Page::SIZE - 1);
+    stream.put('!');
+  }
+
+  for (const FileBackend backend : {FileBackend::PREAD, FileBackend::MMAP}) {
+    File file = File::open(filename, backend);
+    for (PageId pageNo = 1; pageNo <= 10; pageNo++) {
+      if (pageNo == 5 || pageNo == 7) continue;
+      file.readPage(pageNo);
+    }
+    try {
+      file.readPage(7);
+      PRINT_ERROR("ERROR :: Corrupt page was read");
+    } catch (const CorruptPageException &e) {
+    }
+    file.verifyChecksums(false);
+    if (file.readPage(7).getRecord({7, 1}) != "checksummed !") {
+      PRINT_ERROR("ERROR :: Corrupt page could not be read without checking");
+    }
+    file.verifyChecksums(true);
+  }
+
+  {
+    BufMgr checkMgr(num);
+    File file = File::open(filename);
+    try {
+      checkMgr.readPage(file, 7, page);
+      PRINT_ERROR("ERROR :: Buffer manager read a corrupt page");
+    } catch (const CorruptPageException &e) {
+    }
+    // Writing the page back through the pool repairs it.
+    file.verifyChecksums(false);
+    checkMgr.readPage(file, 7, page);
+    checkMgr.unPinPage(file, 7, true);
+    checkMgr.flushFile(file);
+    file.verifyChecksums(true);
+    checkMgr.readPage(file, 6, page);
+    checkMgr.unPinPage(file, 6, false);
+    if (file.readPage(7).page_number() != 7) {
+      PRINT_ERROR("ERROR :: Rewritten page does not match its checksum");
+    }
+  }
+
+  // Recovery rebuilds a page torn by a crash from the whole-page image
+  // logged with its first change, and reports a torn page that only has
+  // byte ranges in the log once everything else is recovered.
+  const std::string logFilename = "test.26.log";
+  std::remove(logFilename.c_str());
+  std::remove(LogManager::masterFilename(logFilename).c_str());
+  {
+    LogManager log(logFilename);
+    BufMgr walMgr(num);
+    walMgr.enableLogging(log);
+    File file = File::open(filename);
+    for (const PageId pageNo : {2, 3}) {
+      walMgr.readPage(file, pageNo, page);
+      sprintf(tmpbuf, "rebuilt %d", pageNo);
+      page->updateRecord({pageNo, 1}, tmpbuf);
+      walMgr.logUpdate(file, pageNo, 0, sizeof(PageHeader));
+      walMgr.unPinPage(file, pageNo, true);
+    }
+    walMgr.flushFile(file);
+
+    PageUpdateRecord header;
+    std::memset(&header, 0, sizeof(header));
+    header.type = LogRecordType::PAGE_UPDATE;
+    header.length = sizeof(PageHeader);
+    header.nameLength = filename.size();
+    header.pageNo = 4;
+    const Page pageFour = file.readPage(4);
+    std::string record(reinterpret_cast<const char *>(&header),
+                       sizeof(header));
+    record.append(reinterpret_cast<const char *>(&pageFour),
+                  sizeof(PageHeader));
+    record.append(filename);
+    log.flush(log.append(record.data(), record.size()));
+  }
+  {
+    std::fstream stream(filename,
+                        std::ios::binary | std::ios::in | std::ios::out);
+    for (const PageId pageNo : {2, 4}) {
+      stream.seekp(sizeof(FileHeader) + pageNo * Page::SIZE - 100);
+      stream.write(std::string(100, '!').data(), 100);
+    }
+  }
+  try {
+    BufMgr::recover(logFilename);
+    PRINT_ERROR("ERROR :: Recovery did not report a page it cannot rebuild");
+  } catch (const CorruptPageException &e) {
+    if (e.page_number() != 4) {
+      PRINT_ERROR("ERROR :: Recovery reported the wrong page");
+    }
+  }
+  {
+    File file = File::open(filename);
+    for (const PageId pageNo : {2, 3}) {
+      sprintf(tmpbuf, "rebuilt %d", pageNo);
+      if (file.readPage(pageNo).getRecord({pageNo, 1}) != tmpbuf) {
+        PRINT_ERROR("ERROR :: Torn page was not rebuilt from the log");
+      }
+    }
+  }
+  std::remove(logFilename.c_str());
+  std::remove(LogManager::masterFilename(logFilename).c_str());
+
+  File::remove(filename);
+
+  std::cout << "Test 26 passed"
+            << "\n";
+}
+
+void test27() {
+  // The codec gives back what it was given, and refuses damaged input.
+  // Compressed files hold the same pages in far fewer bytes, pages that
+  // outgrow their extent move, and the location map brings them back when
+  // the file is opened again.
+  std::vector<char> text;
+  for (i = 0; text.size() < Page::DATA_SIZE; i++) {
+    sprintf(tmpbuf, "test.%d Hello from the page %d", i % 10, i);
+    text.insert(text.end(), tmpbuf, tmpbuf + strlen(tmpbuf));
+  }
+  std::vector<char> noise(Page::DATA_SIZE);
+  std::mt19937 rng(27);
+  for (char &c : noise) c = rng();
+  std::vector<char> packed(2 * Page::DATA_SIZE);
+  std::vector<char> unpacked(Page::DATA_SIZE);
+  const std::size_t textLength =
+      lzCompress(text.data(), Page::DATA_SIZE, packed.data(), packed.size());
+  if (textLength == 0 || textLength >= Page::DATA_SIZE / 2 ||
+      !lzDecompress(packed.data(), textLength, unpacked.data(),
+                    Page::DATA_SIZE) ||
+      std::memcmp(unpacked.data(), text.data(), Page::DATA_SIZE) != 0) {
+    PRINT_ERROR("ERROR :: Text did not compress and decompress");
+  }
+  if (lzDecompress(packed.data(), textLength - 1, unpacked.data(),
+                   Page::DATA_SIZE)) {
+    PRINT_ERROR("ERROR :: Truncated input was decompressed");
+  }
+  if (lzCompress(noise.data(), Page::DATA_SIZE, packed.data(),
+                 Page::DATA_SIZE - 1) != 0) {
+    PRINT_ERROR("ERROR :: Random bytes were compressed");
+  }
+  const std::size_t noiseLength =
+      lzCompress(noise.data(), Page::DATA_SIZE, packed.data(), packed.size());
+  if (noiseLength == 0 ||
+      !lzDecompress(packed.data(), noiseLength, unpacked.data(),
+                    Page::DATA_SIZE) ||
+      unpacked != noise) {
+    PRINT_ERROR("ERROR :: Random bytes did not round trip");
+  }
+
+  const std::string filename = "test.27";
+  const int pages = 100;
+  {
+    File file = File::create(filename, FileFormat::COMPRESSED);
+    for (i = 0; i < pages; i++) {
+      Page newPage = file.allocatePage();
+      sprintf(tmpbuf, "test.27 Page %d", newPage.page_number());
+      newPage.insertRecord(tmpbuf);
+      file.writePage(newPage);
+    }
+    // Page 3 grows past its extent and moves; page 4 goes away.
+    Page grown = file.readPage(3);
+    for (int j = 0; grown.hasSpaceForRecord(std::to_string(rng())); j++) {
+      grown.insertRecord(std::to_string(rng()));
+    }
+    file.writePage(grown);
+    file.deletePage(4);
+    if (file.format() != FileFormat::COMPRESSED) {
+      PRINT_ERROR("ERROR :: File is not compressed");
+    }
+  }
+  struct stat status;
+  stat(filename.c_str(), &status);
+  if (status.st_size >= pages * (off_t)Page::SIZE / 4) {
+    PRINT_ERROR("ERROR :: Compressed file is not smaller");
+  }
+
+  {
+    File file = File::open(filename);
+    int found = 0;
+    for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+      Page current = *iter;
+      sprintf(tmpbuf, "test.27 Page %d", current.page_number());
+      if (current.getRecord({current.page_number(), 1}) != tmpbuf) {
+        PRINT_ERROR("ERROR :: Compressed page does not hold its record");
+      }
+      found++;
+    }
+    if (found != pages - 1 || file.readPage(3).getFreeSpace() > 100) {
+      PRINT_ERROR("ERROR :: Compressed file lost pages");
+    }
+
+    // The buffer manager reads and writes compressed pages like any other.
+    {
+      BufMgr compressedMgr(num);
+      compressedMgr.readPage(file, 5, page);
+      page->insertRecord("test.27 written back");
+      compressedMgr.unPinPage(file, 5, true);
+      compressedMgr.flushFile(file);
+    }
+    if (file.readPage(5).getRecord({5, 2}) != "test.27 written back") {
+      PRINT_ERROR("ERROR :: Page written back was lost");
+    }
+
+    try {
+      File::open(filename, FileBackend::MMAP);
+      PRINT_ERROR("ERROR :: Compressed file was mapped");
+    } catch (const IoException &e) {
+    }
+  }
+
+  File::remove(filename);
+  if (File::exists(File::locationMapFilename(filename))) {
+    PRINT_ERROR("ERROR :: Location map was not removed");
+  }
+
+  std::cout << "Test 27 passed"
+            << "\n";
+}
+
+void test28() {
+  // Misses write their dirty victims back and read their pages without any
+  // latch held, while the background writer cleans pages and other threads
+  // allocate.  Every update has to survive, which fails if a page is read
+  // back before its write reached the file.
+  const std::string filename = "test.28";
+  File::create(filename);
+  {
+    File file = File::open(filename);
+    BufMgr mgr(16, 4);
+    BgWriterConfig config;
+    config.lowWatermark = 0;
+    config.interval = std::chrono::milliseconds(1);
+    mgr.startBgWriter(config);
+
+    const int numThreads = 4;
+    const PageId perThread = 16;
+    const int rounds = 20;
+    std::vector<std::vector<PageId>> owned(numThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++) {
+      threads.emplace_back([&mgr, &file, &owned, t]() {
+        char buf[100];
+        Page *threadPage;
+        PageId pageNo;
+        for (PageId j = 0; j < perThread; j++) {
+          mgr.allocPage(file, pageNo, threadPage);
+          sprintf(buf, "thread %d round %4d", t, 0);
+          threadPage->insertRecord(buf);
+          mgr.unPinPage(file, pageNo, true);
+          owned[t].push_back(pageNo);
+        }
+        for (int round = 1; round <= rounds; round++) {
+          for (const PageId own : owned[t]) {
+            mgr.readPage(file, own, threadPage);
+            sprintf(buf, "thread %d round %4d", t, round);
+            threadPage->updateRecord({own, 1}, buf);
+            mgr.unPinPage(file, own, true);
+          }
+        }
+      });
+    }
+    for (std::thread &thread : threads) thread.join();
+    mgr.stopBgWriter();
+    mgr.flushFile(file);
+
+    std::vector<bool> seen(numThreads * perThread + 1, false);
+    for (int t = 0; t < numThreads; t++) {
+      sprintf(tmpbuf, "thread %d round %4d", t, rounds);
+      for (const PageId pageNo : owned[t]) {
+        if (pageNo >= seen.size() || seen[pageNo]) {
+          PRINT_ERROR("ERROR :: Page allocated twice");
+        }
+        seen[pageNo] = true;
+        if (file.readPage(pageNo).getRecord({pageNo, 1}) != tmpbuf) {
+          PRINT_ERROR("ERROR :: Update lost under concurrent evictions");
+        }
+      }
+    }
+  }
+  File::remove(filename);
+
+  std::cout << "Test 28 passed"
+            << "\n";
+}
+
+void test29(File &file1) {
+  // Page 0 never exists.  For the first file its key is the key of an empty
+  // hash bucket, which must not match one; the buffer manager rejects it
+  // before looking it up at all.
+  BufHashTbl table(4);
+  table.insert(makePageKey(0, 1), 3);
+  FrameId frameNo;
+  if (table.tryLookup(makePageKey(0, Page::INVALID_NUMBER), frameNo)) {
+    PRINT_ERROR("ERROR :: Empty hash bucket matched page 0");
+  }
+
+  if (file1.id() != 0) {
+    PRINT_ERROR("ERROR :: Test needs the file with identifier 0");
+  }
+  BufMgr zeroMgr(4);
+  PageId pageNo;
+  zeroMgr.allocPage(file1, pageNo, page);
+  const RecordId kept = page->insertRecord("kept");
+  zeroMgr.unPinPage(file1, pageNo, true);
+  try {
+    zeroMgr.readPage(file1, Page::INVALID_NUMBER, page);
+    PRINT_ERROR("ERROR :: Page 0 was read");
+  } catch (const InvalidPageException &e) {
+  }
+  try {
+    zeroMgr.disposePage(file1, Page::INVALID_NUMBER);
+    PRINT_ERROR("ERROR :: Page 0 was disposed of");
+  } catch (const InvalidPageException &e) {
+  }
+  zeroMgr.flushFile(file1);
+  if (file1.readPage(pageNo).getRecord(kept) != "kept") {
+    PRINT_ERROR("ERROR :: Dirty page was lost");
+  }
+  zeroMgr.disposePage(file1, pageNo);
+
+  std::cout << "Test 29 passed"
+            << "\n";
+}
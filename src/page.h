@@ -59,6 +59,17 @@ struct PageHeader {
    */
   PageId next_page_number;
 
+  /**
+   * CRC-32C of the page as last written by File, see Page::computeChecksum().
+   */
+  std::uint32_t checksum;
+
+  /**
+   * LSN of the last log record that describes a change to the page, or 0.
+   * The page may only be written to disk once the log is durable up to here.
+   */
+  Lsn lsn;
+
   /**
    * Returns true if this page header is equal to the other.
    *
@@ -103,6 +114,10 @@ class PageIterator;
  * slots and identified by a RecordId.  Although a record's actual contents may
  * be moved on the page, accessing a record by its slot is consistent.
  *
+ * A Page object is exactly the SIZE-byte image stored on disk: the header
+ * followed by the data area, with no indirection.  Buffer frames are Page
+ * objects laid out back to back in one arena.
+ *
  * @warning This class is not threadsafe.
  */
 class Page {
@@ -128,11 +143,23 @@ class Page {
    */
   static const SlotId INVALID_SLOT = 0;
 
+  /**
+   * Tag selecting the constructor that leaves the page contents undefined.
+   */
+  struct Uninitialized {};
+
   /**
    * Constructs a new, uninitialized page.
    */
   Page();
 
+  /**
+   * Constructs a page without touching its header or data, for callers that
+   * overwrite the whole page right away, such as reads from disk.  Saves
+   * clearing DATA_SIZE bytes.
+   */
+  explicit Page(Uninitialized) {}
+
   /**
    * Inserts a new record into the page.
    *
@@ -187,6 +214,20 @@ class Page {
     return header_.free_space_upper_bound - header_.free_space_lower_bound;
   }
 
+  /**
+   * Returns the length of the longest record that fits on this page, which is
+   * the free space less a new slot if no free slot is left.
+   *
+   * @return  Length in bytes.
+   */
+  std::uint16_t getFreeSpaceForRecord() const {
+    const std::uint16_t free_space = getFreeSpace();
+    if (header_.num_free_slots > 0) {
+      return free_space;
+    }
+    return free_space > sizeof(PageSlot) ? free_space - sizeof(PageSlot) : 0;
+  }
+
   /**
    * Returns this page's number in its file.
    *
@@ -201,6 +242,21 @@ class Page {
    */
   PageId next_page_number() const { return header_.next_page_number; }
 
+  /**
+   * Returns the LSN of the last logged change to this page.
+   *
+   * @return  LSN, 0 if no change was logged.
+   */
+  Lsn lsn() const { return header_.lsn; }
+
+  /**
+   * Returns the checksum the page was last written with.  Changes to the
+   * page do not update it; File computes it again on every write.
+   *
+   * @return  CRC-32C of the page on disk.
+   */
+  std::uint32_t checksum() const { return header_.checksum; }
+
   /**
    * Returns an iterator at the first record in the page.
    *
@@ -240,6 +296,32 @@ class Page {
     header_.next_page_number = new_next_page_number;
   }
 
+  /**
+   * Sets the LSN of the last logged change to this page.
+   *
+   * @param new_lsn   LSN of the log record.
+   */
+  void set_lsn(const Lsn new_lsn) { header_.lsn = new_lsn; }
+
+  /**
+   * Computes the checksum of a page image.  The checksum field itself and the
+   * next page number are left out: File rewrites the next page number on
+   * disk without rewriting the rest of the page.
+   *
+   * @param header  Header of the page as written.
+   * @param data    Data of the page.
+   * @return  CRC-32C of the page.
+   */
+  static std::uint32_t computeChecksum(const PageHeader &header,
+                                       const char *data);
+
+  /**
+   * Returns whether the checksum field matches the contents of the page.
+   */
+  bool hasValidChecksum() const {
+    return header_.checksum == computeChecksum(header_, data_);
+  }
+
   /**
    * Deletes the record with the given ID.  Page is compacted upon delete to
    * ensure that data of all records is contiguous.  Slot array is compacted if
@@ -331,10 +413,11 @@ class Page {
    * Data stored on the page.  Includes bookkeeping information about slots as
    * well as actual content.
    */
+  char data_[DATA_SIZE];
 
-  std::string data_;
-
+  friend class BufMgr;
   friend class File;
+  friend class FreeSpaceMap;
   friend class PageIterator;
   friend class PageTest;
   friend class BufferTest;
@@ -343,5 +426,8 @@ class Page {
 static_assert(Page::SIZE > sizeof(PageHeader),
               "Page size must be large enough to hold header and data.");
 static_assert(Page::DATA_SIZE > 0, "Page must have some space to hold data.");
+static_assert(sizeof(Page) == Page::SIZE,
+              "Page must be exactly the on-disk page image, so that frames can "
+              "be laid out back to back.");
 
 }  // namespace badgerdb
@@ -0,0 +1,51 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "page_guard.h"
+
+#include "buffer.h"
+
+namespace badgerdb {
+
+PageGuard::PageGuard()
+    : bufMgr(nullptr), frameNo(0), page(nullptr), exclusive(false) {}
+
+PageGuard::PageGuard(BufMgr* bufMgr, const FrameId frameNo, Page* page,
+                     const bool exclusive)
+    : bufMgr(bufMgr), frameNo(frameNo), page(page), exclusive(exclusive) {}
+
+PageGuard::PageGuard(PageGuard&& other)
+    : bufMgr(other.bufMgr),
+      frameNo(other.frameNo),
+      page(other.page),
+      exclusive(other.exclusive) {
+  other.bufMgr = nullptr;
+}
+
+PageGuard& PageGuard::operator=(PageGuard&& other) {
+  if (this != &other) {
+    release(exclusive);
+    bufMgr = other.bufMgr;
+    frameNo = other.frameNo;
+    page = other.page;
+    exclusive = other.exclusive;
+    other.bufMgr = nullptr;
+  }
+  return *this;
+}
+
+PageGuard::~PageGuard() { release(false); }
+
+void PageGuard::release(const bool dirty) {
+  if (bufMgr == nullptr) return;
+  BufMgr* owner = bufMgr;
+  bufMgr = nullptr;
+  owner->unpinGuarded(frameNo, exclusive, dirty);
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,140 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+class BufMgr;
+
+/**
+ * @brief A pin on a buffer frame that is released automatically.
+ *
+ * Guards are returned by the BufMgr pin APIs.  A guard remembers the frame
+ * it pinned, so releasing it costs no hash table lookup, and it unpins the
+ * frame when it goes out of scope, so a pin cannot leak when an exception is
+ * thrown.  Guards can be moved but not copied; a moved-from or released
+ * guard holds nothing.
+ *
+ * Besides the pin, a guard holds the frame's latch, shared for a
+ * ReadPageGuard and exclusive for a WritePageGuard, so that guarded readers
+ * and writers of a page do not run at the same time.  Pages obtained with
+ * BufMgr::readPage() are not latched.  A thread must not hold two guards on
+ * the same page.
+ */
+class PageGuard {
+ public:
+  PageGuard(const PageGuard&) = delete;
+  PageGuard& operator=(const PageGuard&) = delete;
+
+  /**
+   * Returns true if the guard holds a pin.
+   */
+  explicit operator bool() const { return bufMgr != nullptr; }
+
+  /**
+   * Returns the pinned frame.
+   */
+  FrameId frame() const { return frameNo; }
+
+  /**
+   * Returns the number of the pinned page.
+   */
+  PageId pageNo() const { return page->page_number(); }
+
+ protected:
+  /**
+   * Constructs a guard that holds nothing.
+   */
+  PageGuard();
+
+  /**
+   * Constructs a guard for a frame that is pinned and latched already.
+   */
+  PageGuard(BufMgr* bufMgr, const FrameId frameNo, Page* page,
+            const bool exclusive);
+
+  PageGuard(PageGuard&& other);
+  PageGuard& operator=(PageGuard&& other);
+
+  /**
+   * Releases the latch and the pin, if the guard holds them.
+   */
+  ~PageGuard();
+
+  /**
+   * Releases the latch and the pin.  Does nothing if the guard holds nothing.
+   *
+   * @param dirty   True if the page was modified
+   */
+  void release(const bool dirty);
+
+  BufMgr* bufMgr;
+  FrameId frameNo;
+  Page* page;
+  bool exclusive;
+};
+
+/**
+ * @brief A shared pin on a page that is only read.
+ */
+class ReadPageGuard : public PageGuard {
+ public:
+  ReadPageGuard() {}
+  ReadPageGuard(ReadPageGuard&& other) = default;
+  ReadPageGuard& operator=(ReadPageGuard&& other) = default;
+
+  const Page& operator*() const { return *page; }
+  const Page* operator->() const { return page; }
+
+  /**
+   * Unpins the page before the guard goes out of scope.
+   */
+  void release() { PageGuard::release(false); }
+
+ private:
+  ReadPageGuard(BufMgr* bufMgr, const FrameId frameNo, Page* page)
+      : PageGuard(bufMgr, frameNo, page, false) {}
+
+  friend class BufMgr;
+};
+
+/**
+ * @brief An exclusive pin on a page that may be modified.
+ *
+ * The page is marked dirty when the guard goes out of scope, unless it is
+ * released explicitly with release(false).
+ */
+class WritePageGuard : public PageGuard {
+ public:
+  WritePageGuard() {}
+  WritePageGuard(WritePageGuard&& other) = default;
+  WritePageGuard& operator=(WritePageGuard&& other) = default;
+  ~WritePageGuard() { release(true); }
+
+  Page& operator*() const { return *page; }
+  Page* operator->() const { return page; }
+
+  /**
+   * Unpins the page before the guard goes out of scope.
+   *
+   * @param dirty   True if the page was modified
+   */
+  void release(const bool dirty = true) { PageGuard::release(dirty); }
+
+ private:
+  WritePageGuard(BufMgr* bufMgr, const FrameId frameNo, Page* page)
+      : PageGuard(bufMgr, frameNo, page, true) {}
+
+  friend class BufMgr;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,738 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "replacement_policy.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace badgerdb {
+
+const FrameId ReplacementPolicy::NO_FRAME;
+const std::uint32_t ClockProPolicy::NIL;
+
+//----------------------------------------
+// ReplacementPolicy
+//----------------------------------------
+
+std::unique_ptr<ReplacementPolicy> ReplacementPolicy::create(
+    const ReplacementPolicyType type, const std::uint32_t numFrames) {
+  switch (type) {
+    case ReplacementPolicyType::LRU:
+      return std::unique_ptr<ReplacementPolicy>(new LruPolicy(numFrames));
+    case ReplacementPolicyType::LRU_K:
+      return std::unique_ptr<ReplacementPolicy>(new LruKPolicy(numFrames));
+    case ReplacementPolicyType::TWO_Q:
+      return std::unique_ptr<ReplacementPolicy>(new TwoQPolicy(numFrames));
+    case ReplacementPolicyType::ARC:
+      return std::unique_ptr<ReplacementPolicy>(new ArcPolicy(numFrames));
+    case ReplacementPolicyType::CLOCK_PRO:
+      return std::unique_ptr<ReplacementPolicy>(new ClockProPolicy(numFrames));
+    case ReplacementPolicyType::CLOCK:
+    default:
+      return std::unique_ptr<ReplacementPolicy>(new ClockPolicy(numFrames));
+  }
+}
+
+const char *ReplacementPolicy::name(const ReplacementPolicyType type) {
+  switch (type) {
+    case ReplacementPolicyType::LRU:
+      return "LRU";
+    case ReplacementPolicyType::LRU_K:
+      return "LRU-2";
+    case ReplacementPolicyType::TWO_Q:
+      return "2Q";
+    case ReplacementPolicyType::ARC:
+      return "ARC";
+    case ReplacementPolicyType::CLOCK_PRO:
+      return "CLOCK-Pro";
+    case ReplacementPolicyType::CLOCK:
+    default:
+      return "CLOCK";
+  }
+}
+
+ReplacementPolicy::ReplacementPolicy(const std::uint32_t numFrames)
+    : freeFrames(numFrames) {
+  for (FrameId i = 0; i < numFrames; i++) freeFrames[i] = numFrames - 1 - i;
+}
+
+ReplacementPolicy::FrameList::FrameList(const std::uint32_t numFrames)
+    : head_(numFrames),
+      size_(0),
+      prev_(numFrames + 1, NO_FRAME),
+      next_(numFrames + 1, NO_FRAME) {
+  prev_[head_] = next_[head_] = head_;
+}
+
+void ReplacementPolicy::FrameList::pushBack(const FrameId frame) {
+  assert(!contains(frame));
+  const FrameId last = prev_[head_];
+  prev_[frame] = last;
+  next_[frame] = head_;
+  next_[last] = frame;
+  prev_[head_] = frame;
+  size_++;
+}
+
+void ReplacementPolicy::FrameList::remove(const FrameId frame) {
+  assert(contains(frame));
+  next_[prev_[frame]] = next_[frame];
+  prev_[next_[frame]] = prev_[frame];
+  prev_[frame] = next_[frame] = NO_FRAME;
+  size_--;
+}
+
+void ReplacementPolicy::GhostList::pushBack(const PageKey key) {
+  keys_.push_back(key);
+  index_[key] = std::prev(keys_.end());
+}
+
+void ReplacementPolicy::GhostList::popFront() {
+  index_.erase(keys_.front());
+  keys_.pop_front();
+}
+
+bool ReplacementPolicy::GhostList::erase(const PageKey key) {
+  auto it = index_.find(key);
+  if (it == index_.end()) return false;
+  keys_.erase(it->second);
+  index_.erase(it);
+  return true;
+}
+
+//----------------------------------------
+// CLOCK
+//----------------------------------------
+
+ClockPolicy::ClockPolicy(const std::uint32_t numFrames)
+    : ReplacementPolicy(numFrames),
+      numFrames(numFrames),
+      clockHand(numFrames - 1),
+      refbit(numFrames, false),
+      pinned(numFrames, false),
+      resident(numFrames, false) {}
+
+bool ClockPolicy::evict(const PageKey incoming, FrameId &frame) {
+  if (!freeFrames.empty()) {
+    frame = freeFrames.back();
+    freeFrames.pop_back();
+    pinned[frame] = true;
+    return true;
+  }
+
+  // Two full sweeps: the first may only clear refbits, the second then finds
+  // any frame that is not pinned.
+  for (std::uint32_t counter = 0; counter <= 2 * numFrames; counter++) {
+    clockHand = (clockHand + 1) % numFrames;
+    if (!resident[clockHand]) {
+      continue;  // handed out by evict() and not filled yet
+    }
+    if (refbit[clockHand]) {
+      refbit[clockHand] = false;
+      continue;  // advance clock and try again
+    }
+    if (pinned[clockHand]) {
+      continue;  // advance clock and try again
+    }
+    frame = clockHand;
+    resident[frame] = false;
+    pinned[frame] = true;
+    return true;
+  }
+  return false;
+}
+
+void ClockPolicy::fill(const FrameId frame, const PageKey key) {
+  resident[frame] = true;
+  pinned[frame] = true;
+  refbit[frame] = true;
+}
+
+void ClockPolicy::access(const FrameId frame) {
+  pinned[frame] = true;
+  refbit[frame] = true;
+}
+
+void ClockPolicy::unpin(const FrameId frame) { pinned[frame] = false; }
+
+void ClockPolicy::erase(const FrameId frame) {
+  resident[frame] = false;
+  pinned[frame] = false;
+  refbit[frame] = false;
+  freeFrames.push_back(frame);
+}
+
+void ClockPolicy::nextVictims(const std::uint32_t max,
+                              std::vector<FrameId> &frames) const {
+  // Frames whose reference bit is clear go on this sweep, the others on the
+  // next one.
+  std::uint32_t found = 0;
+  for (bool referenced : {false, true}) {
+    for (std::uint32_t step = 1; step <= numFrames && found < max; step++) {
+      const FrameId frame = (clockHand + step) % numFrames;
+      if (resident[frame] && !pinned[frame] && refbit[frame] == referenced) {
+        frames.push_back(frame);
+        found++;
+      }
+    }
+  }
+}
+
+//----------------------------------------
+// LRU
+//----------------------------------------
+
+LruPolicy::LruPolicy(const std::uint32_t numFrames)
+    : ReplacementPolicy(numFrames), lru(numFrames) {}
+
+bool LruPolicy::evict(const PageKey incoming, FrameId &frame) {
+  if (!freeFrames.empty()) {
+    frame = freeFrames.back();
+    freeFrames.pop_back();
+    return true;
+  }
+  if (lru.empty()) return false;
+
+  frame = lru.front();
+  lru.remove(frame);
+  return true;
+}
+
+void LruPolicy::fill(const FrameId frame, const PageKey key) {}
+
+void LruPolicy::access(const FrameId frame) {
+  if (lru.contains(frame)) lru.remove(frame);
+}
+
+void LruPolicy::unpin(const FrameId frame) { lru.pushBack(frame); }
+
+void LruPolicy::erase(const FrameId frame) {
+  if (lru.contains(frame)) lru.remove(frame);
+  freeFrames.push_back(frame);
+}
+
+void LruPolicy::nextVictims(const std::uint32_t max,
+                            std::vector<FrameId> &frames) const {
+  std::uint32_t found = 0;
+  for (FrameId frame = lru.empty() ? NO_FRAME : lru.front();
+       frame != NO_FRAME && found < max; frame = lru.next(frame), found++) {
+    frames.push_back(frame);
+  }
+}
+
+//----------------------------------------
+// LRU-K
+//----------------------------------------
+
+LruKPolicy::LruKPolicy(const std::uint32_t numFrames, const std::uint32_t k)
+    : ReplacementPolicy(numFrames),
+      k(k),
+      now(0),
+      keys(numFrames),
+      history(numFrames * k, 0),
+      isCandidate(numFrames, false) {}
+
+LruKPolicy::Candidate LruKPolicy::candidate(const FrameId frame) const {
+  // A page with fewer than k accesses has an infinite backward k-distance
+  // (k-th time 0) and is evicted first, by its last access.
+  return Candidate(history[frame * k + k - 1], history[frame * k], frame);
+}
+
+void LruKPolicy::recordAccess(const FrameId frame) {
+  std::uint64_t *times = &history[frame * k];
+  std::copy_backward(times, times + k - 1, times + k);
+  times[0] = ++now;
+}
+
+bool LruKPolicy::evict(const PageKey incoming, FrameId &frame) {
+  if (!freeFrames.empty()) {
+    frame = freeFrames.back();
+    freeFrames.pop_back();
+    return true;
+  }
+  if (candidates.empty()) return false;
+
+  frame = std::get<2>(*candidates.begin());
+  candidates.erase(candidates.begin());
+  isCandidate[frame] = false;
+
+  // Retain the history of the evicted page.
+  if (retained.size() >= keys.size()) {
+    retained.erase(retainedKeys.front());
+    retainedKeys.popFront();
+  }
+  retainedKeys.pushBack(keys[frame]);
+  retained[keys[frame]].assign(history.begin() + frame * k,
+                               history.begin() + (frame + 1) * k);
+  return true;
+}
+
+void LruKPolicy::fill(const FrameId frame, const PageKey key) {
+  keys[frame] = key;
+  auto it = retained.find(key);
+  if (it != retained.end()) {
+    std::copy(it->second.begin(), it->second.end(), &history[frame * k]);
+    retained.erase(it);
+    retainedKeys.erase(key);
+  } else {
+    std::fill(&history[frame * k], &history[frame * k] + k, 0);
+  }
+  recordAccess(frame);
+}
+
+void LruKPolicy::access(const FrameId frame) {
+  if (isCandidate[frame]) {
+    candidates.erase(candidate(frame));
+    isCandidate[frame] = false;
+  }
+  recordAccess(frame);
+}
+
+void LruKPolicy::unpin(const FrameId frame) {
+  candidates.insert(candidate(frame));
+  isCandidate[frame] = true;
+}
+
+void LruKPolicy::erase(const FrameId frame) {
+  if (isCandidate[frame]) {
+    candidates.erase(candidate(frame));
+    isCandidate[frame] = false;
+  }
+  freeFrames.push_back(frame);
+}
+
+void LruKPolicy::nextVictims(const std::uint32_t max,
+                             std::vector<FrameId> &frames) const {
+  std::uint32_t found = 0;
+  for (auto it = candidates.begin(); it != candidates.end() && found < max;
+       ++it, found++) {
+    frames.push_back(std::get<2>(*it));
+  }
+}
+
+//----------------------------------------
+// 2Q
+//----------------------------------------
+
+TwoQPolicy::TwoQPolicy(const std::uint32_t numFrames)
+    : ReplacementPolicy(numFrames),
+      maxIn(std::max<std::uint32_t>(1, numFrames / 4)),
+      maxOut(std::max<std::uint32_t>(1, numFrames / 2)),
+      inCount(0),
+      arrivals(0),
+      keys(numFrames),
+      queue(numFrames, NONE),
+      arrival(numFrames, 0),
+      am(numFrames) {}
+
+bool TwoQPolicy::evict(const PageKey incoming, FrameId &frame) {
+  if (!freeFrames.empty()) {
+    frame = freeFrames.back();
+    freeFrames.pop_back();
+    return true;
+  }
+
+  // Reclaim the oldest unpinned page of A1in while A1in is over its share,
+  // otherwise the least recently used page of Am; fall back to the other
+  // queue when every page of the chosen one is pinned.
+  if (!a1in.empty() && (inCount > maxIn || am.empty())) {
+    frame = a1in.begin()->second;
+    a1in.erase(a1in.begin());
+    inCount--;
+    a1out.pushBack(keys[frame]);
+    if (a1out.size() > maxOut) a1out.popFront();
+  } else if (!am.empty()) {
+    frame = am.front();
+    am.remove(frame);
+  } else {
+    return false;
+  }
+  queue[frame] = NONE;
+  return true;
+}
+
+void TwoQPolicy::fill(const FrameId frame, const PageKey key) {
+  keys[frame] = key;
+  if (a1out.erase(key)) {
+    queue[frame] = AM;
+  } else {
+    queue[frame] = A1IN;
+    arrival[frame] = ++arrivals;
+    inCount++;
+  }
+}
+
+void TwoQPolicy::access(const FrameId frame) {
+  // A hit in A1in keeps the page's place in arrival order.
+  if (queue[frame] == A1IN) {
+    a1in.erase(std::make_pair(arrival[frame], frame));
+  } else if (am.contains(frame)) {
+    am.remove(frame);
+  }
+}
+
+void TwoQPolicy::unpin(const FrameId frame) {
+  if (queue[frame] == A1IN) {
+    a1in.emplace(arrival[frame], frame);
+  } else if (queue[frame] == AM) {
+    am.pushBack(frame);
+  }
+}
+
+void TwoQPolicy::erase(const FrameId frame) {
+  if (am.contains(frame)) am.remove(frame);
+  if (queue[frame] == A1IN) {
+    a1in.erase(std::make_pair(arrival[frame], frame));
+    inCount--;
+  }
+  queue[frame] = NONE;
+  freeFrames.push_back(frame);
+}
+
+void TwoQPolicy::nextVictims(const std::uint32_t max,
+                             std::vector<FrameId> &frames) const {
+  std::uint32_t found = 0;
+  for (auto it = a1in.begin(); it != a1in.end() && found < max;
+       ++it, found++) {
+    frames.push_back(it->second);
+  }
+  for (FrameId frame = am.empty() ? NO_FRAME : am.front();
+       frame != NO_FRAME && found < max; frame = am.next(frame), found++) {
+    frames.push_back(frame);
+  }
+}
+
+//----------------------------------------
+// ARC
+//----------------------------------------
+
+ArcPolicy::ArcPolicy(const std::uint32_t numFrames)
+    : ReplacementPolicy(numFrames),
+      c(numFrames),
+      p(0),
+      t1Count(0),
+      t2Count(0),
+      keys(numFrames),
+      list(numFrames, NONE),
+      t1(numFrames),
+      t2(numFrames) {}
+
+bool ArcPolicy::evict(const PageKey incoming, FrameId &frame) {
+  const bool inB1 = b1.contains(incoming);
+  const bool inB2 = b2.contains(incoming);
+
+  // Work out the new target size of T1 and where the frame comes from
+  // first; nothing changes unless there is a frame to hand out.
+  std::uint32_t target = p;
+  if (inB1) {
+    // Case II: B1 hit, favour recency.
+    std::uint32_t delta = std::max<std::uint32_t>(1, b2.size() / b1.size());
+    target = std::min(c, p + delta);
+  } else if (inB2) {
+    // Case III: B2 hit, favour frequency.
+    std::uint32_t delta = std::max<std::uint32_t>(1, b1.size() / b2.size());
+    target = p > delta ? p - delta : 0;
+  }
+  const bool useFree = !freeFrames.empty();
+  bool fromT1 = false;
+  if (!useFree) {
+    // REPLACE(x, p)
+    fromT1 = t1Count > 0 && (t1Count > target || (inB2 && t1Count == target));
+    if (fromT1 ? t1.empty() : t2.empty()) fromT1 = !fromT1;
+    if ((fromT1 ? t1 : t2).empty()) return false;
+  }
+
+  p = target;
+  bool ghostT1Victim = true;
+  if (inB1) {
+    b1.erase(incoming);
+  } else if (inB2) {
+    b2.erase(incoming);
+  } else {
+    // Case IV: keep the directory within 2c pages.
+    const std::size_t l1 = t1Count + b1.size();
+    const std::size_t total = l1 + t2Count + b2.size();
+    if (l1 >= c) {
+      if (b1.size() > 0) {
+        b1.popFront();
+      } else {
+        ghostT1Victim = false;  // T1 fills the cache, drop its LRU page
+      }
+    } else if (total >= 2 * std::size_t(c) && b2.size() > 0) {
+      b2.popFront();
+    }
+  }
+
+  if (useFree) {
+    frame = freeFrames.back();
+    freeFrames.pop_back();
+  } else {
+    FrameList &victims = fromT1 ? t1 : t2;
+    frame = victims.front();
+    victims.remove(frame);
+    if (fromT1) {
+      t1Count--;
+      if (ghostT1Victim) b1.pushBack(keys[frame]);
+    } else {
+      t2Count--;
+      b2.pushBack(keys[frame]);
+    }
+  }
+
+  // A ghost hit means the page has been seen twice.
+  if (inB1 || inB2) {
+    list[frame] = T2;
+    t2Count++;
+  } else {
+    list[frame] = T1;
+    t1Count++;
+  }
+  return true;
+}
+
+void ArcPolicy::fill(const FrameId frame, const PageKey key) {
+  keys[frame] = key;
+}
+
+void ArcPolicy::access(const FrameId frame) {
+  // Case I: a hit moves the page to T2.
+  if (list[frame] == T1) {
+    if (t1.contains(frame)) t1.remove(frame);
+    t1Count--;
+    t2Count++;
+    list[frame] = T2;
+  } else if (t2.contains(frame)) {
+    t2.remove(frame);
+  }
+}
+
+void ArcPolicy::unpin(const FrameId frame) {
+  (list[frame] == T1 ? t1 : t2).pushBack(frame);
+}
+
+void ArcPolicy::erase(const FrameId frame) {
+  if (list[frame] == T1) {
+    if (t1.contains(frame)) t1.remove(frame);
+    t1Count--;
+  } else if (list[frame] == T2) {
+    if (t2.contains(frame)) t2.remove(frame);
+    t2Count--;
+  }
+  list[frame] = NONE;
+  freeFrames.push_back(frame);
+}
+
+void ArcPolicy::nextVictims(const std::uint32_t max,
+                            std::vector<FrameId> &frames) const {
+  std::uint32_t found = 0;
+  const bool t1First = t1Count > p;
+  for (const FrameList *victims : {t1First ? &t1 : &t2, t1First ? &t2 : &t1}) {
+    for (FrameId frame = victims->empty() ? NO_FRAME : victims->front();
+         frame != NO_FRAME && found < max;
+         frame = victims->next(frame), found++) {
+      frames.push_back(frame);
+    }
+  }
+}
+
+//----------------------------------------
+// CLOCK-Pro
+//----------------------------------------
+
+ClockProPolicy::ClockProPolicy(const std::uint32_t numFrames)
+    : ReplacementPolicy(numFrames),
+      memMax(numFrames),
+      memCold(numFrames),
+      countHot(0),
+      countCold(0),
+      countTest(0),
+      handHot(NIL),
+      handCold(NIL),
+      handTest(NIL),
+      nodes(2 * numFrames + 1),
+      frameNode(numFrames, NIL),
+      pinned(numFrames, false) {
+  for (std::uint32_t i = 0; i < nodes.size(); i++) {
+    freeNodes.push_back(nodes.size() - 1 - i);
+  }
+}
+
+std::uint32_t ClockProPolicy::link(const PageKey key, const FrameId frame,
+                                   const PageType type) {
+  const std::uint32_t node = freeNodes.back();
+  freeNodes.pop_back();
+  nodes[node] = Node{key, frame, type, false, node, node};
+  index[key] = node;
+
+  if (handHot == NIL) {
+    handHot = handCold = handTest = node;
+    return node;
+  }
+  // New pages go just behind the hot hand, the youngest position.
+  const std::uint32_t prev = nodes[handHot].prev;
+  nodes[node].prev = prev;
+  nodes[node].next = handHot;
+  nodes[prev].next = node;
+  nodes[handHot].prev = node;
+  if (handCold == handHot) handCold = node;
+  return node;
+}
+
+void ClockProPolicy::unlink(const std::uint32_t node) {
+  index.erase(nodes[node].key);
+  const std::uint32_t prev = nodes[node].prev;
+  const std::uint32_t next = nodes[node].next;
+  if (next == node) {
+    handHot = handCold = handTest = NIL;
+  } else {
+    if (handHot == node) handHot = prev;
+    if (handCold == node) handCold = prev;
+    if (handTest == node) handTest = prev;
+    nodes[prev].next = next;
+    nodes[next].prev = prev;
+  }
+  freeNodes.push_back(node);
+}
+
+bool ClockProPolicy::runHandCold(FrameId &frame) {
+  bool evicted = false;
+  Node &node = nodes[handCold];
+  if (node.type == COLD && !pinned[node.frame]) {
+    if (node.ref) {
+      // Referenced during its test period: promote.
+      node.type = HOT;
+      node.ref = false;
+      countCold--;
+      countHot++;
+    } else {
+      // Evict, but keep the page on the clock for its test period.
+      frame = node.frame;
+      frameNode[frame] = NIL;
+      node.type = TEST;
+      node.frame = NO_FRAME;
+      countCold--;
+      countTest++;
+      evicted = true;
+    }
+  }
+  handCold = nodes[handCold].next;
+
+  while (countTest > memMax) runHandTest();
+  while (memMax - memCold < countHot) runHandHot();
+  return evicted;
+}
+
+void ClockProPolicy::runHandHot() {
+  if (handHot == handTest) runHandTest();
+  if (handHot == NIL) return;
+  Node &node = nodes[handHot];
+  if (node.type == HOT) {
+    if (node.ref) {
+      node.ref = false;
+    } else {
+      node.type = COLD;
+      countHot--;
+      countCold++;
+    }
+  }
+  handHot = nodes[handHot].next;
+}
+
+void ClockProPolicy::runHandTest() {
+  if (nodes[handTest].type == TEST) {
+    // The test period ran out without a reference: shrink the cold target.
+    const std::uint32_t prev = nodes[handTest].prev;
+    unlink(handTest);
+    handTest = prev;
+    countTest--;
+    if (memCold > 1) memCold--;
+    if (handTest == NIL) return;
+  }
+  handTest = nodes[handTest].next;
+}
+
+bool ClockProPolicy::evict(const PageKey incoming, FrameId &frame) {
+  if (!freeFrames.empty()) {
+    frame = freeFrames.back();
+    freeFrames.pop_back();
+    pinned[frame] = true;
+    return true;
+  }
+
+  // After a full lap without a victim every unpinned cold page was
+  // referenced or none is left, so make the hot hand demote pages as well.
+  if (handCold == NIL) return false;  // every frame is being filled
+
+  const std::uint32_t lap = countHot + countCold + countTest;
+  for (std::uint32_t steps = 0; steps < 4 * lap + 4; steps++) {
+    if (steps >= lap) runHandHot();
+    if (handCold == NIL) return false;
+    if (runHandCold(frame)) {
+      pinned[frame] = true;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ClockProPolicy::fill(const FrameId frame, const PageKey key) {
+  auto it = index.find(key);
+  if (it != index.end() && nodes[it->second].type == TEST) {
+    // Reused within its test period: the page is hot, and cold pages
+    // deserve more room.
+    unlink(it->second);
+    countTest--;
+    if (memCold < memMax) memCold++;
+    frameNode[frame] = link(key, frame, HOT);
+    countHot++;
+    while (memMax - memCold < countHot) runHandHot();
+  } else {
+    frameNode[frame] = link(key, frame, COLD);
+    countCold++;
+  }
+  pinned[frame] = true;
+}
+
+void ClockProPolicy::access(const FrameId frame) {
+  nodes[frameNode[frame]].ref = true;
+  pinned[frame] = true;
+}
+
+void ClockProPolicy::unpin(const FrameId frame) { pinned[frame] = false; }
+
+void ClockProPolicy::erase(const FrameId frame) {
+  const std::uint32_t node = frameNode[frame];
+  if (node != NIL) {
+    if (nodes[node].type == HOT) {
+      countHot--;
+    } else {
+      countCold--;
+    }
+    unlink(node);
+    frameNode[frame] = NIL;
+  }
+  pinned[frame] = false;
+  freeFrames.push_back(frame);
+}
+
+void ClockProPolicy::nextVictims(const std::uint32_t max,
+                                 std::vector<FrameId> &frames) const {
+  if (handCold == NIL) return;
+  std::uint32_t found = 0;
+  std::uint32_t node = handCold;
+  do {
+    if (nodes[node].type == COLD && !pinned[nodes[node].frame]) {
+      frames.push_back(nodes[node].frame);
+      found++;
+    }
+    node = nodes[node].next;
+  } while (node != handCold && found < max);
+}
+
+}  // namespace badgerdb
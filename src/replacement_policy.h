@@ -0,0 +1,459 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Page replacement algorithms available to the buffer manager.
+ */
+enum class ReplacementPolicyType {
+  CLOCK,     //!< Clock sweep with one reference bit per frame
+  LRU,       //!< Least recently unpinned
+  LRU_K,     //!< LRU-2: largest backward distance to the second last access
+  TWO_Q,     //!< Full 2Q with A1in, A1out and Am queues
+  ARC,       //!< Adaptive Replacement Cache
+  CLOCK_PRO  //!< CLOCK-Pro with hot, cold and test pages
+};
+
+/**
+ * @brief Decides which frame of a set of buffer frames to reuse on a miss.
+ *
+ * A policy manages frames numbered 0 to numFrames-1 and is told about every
+ * event that matters to it:
+ *
+ * - evict() picks a frame for a page that is about to be read in.  The frame
+ *   is either free or holds a page that is not pinned; either way the policy
+ *   forgets the page it held and treats the frame as pinned until fill() or
+ *   erase() is called for it.
+ * - fill() tells that the frame now holds the given page, pinned once.
+ * - access() tells that the page in the frame was pinned again (a hit).
+ * - unpin() tells that the last pin of the frame was released.
+ * - erase() tells that the frame became free without being chosen by
+ *   evict(), for example because its file was flushed.
+ *
+ * nextVictims() lets the buffer manager look ahead at the frames evict() is
+ * about to choose, for example to write them back before they are needed.
+ *
+ * Frames start out free.  Pinned frames are never returned by evict(), and
+ * every policy selects a victim in O(1) amortized time.
+ *
+ * @warning This class is not threadsafe.
+ */
+class ReplacementPolicy {
+ public:
+  /**
+   * Creates a policy of the given type.
+   *
+   * @param type        Replacement algorithm.
+   * @param numFrames   Number of frames managed by the policy.
+   * @return  The policy.
+   */
+  static std::unique_ptr<ReplacementPolicy> create(
+      const ReplacementPolicyType type, const std::uint32_t numFrames);
+
+  /**
+   * Returns a printable name for the given policy type.
+   */
+  static const char *name(const ReplacementPolicyType type);
+
+  virtual ~ReplacementPolicy() {}
+
+  /**
+   * Returns true if evict() would hand out a free frame instead of evicting
+   * a page.
+   */
+  bool hasFreeFrame() const { return !freeFrames.empty(); }
+
+  /**
+   * Picks a frame to hold a page that is not in the buffer pool.
+   *
+   * @param incoming  Key of the page that will be read into the frame.
+   * @param frame     Frame chosen, returned via this reference.
+   * @return  False if every frame is pinned.
+   */
+  virtual bool evict(const PageKey incoming, FrameId &frame) = 0;
+
+  /**
+   * Records that a page was read into a frame returned by evict().
+   *
+   * @param frame   Frame holding the page.
+   * @param key     Key of the page.
+   */
+  virtual void fill(const FrameId frame, const PageKey key) = 0;
+
+  /**
+   * Records a hit on the page held by a frame.
+   *
+   * @param frame   Frame that was pinned.
+   */
+  virtual void access(const FrameId frame) = 0;
+
+  /**
+   * Records that a frame is no longer pinned.
+   *
+   * @param frame   Frame that was unpinned.
+   */
+  virtual void unpin(const FrameId frame) = 0;
+
+  /**
+   * Records that a frame became free.
+   *
+   * @param frame   Frame that was freed.
+   */
+  virtual void erase(const FrameId frame) = 0;
+
+  /**
+   * Lists frames holding unpinned pages in roughly the order evict() would
+   * choose them, without changing any state.
+   *
+   * @param max     Maximum number of frames to list.
+   * @param frames  Frames are appended to this vector.
+   */
+  virtual void nextVictims(const std::uint32_t max,
+                           std::vector<FrameId> &frames) const = 0;
+
+ protected:
+  /**
+   * Value of a frame link meaning "no frame".
+   */
+  static const FrameId NO_FRAME = ~FrameId(0);
+
+  /**
+   * @brief Doubly linked list of frames with O(1) insert and removal.
+   */
+  class FrameList {
+   public:
+    explicit FrameList(const std::uint32_t numFrames);
+
+    bool empty() const { return next_[head_] == head_; }
+    bool contains(const FrameId frame) const {
+      return next_[frame] != NO_FRAME;
+    }
+    std::uint32_t size() const { return size_; }
+    FrameId front() const { return next_[head_]; }
+
+    /**
+     * Returns the frame after the given one, or NO_FRAME at the end.
+     */
+    FrameId next(const FrameId frame) const {
+      return next_[frame] == head_ ? NO_FRAME : next_[frame];
+    }
+
+    void pushBack(const FrameId frame);
+    void remove(const FrameId frame);
+
+   private:
+    /**
+     * Index of the sentinel node, one past the last frame.
+     */
+    FrameId head_;
+    std::uint32_t size_;
+    std::vector<FrameId> prev_;
+    std::vector<FrameId> next_;
+  };
+
+  /**
+   * @brief FIFO of keys of pages that are no longer resident.
+   */
+  class GhostList {
+   public:
+    bool contains(const PageKey key) const {
+      return index_.find(key) != index_.end();
+    }
+    std::size_t size() const { return keys_.size(); }
+    PageKey front() const { return keys_.front(); }
+
+    void pushBack(const PageKey key);
+    void popFront();
+    bool erase(const PageKey key);
+
+   private:
+    std::list<PageKey> keys_;
+    std::unordered_map<PageKey, std::list<PageKey>::iterator> index_;
+  };
+
+  /**
+   * Constructor of ReplacementPolicy class; all frames start out free.
+   *
+   * @param numFrames   Number of frames managed by the policy.
+   */
+  explicit ReplacementPolicy(const std::uint32_t numFrames);
+
+  /**
+   * Stack of frames that hold no page, frame 0 on top initially
+   */
+  std::vector<FrameId> freeFrames;
+};
+
+/**
+ * @brief The classic clock algorithm.
+ *
+ * The hand sweeps over all frames, clearing reference bits, and takes the
+ * first unpinned frame whose bit is already clear.  Free frames are used
+ * before any page is evicted.
+ */
+class ClockPolicy : public ReplacementPolicy {
+ public:
+  explicit ClockPolicy(const std::uint32_t numFrames);
+
+  bool evict(const PageKey incoming, FrameId &frame) override;
+  void fill(const FrameId frame, const PageKey key) override;
+  void access(const FrameId frame) override;
+  void unpin(const FrameId frame) override;
+  void erase(const FrameId frame) override;
+  void nextVictims(const std::uint32_t max,
+                   std::vector<FrameId> &frames) const override;
+
+ private:
+  std::uint32_t numFrames;
+  FrameId clockHand;
+  std::vector<bool> refbit;
+  std::vector<bool> pinned;
+  std::vector<bool> resident;
+};
+
+/**
+ * @brief Evicts the frame that was unpinned least recently.
+ */
+class LruPolicy : public ReplacementPolicy {
+ public:
+  explicit LruPolicy(const std::uint32_t numFrames);
+
+  bool evict(const PageKey incoming, FrameId &frame) override;
+  void fill(const FrameId frame, const PageKey key) override;
+  void access(const FrameId frame) override;
+  void unpin(const FrameId frame) override;
+  void erase(const FrameId frame) override;
+  void nextVictims(const std::uint32_t max,
+                   std::vector<FrameId> &frames) const override;
+
+ private:
+  FrameList lru;
+};
+
+/**
+ * @brief LRU-K (O'Neil, O'Neil and Weikum).
+ *
+ * Evicts the unpinned page whose K-th most recent access is oldest; pages
+ * with fewer than K accesses go first, least recently used first.  Access
+ * history is kept for as many evicted pages as there are frames, so a page
+ * that comes back soon is not treated as new.  Candidates are kept ordered,
+ * so choosing a victim is O(1) and updating the order on a pin or unpin is
+ * O(log frames).
+ */
+class LruKPolicy : public ReplacementPolicy {
+ public:
+  LruKPolicy(const std::uint32_t numFrames, const std::uint32_t k = 2);
+
+  bool evict(const PageKey incoming, FrameId &frame) override;
+  void fill(const FrameId frame, const PageKey key) override;
+  void access(const FrameId frame) override;
+  void unpin(const FrameId frame) override;
+  void erase(const FrameId frame) override;
+  void nextVictims(const std::uint32_t max,
+                   std::vector<FrameId> &frames) const override;
+
+ private:
+  typedef std::tuple<std::uint64_t, std::uint64_t, FrameId> Candidate;
+
+  /**
+   * Returns the ordering key of an unpinned frame.
+   */
+  Candidate candidate(const FrameId frame) const;
+
+  /**
+   * Adds the current time to the access history of the frame.
+   */
+  void recordAccess(const FrameId frame);
+
+  std::uint32_t k;
+  std::uint64_t now;
+  std::vector<PageKey> keys;
+  /**
+   * Last k access times of every frame, most recent first; 0 means none.
+   */
+  std::vector<std::uint64_t> history;
+  std::set<Candidate> candidates;
+  std::vector<bool> isCandidate;
+  /**
+   * History of evicted pages, dropped in FIFO order.
+   */
+  GhostList retainedKeys;
+  std::unordered_map<PageKey, std::vector<std::uint64_t>> retained;
+};
+
+/**
+ * @brief Full 2Q (Johnson and Shasha).
+ *
+ * Pages seen once live in the FIFO A1in; when they are evicted from there
+ * their keys are remembered in A1out.  A page that misses while its key is in
+ * A1out is hot and goes to the LRU queue Am.  One-time scans therefore only
+ * cycle through A1in and never push hot pages out of Am.  Pinned pages are
+ * taken off both queues; an unpinned page of A1in goes back to its place in
+ * arrival order, which takes O(log frames), so that the oldest one is always
+ * at the front for evict().
+ */
+class TwoQPolicy : public ReplacementPolicy {
+ public:
+  explicit TwoQPolicy(const std::uint32_t numFrames);
+
+  bool evict(const PageKey incoming, FrameId &frame) override;
+  void fill(const FrameId frame, const PageKey key) override;
+  void access(const FrameId frame) override;
+  void unpin(const FrameId frame) override;
+  void erase(const FrameId frame) override;
+  void nextVictims(const std::uint32_t max,
+                   std::vector<FrameId> &frames) const override;
+
+ private:
+  enum Queue : std::uint8_t { NONE, A1IN, AM };
+
+  std::uint32_t maxIn;
+  std::uint32_t maxOut;
+  /**
+   * Number of pages in A1in, pinned or not
+   */
+  std::uint32_t inCount;
+  std::uint64_t arrivals;
+  std::vector<PageKey> keys;
+  std::vector<Queue> queue;
+  /**
+   * When each page of A1in was read in, counted in arrivals
+   */
+  std::vector<std::uint64_t> arrival;
+  /**
+   * The unpinned pages of A1in in arrival order, as (arrival, frame)
+   */
+  std::set<std::pair<std::uint64_t, FrameId>> a1in;
+  FrameList am;
+  GhostList a1out;
+};
+
+/**
+ * @brief Adaptive Replacement Cache (Megiddo and Modha).
+ *
+ * T1 holds pages seen once recently and T2 pages seen at least twice; the
+ * ghost lists B1 and B2 remember pages recently evicted from each.  A miss
+ * on a ghost moves the target size p of T1 towards the list that would have
+ * kept the page.
+ */
+class ArcPolicy : public ReplacementPolicy {
+ public:
+  explicit ArcPolicy(const std::uint32_t numFrames);
+
+  bool evict(const PageKey incoming, FrameId &frame) override;
+  void fill(const FrameId frame, const PageKey key) override;
+  void access(const FrameId frame) override;
+  void unpin(const FrameId frame) override;
+  void erase(const FrameId frame) override;
+  void nextVictims(const std::uint32_t max,
+                   std::vector<FrameId> &frames) const override;
+
+ private:
+  enum List : std::uint8_t { NONE, T1, T2 };
+
+  std::uint32_t c;
+  std::uint32_t p;
+  std::uint32_t t1Count;
+  std::uint32_t t2Count;
+  std::vector<PageKey> keys;
+  std::vector<List> list;
+  FrameList t1;
+  FrameList t2;
+  GhostList b1;
+  GhostList b2;
+};
+
+/**
+ * @brief CLOCK-Pro (Jiang, Chen and Zhang).
+ *
+ * Resident pages are hot or cold, and recently evicted cold pages stay on the
+ * clock as non-resident test pages.  A cold page referenced again during its
+ * test period becomes hot, and the number of frames reserved for cold pages
+ * adapts to how often that happens.  Three hands sweep the clock: the cold
+ * hand finds victims, the hot hand demotes hot pages and the test hand ends
+ * test periods.
+ */
+class ClockProPolicy : public ReplacementPolicy {
+ public:
+  explicit ClockProPolicy(const std::uint32_t numFrames);
+
+  bool evict(const PageKey incoming, FrameId &frame) override;
+  void fill(const FrameId frame, const PageKey key) override;
+  void access(const FrameId frame) override;
+  void unpin(const FrameId frame) override;
+  void erase(const FrameId frame) override;
+  void nextVictims(const std::uint32_t max,
+                   std::vector<FrameId> &frames) const override;
+
+ private:
+  enum PageType : std::uint8_t { HOT, COLD, TEST };
+
+  /**
+   * @brief Entry on the clock.
+   */
+  struct Node {
+    PageKey key;
+    FrameId frame;
+    PageType type;
+    bool ref;
+    std::uint32_t prev;
+    std::uint32_t next;
+  };
+
+  static const std::uint32_t NIL = ~std::uint32_t(0);
+
+  /**
+   * Links a new node for the key just behind the hot hand.
+   */
+  std::uint32_t link(const PageKey key, const FrameId frame,
+                     const PageType type);
+
+  /**
+   * Removes a node from the clock and frees it.
+   */
+  void unlink(const std::uint32_t node);
+
+  /**
+   * Moves the cold hand one step.
+   *
+   * @param frame   Frame of the cold page that was evicted, if any.
+   * @return  True if a page was evicted.
+   */
+  bool runHandCold(FrameId &frame);
+  void runHandHot();
+  void runHandTest();
+
+  std::uint32_t memMax;
+  std::uint32_t memCold;
+  std::uint32_t countHot;
+  std::uint32_t countCold;
+  std::uint32_t countTest;
+  std::uint32_t handHot;
+  std::uint32_t handCold;
+  std::uint32_t handTest;
+  std::vector<Node> nodes;
+  std::vector<std::uint32_t> freeNodes;
+  std::unordered_map<PageKey, std::uint32_t> index;
+  std::vector<std::uint32_t> frameNode;
+  std::vector<bool> pinned;
+};
+
+}  // namespace badgerdb
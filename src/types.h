@@ -27,6 +27,48 @@ typedef std::uint16_t SlotId;
  */
 typedef std::uint32_t FrameId;
 
+/**
+ * @brief Identifier for an open file, assigned densely from 0 by File.
+ */
+typedef std::uint32_t FileId;
+
+/**
+ * @brief Log sequence number: the position in the write-ahead log just past
+ * the end of a log record.  0 comes before every record.
+ */
+typedef std::uint64_t Lsn;
+
+/**
+ * @brief Identifier for a page of an open file: the FileId in the high 32 bits
+ * and the PageId in the low 32 bits.
+ */
+typedef std::uint64_t PageKey;
+
+/**
+ * Packs a file and page number into a single PageKey.
+ *
+ * @param fileId  Identifier of the file.
+ * @param pageNo  Number of the page in the file.
+ * @return  Key for the page.
+ */
+constexpr PageKey makePageKey(const FileId fileId, const PageId pageNo) {
+  return static_cast<PageKey>(fileId) << 32 | pageNo;
+}
+
+/**
+ * Returns the file identifier packed in a PageKey.
+ */
+constexpr FileId pageKeyFile(const PageKey key) {
+  return static_cast<FileId>(key >> 32);
+}
+
+/**
+ * Returns the page number packed in a PageKey.
+ */
+constexpr PageId pageKeyPage(const PageKey key) {
+  return static_cast<PageId>(key);
+}
+
 /**
  * @brief Identifier for a record in a page.
  */